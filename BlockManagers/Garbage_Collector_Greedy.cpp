@@ -32,15 +32,15 @@ vector<long> Garbage_Collector_Greedy::get_relevant_gc_candidates(int package_id
 	return candidates;
 }
 
-Block* Garbage_Collector_Greedy::choose_gc_victim(int package_id, int die_id, int klass) const {
+Block Garbage_Collector_Greedy::choose_gc_victim(int package_id, int die_id, int klass) const {
 	vector<long> candidates = get_relevant_gc_candidates(package_id, die_id, klass);
 	uint min_valid_pages = BLOCK_SIZE;
-	Block* best_block = NULL;
+	Block best_block;
 	for (auto physical_address : candidates) {
 		Address a = Address(physical_address, BLOCK);
-		Block* block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
-		if (block->get_pages_valid() < min_valid_pages && (block->get_state() == ACTIVE || block->get_state() == INACTIVE)) {
-			min_valid_pages = block->get_pages_valid();
+		Block block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+		if (block.get_pages_valid() < min_valid_pages && (block.get_state() == ACTIVE || block.get_state() == INACTIVE)) {
+			min_valid_pages = block.get_pages_valid();
 			best_block = block;
 			assert(min_valid_pages < BLOCK_SIZE);
 		}
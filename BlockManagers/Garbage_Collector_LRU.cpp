@@ -21,7 +21,7 @@ void Garbage_Collector_LRU::commit_choice_of_victim(Address const& phys_address,
 	}
 }
 
-Block* Garbage_Collector_LRU::choose_gc_victim(int package_id, int die_id, int klass) const {
+Block Garbage_Collector_LRU::choose_gc_victim(int package_id, int die_id, int klass) const {
 
 	if (package_id == UNDEFINED) {
 		package_id = rand() % SSD_SIZE;
@@ -30,7 +30,7 @@ Block* Garbage_Collector_LRU::choose_gc_victim(int package_id, int die_id, int k
 		die_id = rand() % PACKAGE_SIZE;
 	}
 
-	Block* block = NULL;
+	Block block;
 	Address a = Address(0, BLOCK);
 	a.package = package_id;
 	a.die = die_id;
@@ -42,7 +42,7 @@ Block* Garbage_Collector_LRU::choose_gc_victim(int package_id, int die_id, int k
 		if (a.block == 0) {
 			a.block = PLANE_SIZE;
 		}
-	} while (block == NULL || block->get_state() == PARTIALLY_FREE || block->get_state() == FREE);
+	} while (block.is_null() || block.get_state() == PARTIALLY_FREE || block.get_state() == FREE);
 
 	//a.print();
 	//printf("\t%d   %d\n", gc_candidates[package_id][die_id], block->get_pages_valid());
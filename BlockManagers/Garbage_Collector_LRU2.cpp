@@ -32,7 +32,7 @@ void Garbage_Collector_LRU2::commit_choice_of_victim(Address const& phys_address
 	gc_candidates[package][die].pop();
 }
 
-Block* Garbage_Collector_LRU2::choose_gc_victim(int package_id, int die_id, int klass) const {
+Block Garbage_Collector_LRU2::choose_gc_victim(int package_id, int die_id, int klass) const {
 	if (package_id == UNDEFINED) {
 		package_id = rand() % SSD_SIZE;
 	}
@@ -40,13 +40,13 @@ Block* Garbage_Collector_LRU2::choose_gc_victim(int package_id, int die_id, int
 		die_id = rand() % PACKAGE_SIZE;
 	}
 
-	Block* block = NULL;
+	Block block;
 	Address a = Address(0, BLOCK);
 	a.package = package_id;
 	a.die = die_id;
 	assert(gc_candidates[package_id][die_id].size() > 0);
 	a.block = gc_candidates[package_id][die_id].front();
 	block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
-	assert(block->get_state() != PARTIALLY_FREE && block->get_state() != FREE);
+	assert(block.get_state() != PARTIALLY_FREE && block.get_state() != FREE);
 	return block;
 }
@@ -65,7 +65,7 @@ void Migrator::handle_erase_completion(Event* event) {
 		}
 	}
 
-	Block* block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+	long block = a.get_linear_address();
 	double time_to_completion = 0;
 	if (gc_time_stat.count(block) == 1) {
 		double time_to_completion = event->get_current_time() - gc_time_stat.at(block);
@@ -90,7 +90,7 @@ void Migrator::handle_erase_completion(Event* event) {
 
 void Migrator::handle_trim_completion(Event* event) {
 	Address ra = event->get_replace_address();
-	Block& block = *ssd->get_package(ra.package)->get_die(ra.die)->get_plane(ra.plane)->get_block(ra.block);
+	Block block = ssd->get_package(ra.package)->get_die(ra.die)->get_plane(ra.plane)->get_block(ra.block);
 	Page const& page = block.get_page(ra.page);
 	uint age_class = bm->sort_into_age_class(ra);
 	long const phys_addr = block.get_physical_address();
@@ -129,6 +129,10 @@ uint Migrator::how_many_gc_operations_are_scheduled() const {
 	return blocks_being_garbage_collected.size();
 }
 
+uint Migrator::how_many_gc_operations_are_scheduled_on(Address const& lun) const {
+	return num_blocks_being_garbaged_collected_per_LUN[lun.package][lun.die];
+}
+
 void Migrator::issue_erase(Address ra, double time) {
 	ra.valid = BLOCK;
 	ra.page = 0;
@@ -218,11 +222,11 @@ void Migrator::register_ECC_check_on(uint logical_address) {
 }
 
 void Migrator::update_structures(Address const& a, double time) {
-	Block* victim = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+	Block victim = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 	gc->commit_choice_of_victim(a, time);
-	blocks_being_garbage_collected[victim->get_physical_address()] = victim->get_pages_valid();
+	blocks_being_garbage_collected[victim.get_physical_address()] = victim.get_pages_valid();
 	num_blocks_being_garbaged_collected_per_LUN[a.package][a.die]++;
-	StatisticsGatherer::get_global_instance()->register_executed_gc(*victim);
+	StatisticsGatherer::get_global_instance()->register_executed_gc(victim);
 }
 
 vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
@@ -246,7 +250,7 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 		i++;
 	}
 
-	Block * victim;
+	Block victim;
 	if (a.valid == BLOCK) {
 		victim = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 	}
@@ -256,17 +260,17 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 
 	StatisticsGatherer::get_global_instance()->register_scheduled_gc(*gc_event);
 
-	if (victim == NULL) {
+	if (victim.is_null()) {
 		StatisticsGatherer::get_global_instance()->num_gc_cancelled_no_candidate++;
 		return migrations;
 	}
 
-	if (bm->get_num_pages_available_for_new_writes() < victim->get_pages_valid()) {
+	if (bm->get_num_pages_available_for_new_writes() < victim.get_pages_valid()) {
 		StatisticsGatherer::get_global_instance()->num_gc_cancelled_not_enough_free_space++;
 		return migrations;
 	}
 
-	Address addr = Address(victim->get_physical_address(), BLOCK);
+	Address addr = Address(victim.get_physical_address(), BLOCK);
 
 	if (num_blocks_being_garbaged_collected_per_LUN[addr.package][addr.die] >= 1) {
 		StatisticsGatherer::get_global_instance()->num_gc_cancelled_gc_already_happening++;
@@ -281,17 +285,17 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 		return migrations;
 	}*/
 
-	if (victim->get_physical_address() == 976 && gc_event->get_start_time() > 39548840) {
+	if (victim.get_physical_address() == 976 && gc_event->get_start_time() > 39548840) {
 		int i = 0;
 		i++;
 	}
 
-	if (victim->get_state() == FREE) {
+	if (victim.get_state() == FREE) {
 		//printf("warning: trying to garbage collect a block that is completely free. This will be ignored.\n");
 		return migrations;
 	}
 
-	if (victim->get_state() == PARTIALLY_FREE) {
+	if (victim.get_state() == PARTIALLY_FREE) {
 		//printf("warning: trying to garbage collect a block that is partially free. This will be ignored.\n");
 		return migrations;
 	}
@@ -302,11 +306,11 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 
 	update_structures(addr, gc_event->get_current_time());
 	//printf("blocks being gced %d\n", blocks_being_garbage_collected.size());
-	bm->subtract_from_available_for_new_writes(victim->get_pages_valid());
+	bm->subtract_from_available_for_new_writes(victim.get_pages_valid());
 
 	if (PRINT_LEVEL > 1) {
 		printf("num gc operations in (%d %d) : %d  ", addr.package, addr.die, num_blocks_being_garbaged_collected_per_LUN[addr.package][addr.die]);
-		printf("Triggering GC in %ld    time: %f  ", victim->get_physical_address(), gc_event->get_current_time()); addr.print(); printf(". Migrating %d \n", victim->get_pages_valid());
+		printf("Triggering GC in %ld    time: %f  ", victim.get_physical_address(), gc_event->get_current_time()); addr.print(); printf(". Migrating %d \n", victim.get_pages_valid());
 		printf("%lu GC operations taking place now. On:   ", blocks_being_garbage_collected.size());
 		for (auto i : blocks_being_garbage_collected) {
 			printf("%d  ", i.first);
@@ -314,12 +318,12 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 		printf("\n");
 	}
 
-	assert(victim->get_state() != FREE);
-	assert(victim->get_state() != PARTIALLY_FREE);
+	assert(victim.get_state() != FREE);
+	assert(victim.get_state() != PARTIALLY_FREE);
 
 	StatisticData::register_statistic("GC_eff_with_writes", {
 			new Integer(StatisticsGatherer::get_global_instance()->total_writes()),
-			new Integer(victim->get_pages_valid())
+			new Integer(victim.get_pages_valid())
 	});
 
 	StatisticData::register_field_names("GC_eff_with_writes", {
@@ -327,9 +331,9 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 			"num_pages_to_migrate"
 	});
 
-	gc_time_stat[victim] = gc_event->get_current_time();
+	gc_time_stat[victim.get_physical_address()] = gc_event->get_current_time();
 
-	if (victim->get_pages_invalid() == BLOCK_SIZE) {
+	if (victim.get_pages_invalid() == BLOCK_SIZE) {
 		issue_erase(addr, gc_event->get_current_time());
 		return migrations;
 	}
@@ -337,8 +341,8 @@ vector<deque<Event*> > Migrator::migrate(Event* gc_event) {
 	// TODO: for DFTL, we in fact do not know the LBA when we dispatch the write. We get this from the OOB. Need to fix this.
 	//PRINT_LEVEL = 1;
 	for (uint i = 0; i < BLOCK_SIZE; i++) {
-		if (victim->get_page(i).get_state() == VALID) {
-			Address addr = Address(victim->get_physical_address(), PAGE);
+		if (victim.get_page(i).get_state() == VALID) {
+			Address addr = Address(victim.get_physical_address(), PAGE);
 			addr.page = i;
 			long logical_address = ftl->get_logical_address(addr.get_linear_address());
 			deque<Event*> migration;
@@ -35,14 +35,14 @@ void bm_gc_locality::register_write_outcome(Event const& event, enum status stat
 			free_block_pointers[a.package][a.die].valid == PAGE &&
 			free_block_pointers[a.package][a.die].page + 1 == BLOCK_SIZE) {
 		Address partially_free_pointer = partially_used_blocks[a.package][a.die].front();
-		free_block_pointers[a.package][a.die] = partially_free_pointer;
+		set_block_pointer(a.package, a.die, partially_free_pointer, event.get_current_time());
 		assert(partially_free_pointer.package == a.package && partially_free_pointer.die == a.die);
 		partially_used_blocks[a.package][a.die].pop();
 	}
 
 	if (event.is_garbage_collection_op()) {
 		Address block_addr = event.get_replace_address();
-		Block* block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
+		Block block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
 		assert(pointers_for_ongoing_gc_operations.count(block) == 1);
 		pointers_for_ongoing_gc_operations[block].page++;
 	}
@@ -57,7 +57,7 @@ void bm_gc_locality::register_write_outcome(Event const& event, enum status stat
 	if (free_block_pointers[a.package][a.die].page + 1 == BLOCK_SIZE &&
 			a.compare(free_block_pointers[a.package][a.die]) >= BLOCK &&
 			get_num_free_blocks(a.package, a.die) <= 1) {
-		free_block_pointers[a.package][a.die] = Address();
+		set_block_pointer(a.package, a.die, Address(), event.get_current_time());
 	}
 
 	int temp = GREED_SCALE;
@@ -92,10 +92,10 @@ Address bm_gc_locality::get_block_for_gc(int package, int die, double current_ti
 	return find_free_unused_block(package, die, current_time);
 }
 
-bool bm_gc_locality::may_garbage_collect_this_block(Block* block, double current_time) {
+bool bm_gc_locality::may_garbage_collect_this_block(Block const& block, double current_time) {
 	int temp = GREED_SCALE;
 	GREED_SCALE = 0;
-	Address victim_addr = Address(block->get_physical_address(), BLOCK);
+	Address victim_addr = Address(block.get_physical_address(), BLOCK);
 
 	//Address a = get_block_for_gc(victim_addr.package, victim_addr.die, current_time);
 	//Address a = find_free_unused_block(victim_addr.package, victim_addr.die, current_time);
@@ -114,11 +114,11 @@ bool bm_gc_locality::may_garbage_collect_this_block(Block* block, double current
 void bm_gc_locality::register_erase_outcome(Event& event, enum status status) {
 
 	Address block_addr = event.get_address();
-	Block* block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
+	Block block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
 	assert(pointers_for_ongoing_gc_operations.count(block) == 1);
 	Address partially_free_block = pointers_for_ongoing_gc_operations.at(block);
 	if (has_free_pages(partially_free_block) && !has_free_pages(free_block_pointers[partially_free_block.package][partially_free_block.die])) {
-		free_block_pointers[partially_free_block.package][partially_free_block.die] = partially_free_block;
+		set_block_pointer(partially_free_block.package, partially_free_block.die, partially_free_block, event.get_current_time());
 	}
 	else if (has_free_pages(partially_free_block)) {
 		partially_used_blocks[partially_free_block.package][partially_free_block.die].push(partially_free_block);
@@ -129,7 +129,7 @@ void bm_gc_locality::register_erase_outcome(Event& event, enum status status) {
 	Address a = event.get_address();
 
 	if (!has_free_pages(free_block_pointers[a.package][a.die]) && get_num_free_blocks(a.package, a.die) > 1) {
-		free_block_pointers[a.package][a.die] = find_free_unused_block(a.package, a.die, event.get_current_time());
+		set_block_pointer(a.package, a.die, find_free_unused_block(a.package, a.die, event.get_current_time()), event.get_current_time());
 		if (has_free_pages(free_block_pointers[a.package][a.die])) {
 			Free_Space_Per_LUN_Meter::mark_new_space(a, event.get_current_time());
 		}
@@ -144,7 +144,7 @@ void bm_gc_locality::check_if_should_trigger_more_GC(Event const& event) {
 			if (!has_free_pages(free_block_pointers[i][j]) && partially_used_blocks[i][j].size() > 0) {
 				Address pointer = partially_used_blocks[i][j].front();
 				partially_used_blocks[i][j].pop();
-				free_block_pointers[i][j] = pointer;
+				set_block_pointer(i, j, pointer, event.get_current_time());
 				printf("made swap!\n");
 			}
 			/*else if (!has_free_pages(free_block_pointers[i][j]) ) {
@@ -173,7 +173,7 @@ Address bm_gc_locality::choose_best_address(Event& write) {
 		ftl->set_replace_address(write);
 	}
 	Address block_addr = write.get_replace_address();
-	Block* block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
+	Block block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
 	assert(pointers_for_ongoing_gc_operations.count(block) == 1);
 	Address& pointer = pointers_for_ongoing_gc_operations.at(block);
 	assert(has_free_pages(pointer));
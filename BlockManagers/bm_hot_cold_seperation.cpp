@@ -40,7 +40,7 @@ void Shortest_Queue_Hot_Cold_BM::register_erase_outcome(Event& event, enum statu
 	// TODO: Need better logic for this assignment. Easiest to remember some state.
 	// when we trigger GC for a cold pointer, remember which block was chosen.
 	if (!has_free_pages(free_block_pointers[addr.package][addr.die])) {
-		free_block_pointers[addr.package][addr.die] = find_free_unused_block(addr.package, addr.die, YOUNG, event.get_current_time());
+		set_block_pointer(addr.package, addr.die, find_free_unused_block(addr.package, addr.die, YOUNG, event.get_current_time()), event.get_current_time());
 	}
 	else if (!has_free_pages(cold_pointer)) {
 		cold_pointer = find_free_unused_block(OLD, event.get_current_time());
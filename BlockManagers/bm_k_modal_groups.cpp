@@ -57,9 +57,7 @@ void Block_Manager_Groups::init(Ssd* ssd, FtlParent* ftl, IOScheduler* sched, Ga
 	Block_manager_parent::init(ssd, ftl, sched, gc, wl, m);
 	for (int i = 0; i < SSD_SIZE; i++) {
 		for (int j = 0; j < PACKAGE_SIZE; j++) {
-			Address a = free_block_pointers[i][j];
-			free_blocks[i][j][0].push_back(a);
-			free_block_pointers[i][j] = Address();
+			set_block_pointer(i, j, Address(), 0);
 		}
 	}
 	assert(get_num_free_blocks() == SSD_SIZE * PACKAGE_SIZE * PLANE_SIZE);
@@ -509,7 +507,7 @@ void Block_Manager_Groups::handle_block_out_of_space(Event const& event, int gro
 	try_to_allocate_block_to_group(group_id, package, die, event.get_current_time());
 }
 
-bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double current_time) {
+bool Block_Manager_Groups::may_garbage_collect_this_block(Block const& block, double current_time) {
 	int group_id = UNDEFINED;
 	int ongoing_gc = 0;
 
@@ -526,7 +524,7 @@ bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double c
 		}
 	}
 
-	Address addr = Address(block->get_physical_address(), BLOCK);
+	Address addr = Address(block.get_physical_address(), BLOCK);
 
 	assert(group_id != UNDEFINED);
 	if (groups[group_id].blocks_being_garbage_collected.count(block) == 1) {
@@ -548,7 +546,7 @@ bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double c
 	}
 
 	// ENABLE when using the temperature detector. This is useful during group creation
-	if (block->get_pages_valid() > groups[group_id].get_avg_pages_per_block_per_die()) {
+	if (block.get_pages_valid() > groups[group_id].get_avg_pages_per_block_per_die()) {
 		//return false;
 	}
 
@@ -577,20 +575,20 @@ bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double c
 		return false;
 	}
 
-	if (block->get_pages_valid() > groups[group_id].size / groups[group_id].block_ids.size()) {
+	if (block.get_pages_valid() > groups[group_id].size / groups[group_id].block_ids.size()) {
 		//printf("working\n");
 		//return false;
 	}
 
 	if (group_id == 0) {
-		//printf("%d  %d  %d  %d \n", group_id, addr.package, addr.die, block->get_pages_valid());
+		//printf("%d  %d  %d  %d \n", group_id, addr.package, addr.die, block.get_pages_valid());
 	}
 
 	/*double over_prov = (groups[group_id].block_ids.size() * BLOCK_SIZE - groups[group_id].size) / groups[group_id].size;
 	double expected_num_migrations = exp(- 0.9 * over_prov) / (over_prov + 1);
 	expected_num_migrations *= BLOCK_SIZE;
 
-	if (block->get_pages_valid() > expected_num_migrations * 1.5) {
+	if (block.get_pages_valid() > expected_num_migrations * 1.5) {
 		printf("working\n");
 		return false;
 	}*/
@@ -600,7 +598,7 @@ bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double c
 		double expected_num_migrations = exp(- 0.9 * over_prov) / (over_prov + 1);
 		expected_num_migrations *= BLOCK_SIZE;
 		printf("%d %d: valid pages: %d   expected: %f  num free blocks in lun:  %d    num group blocks in LUN: %d    in equib1:   %d  in equib2  %d     total pages: %d   num blocks: %d \n", addr.package, addr.die,
-				block->get_pages_valid(), expected_num_migrations, get_num_free_blocks(addr.package, addr.die), groups[group_id].blocks_queue_per_die[addr.package][addr.die].size(), groups[group_id].in_equilbirium(),
+				block.get_pages_valid(), expected_num_migrations, get_num_free_blocks(addr.package, addr.die), groups[group_id].blocks_queue_per_die[addr.package][addr.die].size(), groups[group_id].in_equilbirium(),
 				groups[0].in_equilbirium(), groups[group_id].num_pages, groups[group_id].block_ids.size());
 		int blocks_needed = (groups[group_id].OP + groups[group_id].size) / BLOCK_SIZE - groups[group_id].block_ids.size();
 		printf("total free blocks in SSD: %d   group 0:  %d    group 1:  %d    needs block: %d\n", get_num_free_blocks(), groups[0].block_ids.size(), groups[1].block_ids.size(), blocks_needed);
@@ -623,7 +621,7 @@ bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double c
 	}
 
 	/*if (group_id == 0) {
-		printf("issue gc in 0:  %d\t", block->get_pages_valid());
+		printf("issue gc in 0:  %d\t", block.get_pages_valid());
 		addr.print();
 		printf("\tnum blocks: %d\tfree blocks: %d", groups[0].num_blocks_per_die[addr.package][addr.die], groups[0].free_blocks.get_num_free_blocks());
 		printf("\treserve blocks: %d", groups[0].next_free_blocks.get_num_free_blocks());
@@ -641,7 +639,7 @@ bool Block_Manager_Groups::may_garbage_collect_this_block(Block* block, double c
 	StatisticData::register_statistic(name, {
 			new Integer(StatisticsGatherer::get_global_instance()->total_writes()),
 			new Integer(group_id),
-			new Integer(block->get_pages_valid())
+			new Integer(block.get_pages_valid())
 	});
 
 	StatisticData::register_field_names(name, {
@@ -731,9 +729,9 @@ bool Block_Manager_Groups::trigger_gc_in_same_lun_but_different_group(int packag
 	int best_index = UNDEFINED;
 	for (auto i : order2) {
 		if (!groups[i].in_equilbirium() && !groups[i].needs_more_blocks()) {
-			Block* b = groups[i].get_gc_victim_greedy(package, die);
-			if (b != NULL && b->get_pages_valid() < num_pages_to_migrate && b->get_pages_valid() < BLOCK_SIZE * 0.8) {
-				num_pages_to_migrate = b->get_pages_valid();
+			Block b = groups[i].get_gc_victim_greedy(package, die);
+			if (!b.is_null() && b.get_pages_valid() < num_pages_to_migrate && b.get_pages_valid() < BLOCK_SIZE * 0.8) {
+				num_pages_to_migrate = b.get_pages_valid();
 				best_index = i;
 			}
 		}
@@ -761,7 +759,7 @@ bool Block_Manager_Groups::trigger_gc_in_same_lun_but_different_group(int packag
 
 void Block_Manager_Groups::register_erase_outcome(Event& event, enum status status) {
 	Address a = event.get_address();
-	Block* block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+	Block block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 	int group_id = UNDEFINED;
 	for (int i = 0; i < groups.size(); i++) {
 		if (groups[i].block_ids.count(block) == 1) {
@@ -839,7 +837,7 @@ void Block_Manager_Groups::check_if_should_trigger_more_GC(Event const& event) {
 
 void Block_Manager_Groups::request_gc(int group_id, int package, int die, double time) {
 	groups[group_id].stats.num_requested_gc++;
-	Block* b = NULL;
+	Block b;
 	if (garbage_collection_policy_within_groups == 0) {
 		b = groups[group_id].get_gc_victim_LRU(package, die);
 	}
@@ -849,8 +847,8 @@ void Block_Manager_Groups::request_gc(int group_id, int package, int die, double
 	else {
 		b = groups[group_id].get_gc_victim_window_greedy(package, die);
 	}
-	if (b != NULL) {
-		Address block_addr = Address(b->get_physical_address() , BLOCK);
+	if (!b.is_null()) {
+		Address block_addr = Address(b.get_physical_address() , BLOCK);
 		migrator->schedule_gc(time, package, die, block_addr.block, UNDEFINED);
 	}
 }
@@ -21,8 +21,8 @@ Block_manager_parent::Block_manager_parent(int num_age_classes)
  : ssd(NULL),
    ftl(NULL),
    free_block_pointers(SSD_SIZE, vector<Address>(PACKAGE_SIZE)),
+   multi_plane_stripes(SSD_SIZE, vector<vector<Address> >(PACKAGE_SIZE)),
    free_blocks(SSD_SIZE, vector<vector<deque<Address> > >(PACKAGE_SIZE, vector<deque<Address> >(num_age_classes, deque<Address>(0)) )),
-   all_blocks(0),
    num_age_classes(num_age_classes),
    num_free_pages(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE),
    num_available_pages_for_new_writes(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE),
@@ -42,6 +42,9 @@ void Block_manager_parent::init(Ssd* new_ssd, FtlParent* new_ftl, IOScheduler* n
 	ssd = new_ssd;
 	ftl = new_ftl;
 	scheduler = new_sched;
+	wl = new_wl;
+	gc = new_gc;
+	migrator = new_migrator;
 
 	for (uint i = 0; i < SSD_SIZE; i++) {
 		Package* package = ssd->get_package(i);
@@ -50,20 +53,15 @@ void Block_manager_parent::init(Ssd* new_ssd, FtlParent* new_ftl, IOScheduler* n
 			for (uint t = 0; t < DIE_SIZE; t++) {
 				Plane* plane = die->get_plane(t);
 				for (uint b = 0; b < PLANE_SIZE; b++) {
-					Block* block = plane->get_block(b);
-					free_blocks[i][j][0].push_back(Address(block->get_physical_address(), PAGE));
-					all_blocks.push_back(block);
+					free_blocks[i][j][0].push_back(Address(plane->get_block(b).get_physical_address(), PAGE));
 				}
 			}
 			Address pointer = free_blocks[i][j][0].back();
-			free_block_pointers[i][j] = pointer;
-			Free_Space_Per_LUN_Meter::mark_new_space(pointer, 0);
 			free_blocks[i][j][0].pop_back();
+			set_block_pointer(i, j, pointer, 0);
+			Free_Space_Per_LUN_Meter::mark_new_space(pointer, 0);
 		}
 	}
-	wl = new_wl;
-	gc = new_gc;
-	migrator = new_migrator;
 }
 
 Address Block_manager_parent::choose_copbyback_address(Event const& write) {
@@ -71,7 +69,7 @@ Address Block_manager_parent::choose_copbyback_address(Event const& write) {
 	if (!has_free_pages(free_block_pointers[ra.package][ra.die])) {
 		Address new_block = find_free_unused_block(ra.package, ra.die, write.get_current_time());
 		if (has_free_pages(new_block)) {
-			free_block_pointers[ra.package][ra.die] = new_block;
+			set_block_pointer(ra.package, ra.die, new_block, write.get_current_time());
 			Free_Space_Per_LUN_Meter::mark_new_space(new_block, write.get_current_time());
 		}
 	}
@@ -168,8 +166,8 @@ void Block_manager_parent::register_register_cleared() {
 }
 
 uint Block_manager_parent::sort_into_age_class(Address const& a) const {
-	Block* b = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
-	uint age = b->get_age();
+	Block b = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+	uint age = b.get_age();
 	double normalized_age = wl->get_normalised_age(age);
 	int klass = floor(normalized_age * num_age_classes * 0.99999);
 	return klass;
@@ -181,6 +179,67 @@ void Block_manager_parent::increment_pointer(Address& pointer) {
 	pointer = p;
 }
 
+// Moves a die's pointer past the page just written. When the pointer is part of a multi-plane stripe, it first moves to the
+// same page of the stripe's block in the next plane, so that consecutive writes to the die can be combined into one multi-plane write.
+void Block_manager_parent::advance_write_pointer(Address& pointer) {
+	vector<Address>& stripe = multi_plane_stripes[pointer.package][pointer.die];
+	for (uint i = 0; i < stripe.size(); i++) {
+		if (stripe[i].compare(pointer) < BLOCK) {
+			continue;
+		}
+		Address next = stripe[(i + 1) % stripe.size()];
+		next.page = i + 1 < stripe.size() ? pointer.page : pointer.page + 1;
+		pointer = next;
+		if (!has_free_pages(pointer)) {
+			stripe.clear();
+		}
+		return;
+	}
+	stripe.clear();
+	increment_pointer(pointer);
+}
+
+// Makes the block the pointer of its die. The blocks of the die's old pointer and stripe that still have free pages
+// are given back as unfilled blocks, and a new stripe is opened around the block.
+void Block_manager_parent::set_block_pointer(uint package_id, uint die_id, Address const& block, double time) {
+	vector<Address> old_blocks = multi_plane_stripes[package_id][die_id];
+	Address old_pointer = free_block_pointers[package_id][die_id];
+	if (old_pointer.valid != NONE && find_if(old_blocks.begin(), old_blocks.end(), [&](Address const& a) { return a.compare(old_pointer) >= BLOCK; }) == old_blocks.end()) {
+		old_blocks.push_back(old_pointer);
+	}
+	free_block_pointers[package_id][die_id] = open_multi_plane_stripe(package_id, die_id, block, time);
+	for (uint i = 0; i < old_blocks.size(); i++) {
+		Address a = old_blocks[i];
+		if (a.valid == NONE || a.compare(block) >= BLOCK) {
+			continue;
+		}
+		// The stripe only remembers where its blocks start, so their first free page is read from the blocks themselves
+		Block b = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+		a.page = b.get_pages_valid() + b.get_pages_invalid();
+		a.valid = PAGE;
+		return_unfilled_block(a, time, false);
+	}
+}
+
+// Takes a free block in each of the other planes of the block's die, so that the die's pointer can stripe writes over the planes.
+// Returns the new pointer of the die. The die's old stripe is forgotten even if the block has no free pages, since its
+// blocks have been given back already. The die is passed in, since the block is Address() when the die is left without a
+// pointer.
+Address Block_manager_parent::open_multi_plane_stripe(uint package_id, uint die_id, Address const& block, double time) {
+	vector<Address>& stripe = multi_plane_stripes[package_id][die_id];
+	stripe.clear();
+	if (!has_free_pages(block) || !ENABLE_MULTI_PLANE_OPERATIONS || DIE_SIZE == 1 || block.page != 0) {
+		return block;
+	}
+	for (uint plane = 0; plane < DIE_SIZE; plane++) {
+		Address a = plane == block.plane ? block : find_free_unused_block_in_plane(block.package, block.die, plane, time);
+		if (has_free_pages(a)) {
+			stripe.push_back(a);
+		}
+	}
+	return stripe.front();
+}
+
 void Block_manager_parent::register_write_outcome(Event const& event, enum status status) {
 	IO_has_completed_since_last_shortest_queue_search = true;
 
@@ -202,14 +261,14 @@ void Block_manager_parent::register_write_outcome(Event const& event, enum statu
 
 	Address ba = event.get_address();
 	if (ba.compare(free_block_pointers[ba.package][ba.die]) >= BLOCK) {
-		increment_pointer(free_block_pointers[ba.package][ba.die]);
+		advance_write_pointer(free_block_pointers[ba.package][ba.die]);
 		if (!has_free_pages(free_block_pointers[ba.package][ba.die])) {
 			if (PRINT_LEVEL > 1) {
 				printf("hot pointer "); free_block_pointers[ba.package][ba.die].print(); printf(" is out of space");
 			}
 			Address free_pointer = find_free_unused_block(ba.package, ba.die, YOUNG, event.get_current_time());
 			if (has_free_pages(free_pointer)) {
-				free_block_pointers[ba.package][ba.die] = free_pointer;
+				set_block_pointer(ba.package, ba.die, free_pointer, event.get_current_time());
 			}
 			if (PRINT_LEVEL > 1) {
 				if (free_pointer.valid == NONE) printf(", and a new unused block could not be found.\n");
@@ -331,7 +390,8 @@ pair<bool, pair<int, int> > Block_manager_parent::get_free_block_pointer_with_sh
 			if (die_has_free_pages && !die_register_is_busy) {
 				can_write = true;
 				double channel_finish_time = ssd->get_currently_executing_operation_finish_time(channel_id);
-				double die_finish_time = ssd->get_package(channel_id)->get_die(die_id)->get_currently_executing_io_finish_time();
+				Die* die = ssd->get_package(channel_id)->get_die(die_id);
+				double die_finish_time = die->get_ready_time(pointer, WRITE, channel_finish_time);
 				double max = std::max(channel_finish_time,die_finish_time);
 
 				if (die_finish_time < earliest_die_finish_time) {
@@ -372,6 +432,7 @@ bool Block_manager_parent::Copy_backs_in_progress(Address const& addr) {
 }
 
 // gives time until both the channel and die are clear
+// the die is clear for an operation that can join the multi-plane operation it is executing, or wait in its cache register
 double Block_manager_parent::in_how_long_can_this_event_be_scheduled(Address const& address, double event_time, event_type type) const {
 	if (address.valid == NONE) {
 		return BUS_DATA_DELAY + BUS_CTRL_DELAY;
@@ -379,11 +440,12 @@ double Block_manager_parent::in_how_long_can_this_event_be_scheduled(Address con
 
 	uint package_id = address.package;
 	uint die_id = address.die;
+	Die* die = ssd->get_package(package_id)->get_die(die_id);
 	double channel_finish_time = ssd->get_currently_executing_operation_finish_time(package_id);
-	double die_finish_time = ssd->get_package(package_id)->get_die(die_id)->get_currently_executing_io_finish_time();
+	double die_finish_time = die->get_ready_time(address, type, fmax(event_time, channel_finish_time));
 	double max_time = max(channel_finish_time, die_finish_time);
 	double time = fmax(0.0, max_time - event_time);
-	if (type == WRITE) {
+	if (type == WRITE || type == COPY_BACK) {
 		time = fmin(time, BUS_DATA_DELAY + BUS_CTRL_DELAY);
 		return time; // in_how_long_can_this_write_be_scheduled(event_time);
 	}
@@ -428,15 +490,27 @@ void Block_manager_parent::update_next_possible_write_time() const {
 	soonest_write_time = min_execution_time;
 }
 
+// Each plane has its own registers, so a read command only needs room in the registers of its plane
 bool Block_manager_parent::can_schedule_on_die(Address const& address, event_type type, uint app_io_id) const {
 	uint package_id = address.package;
 	uint die_id = address.die;
-	bool busy = ssd->get_package(package_id)->get_die(die_id)->register_is_busy();
+	Die* die = ssd->get_package(package_id)->get_die(die_id);
+	bool busy = die->register_is_busy();
 	if (!busy) {
 		return true;
 	}
-	uint application_io = ssd->get_package(package_id)->get_die(die_id)->get_last_read_application_io();
-	return (type == READ_TRANSFER || type == COPY_BACK ) && application_io == app_io_id;
+	if (type == READ_COMMAND && (ENABLE_MULTI_PLANE_OPERATIONS || ENABLE_CACHE_MODE)) {
+		return !die->register_is_busy(address.plane);
+	}
+	if (type != READ_TRANSFER && type != COPY_BACK) {
+		return false;
+	}
+	for (uint plane = 0; plane < DIE_SIZE; plane++) {
+		if (die->register_holds(plane, app_io_id)) {
+			return true;
+		}
+	}
+	return false;
 }
 
 bool Block_manager_parent::is_die_register_busy(Address const& addr) const {
@@ -455,9 +529,9 @@ bool Block_manager_parent::can_schedule_write_immediately(Address const& prospec
 
 // puts free blocks at the very end of the queue
 struct block_valid_pages_comparator_wearwolf {
-	bool operator () (const Block * i, const Block * j)
+	bool operator () (Block const& i, Block const& j)
 	{
-		return i->get_pages_invalid() > j->get_pages_invalid();
+		return i.get_pages_invalid() > j.get_pages_invalid();
 	}
 };
 
@@ -533,6 +607,27 @@ Address Block_manager_parent::find_free_unused_block(uint package_id, uint die_i
 	return to_return;
 }
 
+// Takes an unwritten block from a particular plane, preferring young blocks. Returns Address() if the plane has no such block
+Address Block_manager_parent::find_free_unused_block_in_plane(uint package_id, uint die_id, uint plane_id, double time) {
+	Address to_return;
+	uint num_free_blocks_left = 0;
+	for (int i = 0; i < num_age_classes && to_return.valid == NONE; i++) {
+		deque<Address>& blocks = free_blocks[package_id][die_id][i];
+		for (int j = blocks.size() - 1; j >= 0; j--) {
+			if (blocks[j].plane == plane_id && blocks[j].page == 0) {
+				to_return = blocks[j];
+				blocks.erase(blocks.begin() + j);
+				num_free_blocks_left = blocks.size();
+				break;
+			}
+		}
+	}
+	if (num_free_blocks_left < GREED_SCALE) {
+		migrator->schedule_gc(time, package_id, die_id, -1, -1);
+	}
+	return to_return;
+}
+
 Address Block_manager_parent::find_free_unused_block(uint package, uint die, enum age age, double time) {
 	if (age == YOUNG) {
 		for (int i = 0; i < num_age_classes; i++) {
@@ -574,7 +669,7 @@ void Block_manager_parent::return_unfilled_block(Address pba, double current_tim
 		if (!give_to_block_pointers || has_free_pages(free_block_pointers[pba.package][pba.die])) {
 			free_blocks[pba.package][pba.die][age_class].push_back(pba);
 		} else {
-			free_block_pointers[pba.package][pba.die] = pba;
+			set_block_pointer(pba.package, pba.die, pba, current_time);
 			Free_Space_Per_LUN_Meter::mark_new_space(pba, current_time);
 		}
 	}
@@ -582,8 +677,8 @@ void Block_manager_parent::return_unfilled_block(Address pba, double current_tim
 
 void Block_manager_parent::copy_state(Block_manager_parent* bm) {
 	free_block_pointers = bm->free_block_pointers;
+	multi_plane_stripes = bm->multi_plane_stripes;
 	free_blocks = bm->free_blocks;
-	all_blocks = bm->all_blocks;
 	num_age_classes = bm->num_age_classes;
 	num_free_pages = bm->num_free_pages;
 	num_available_pages_for_new_writes = bm->num_available_pages_for_new_writes;
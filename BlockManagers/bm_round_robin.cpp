@@ -41,7 +41,7 @@ void Block_manager_roundrobin::register_erase_outcome(Event& event, enum status
 
 	// if there is no free pointer for this block, set it to this one.
 	if (!has_free_pages(free_block_pointers[a.package][a.die])) {
-		free_block_pointers[a.package][a.die] = find_free_unused_block(a.package, a.die);
+		set_block_pointer(a.package, a.die, find_free_unused_block(a.package, a.die, event.get_current_time()), event.get_current_time());
 	}
 
 	check_if_should_trigger_more_GC(event);
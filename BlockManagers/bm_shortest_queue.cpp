@@ -27,7 +27,7 @@ void Block_manager_parallel::register_erase_outcome(Event& event, enum status st
 	Address a = event.get_address();
 
 	if (!has_free_pages(free_block_pointers[a.package][a.die])) {
-		free_block_pointers[a.package][a.die] = find_free_unused_block(a.package, a.die, event.get_current_time());
+		set_block_pointer(a.package, a.die, find_free_unused_block(a.package, a.die, event.get_current_time()), event.get_current_time());
 		if (has_free_pages(free_block_pointers[a.package][a.die])) {
 			Free_Space_Per_LUN_Meter::mark_new_space(a, event.get_current_time());
 		}
@@ -28,7 +28,7 @@ group::group(double prob, double size, Block_manager_parent* bm, Ssd* ssd, int i
 			num_pages_per_die(SSD_SIZE, vector<int>(PACKAGE_SIZE, 0)),
 			num_blocks_ever_given(SSD_SIZE, vector<int>(PACKAGE_SIZE, 0)),
 			num_blocks_per_die(SSD_SIZE, vector<int>(PACKAGE_SIZE, 0)),
-			blocks_queue_per_die(SSD_SIZE, vector<vector<Block*> >(PACKAGE_SIZE, vector<Block*>())),
+			blocks_queue_per_die(SSD_SIZE, vector<vector<Block> >(PACKAGE_SIZE, vector<Block>())),
 			stats_gatherer(StatisticsGatherer()),
 			index(index), ssd(ssd), id(id_generator++), num_app_writes(0) {
 	double PBA = NUMBER_OF_ADDRESSABLE_PAGES();
@@ -39,12 +39,12 @@ group::group(double prob, double size, Block_manager_parent* bm, Ssd* ssd, int i
 	for (int i = 0; i < SSD_SIZE; i++) {
 		for (int j = 0; j < PACKAGE_SIZE; j++) {
 			if (free_blocks.blocks[i][j].valid == PAGE) {
-				Block* block1 = ssd->get_package(free_blocks.blocks[i][j].package)->get_die(free_blocks.blocks[i][j].die)->get_plane(free_blocks.blocks[i][j].plane)->get_block(free_blocks.blocks[i][j].block);
+				Block block1 = ssd->get_package(free_blocks.blocks[i][j].package)->get_die(free_blocks.blocks[i][j].die)->get_plane(free_blocks.blocks[i][j].plane)->get_block(free_blocks.blocks[i][j].block);
 				block_ids.insert(block1);
 				num_blocks_per_die[i][j] += 1;
 			}
 			if (next_free_blocks.blocks[i][j].valid == PAGE) {
-				Block* block2 = ssd->get_package(next_free_blocks.blocks[i][j].package)->get_die(next_free_blocks.blocks[i][j].die)->get_plane(next_free_blocks.blocks[i][j].plane)->get_block(next_free_blocks.blocks[i][j].block);
+				Block block2 = ssd->get_package(next_free_blocks.blocks[i][j].package)->get_die(next_free_blocks.blocks[i][j].die)->get_plane(next_free_blocks.blocks[i][j].plane)->get_block(next_free_blocks.blocks[i][j].block);
 				block_ids.insert(block2);
 				num_blocks_per_die[i][j] += 1;
 			}
@@ -131,7 +131,7 @@ void group::print_die_spesific_info() const {
 
 void group::print_blocks_valid_pages() const {
 	for (auto b : block_ids) {
-		printf("%d ", b->get_pages_valid());
+		printf("%d ", b.get_pages_valid());
 	}
 	printf("\n");
 }
@@ -141,7 +141,7 @@ void group::print_blocks_valid_pages_per_die() const {
 		for (int j = 0; j < blocks_queue_per_die[i].size(); j++) {
 			printf("%d %d: ", i, j);
 			for (int b = 0; b < blocks_queue_per_die[i][j].size(); b++) {
-				printf("%d ", blocks_queue_per_die[i][j][b]->get_pages_valid());
+				printf("%d ", blocks_queue_per_die[i][j][b].get_pages_valid());
 			}
 			//assert(blocks_queue_per_die[i][j].size() == num_blocks_per_die[i][j]);
 			printf("\n");
@@ -473,7 +473,7 @@ void group::register_write_outcome(Event const& event) {
 	if (event.get_address().page == 0) {
 		Address a = event.get_address();
 		num_blocks_ever_given[a.package][a.die]++;
-		Block* block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+		Block block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 		blocks_queue_per_die[a.package][a.die].push_back(block);
 	}
 
@@ -483,7 +483,7 @@ void group::register_write_outcome(Event const& event) {
 
 void group::register_erase_outcome(Event& event) {
 	Address a = event.get_address();
-	Block* block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+	Block block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 	assert(block_ids.count(block) == 1);
 	block_ids.erase(block);
 	blocks_being_garbage_collected.erase(block);
@@ -500,45 +500,45 @@ void group::register_erase_outcome(Event& event) {
 	//blocks_queue_per_die[a.package][a.die].erase()
 }
 
-Block* group::get_gc_victim_LRU(int package, int die) const {
-	Block* b = blocks_queue_per_die[package][die].front();
-	Address a = Address(b->get_physical_address(), BLOCK);
+Block group::get_gc_victim_LRU(int package, int die) const {
+	Block b = blocks_queue_per_die[package][die].front();
+	Address a = Address(b.get_physical_address(), BLOCK);
 	for (int i = 0; i < blocks_queue_per_die[package][die].size(); i++) {
-		if (b->get_state() == ACTIVE && a.package == package && a.die == die) {
+		if (b.get_state() == ACTIVE && a.package == package && a.die == die) {
 			return b;
 		}
 	}
-	return NULL;
+	return Block();
 }
 
-Block* group::get_gc_victim_window_greedy(int package, int die) const {
+Block group::get_gc_victim_window_greedy(int package, int die) const {
 	double window_factor = PLANE_SIZE;
 	int win1 = 0.1 * PLANE_SIZE, win2 = blocks_queue_per_die[package][die].size();
 	int window_size = min(win1, win2);
 	int selected_index = 0;
 	int min_num_live_blocks = BLOCK_SIZE;
 	for (int i = 0; i < window_size; i++) {
-		Block* b = blocks_queue_per_die[package][die][i];
-		if (b->get_state() == ACTIVE && min_num_live_blocks >= b->get_pages_valid()) {
-			Address a = Address(b->get_physical_address(), BLOCK);
+		Block b = blocks_queue_per_die[package][die][i];
+		if (b.get_state() == ACTIVE && min_num_live_blocks >= b.get_pages_valid()) {
+			Address a = Address(b.get_physical_address(), BLOCK);
 			assert(a.package == package && a.die == die);
 			selected_index = i;
-			min_num_live_blocks = b->get_pages_valid();
+			min_num_live_blocks = b.get_pages_valid();
 		}
 	}
 	return blocks_queue_per_die[package][die][selected_index];
 }
 
-Block* group::get_gc_victim_greedy(int package, int die) const {
+Block group::get_gc_victim_greedy(int package, int die) const {
 	int min = BLOCK_SIZE;
-	Block* victim = NULL;
+	Block victim;
 	for (auto b : block_ids) {
-		Address a = Address(b->get_physical_address(), BLOCK);
-		if (b->get_pages_valid() < min && b->get_state() == ACTIVE && a.package == package && a.die == die) {
-			min = b->get_pages_valid();
+		Address a = Address(b.get_physical_address(), BLOCK);
+		if (b.get_pages_valid() < min && b.get_state() == ACTIVE && a.package == package && a.die == die) {
+			min = b.get_pages_valid();
 			victim = b;
 			/*if (id == 0) {
-				cout << b->get_pages_valid() << " ";
+				cout << b.get_pages_valid() << " ";
 			}*/
 		}
 	}
@@ -573,7 +573,7 @@ void group::accept_block(Address block_addr) {
 		next_free_blocks.blocks[block_addr.package][block_addr.die] = block_addr;
 	}
 	//else assert(false);
-	Block* block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
+	Block block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
 	block_ids.insert(block);
 	num_blocks_per_die[block_addr.package][block_addr.die]++;
 
@@ -594,7 +594,7 @@ void group::retire_active_blocks(double current_time) {
 	for (int i = 0; i < SSD_SIZE; i++) {
 		for (int j = 0; j < PACKAGE_SIZE; j++) {
 			Address a = free_blocks.blocks[i][j];
-			Block* block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+			Block block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 			block_ids.erase(block);
 			a = next_free_blocks.blocks[i][j];
 			block = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
@@ -17,7 +17,6 @@ Wear_Leveling_Strategy::Wear_Leveling_Strategy()
 	  average_erase_cycle_time(0),
 	  max_age(1),
 	  age_distribution(),
-	  all_blocks(),
 	  random_number_generator(90),
 	  block_data(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE, Block_data()) {
 
@@ -30,7 +29,6 @@ Wear_Leveling_Strategy::Wear_Leveling_Strategy(Ssd* ssd, Migrator* migrator)
 	  average_erase_cycle_time(0),
 	  max_age(1),
 	  age_distribution(),
-	  all_blocks(),
 	  random_number_generator(90),
 	  block_data(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE, Block_data())
 {
@@ -39,19 +37,6 @@ Wear_Leveling_Strategy::Wear_Leveling_Strategy(Ssd* ssd, Migrator* migrator)
 
 void Wear_Leveling_Strategy::init() {
 	age_distribution[0] = NUMBER_OF_ADDRESSABLE_BLOCKS();
-	for (uint i = 0; i < SSD_SIZE; i++) {
-			Package* package = ssd->get_package(i);
-			for (uint j = 0; j < PACKAGE_SIZE; j++) {
-				Die* die = package->get_die(j);
-				for (uint t = 0; t < DIE_SIZE; t++) {
-					Plane* plane = die->get_plane(t);
-					for (uint b = 0; b < PLANE_SIZE; b++) {
-						Block* block = plane->get_block(b);
-						all_blocks.push_back(block);
-					}
-				}
-			}
-		}
 }
 
 double Wear_Leveling_Strategy::get_min_age() const {
@@ -72,12 +57,12 @@ double Wear_Leveling_Strategy::get_normalised_age(uint age) const {
 void Wear_Leveling_Strategy::register_erase_completion(Event const& event) {
 	num_erases_up_to_date++;
 	Address pba = event.get_address();
-	Block* b = ssd->get_package(pba.package)->get_die(pba.die)->get_plane(pba.plane)->get_block(pba.block);
+	Block b = ssd->get_package(pba.package)->get_die(pba.die)->get_plane(pba.plane)->get_block(pba.block);
 
 	int id = pba.get_block_id();
 	Block_data& data = block_data[id];
 	data.age++;
-	assert(data.age == b->get_age());
+	assert(data.age == b.get_age());
 
 	if (data.age > max_age) {
 		max_age = data.age;
@@ -111,10 +96,9 @@ void Wear_Leveling_Strategy::register_erase_completion(Event const& event) {
 
 	if (blocks_to_wl.size() > 0 && blocks_being_wl.size() < MAX_ONGOING_WL_OPS) {
 		int random_index = random_number_generator() % blocks_to_wl.size();
-		set<Block*>::iterator i = blocks_to_wl.begin();
+		set<Block>::iterator i = blocks_to_wl.begin();
 		advance(i, random_index);
-		Block* target = *i;
-		Address addr = Address(target->get_physical_address(), BLOCK);
+		Address addr = Address(i->get_physical_address(), BLOCK);
 		if (PRINT_LEVEL > 1) {
 			printf("Scheduling WL in "); addr.print(); printf("\n");
 		}
@@ -122,7 +106,7 @@ void Wear_Leveling_Strategy::register_erase_completion(Event const& event) {
 	}
 }
 
-bool Wear_Leveling_Strategy::schedule_wear_leveling_op(Block* victim) {
+bool Wear_Leveling_Strategy::schedule_wear_leveling_op(Block const& victim) {
 	if (blocks_being_wl.size() >= MAX_ONGOING_WL_OPS) {
 		return false;
 	} else {
@@ -132,22 +116,24 @@ bool Wear_Leveling_Strategy::schedule_wear_leveling_op(Block* victim) {
 }
 
 /*void Wear_Leveling_Strategy::update_blocks_with_min_age(uint min_age) {
-	for (uint i = 0; i < all_blocks.size(); i++) {
-		Block* b = all_blocks[i];
-		uint age_ith_block = BLOCK_ERASES - b->get_erases_remaining();
+	for (uint i = 0; i < block_data.size(); i++) {
+		Address a = Address(i * BLOCK_SIZE, BLOCK);
+		Block b = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
+		uint age_ith_block = BLOCK_ERASES - b.get_erases_remaining();
 		if (age_ith_block == min_age) {
-			blocks_with_min_age.insert(all_blocks[i]);
+			blocks_with_min_age.insert(b);
 		}
 	}
 }*/
 
 void Wear_Leveling_Strategy::find_wl_candidates(double current_time) {
-	for (uint i = 0; i < all_blocks.size(); i++) {
-		Block* b = all_blocks[i];
+	for (uint i = 0; i < block_data.size(); i++) {
+		Address a = Address(i * BLOCK_SIZE, BLOCK);
+		Block b = ssd->get_package(a.package)->get_die(a.die)->get_plane(a.plane)->get_block(a.block);
 		Block_data& data = block_data[i];
 		double normalised_age = get_normalised_age(data.age);
 		double time_since_last_erase = current_time - data.last_erase_time;
-		if (b->get_state() == ACTIVE && normalised_age < 0.1 && time_since_last_erase  > average_erase_cycle_time * 10) {
+		if (b.get_state() == ACTIVE && normalised_age < 0.1 && time_since_last_erase  > average_erase_cycle_time * 10) {
 			blocks_to_wl.insert(b);
 		}
 	}
@@ -7,11 +7,16 @@
 using namespace ssd;
 int DFTL::ENTRIES_PER_TRANSLATION_PAGE = 1024;
 bool DFTL::SEPERATE_MAPPING_PAGES = true;
+int DFTL::MAX_PREFETCH_DEPTH = 64;
 
 DFTL::DFTL(Ssd *ssd, Block_manager_parent* bm) :
 		flash_resident_page_ftl(ssd, bm),
 		ongoing_mapping_operations(),
 		application_ios_waiting_for_translation(),
+		translation_pages_updated_by_gc(),
+		prefetch_ranges(),
+		prefetch_depth(0),
+		last_prefetched_address(UNDEFINED),
 		mapping_pages(NUMBER_OF_ADDRESSABLE_PAGES() / ENTRIES_PER_TRANSLATION_PAGE)
 {
 	IS_FTL_PAGE_MAPPING = true;
@@ -20,16 +25,20 @@ DFTL::DFTL(Ssd *ssd, Block_manager_parent* bm) :
 DFTL::DFTL() :
 		flash_resident_page_ftl(),
 		ongoing_mapping_operations(),
-		application_ios_waiting_for_translation()
+		application_ios_waiting_for_translation(),
+		translation_pages_updated_by_gc(),
+		prefetch_ranges(),
+		prefetch_depth(0),
+		last_prefetched_address(UNDEFINED)
 {
 	IS_FTL_PAGE_MAPPING = true;
 }
 
 DFTL::~DFTL(void)
 {
-	delete cache;
 	assert(application_ios_waiting_for_translation.size() == 0);
 	print();
+	delete cache;
 }
 
 
@@ -53,6 +62,9 @@ void DFTL::read(Event *event) {
 		return;
 	}
 
+	dftl_stats.num_read_misses++;
+	plan_prefetch(la);
+
 	// If there is no mapping IO currently targeting the translation page, create on. Otherwise, invoke current event when ongoing mapping IO finishes.
 	if (ongoing_mapping_operations.count(NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id) == 1) {
 		application_ios_waiting_for_translation[translation_page_id].push_back(event);
@@ -99,10 +111,52 @@ void DFTL::register_read_completion(Event const& event, enum status result) {
 		}
 		scheduler->schedule_event(e);
 	}
+	prefetch(translation_page_id);
 
 	try_clear_space_in_mapping_cache(event.get_current_time());
 }
 
+// A miss right after the entries prefetched for the previous miss means the reads are sequential, and doubles the number
+// of neighbouring entries to cache along with the missing one. Any other miss stops prefetching.
+void DFTL::plan_prefetch(long logical_address) {
+	if (MAX_PREFETCH_DEPTH <= 0) {
+		return;
+	}
+	if (logical_address == last_prefetched_address + 1) {
+		prefetch_depth = min(MAX_PREFETCH_DEPTH, max(1, 2 * prefetch_depth));
+	} else {
+		prefetch_depth = 0;
+	}
+	long translation_page_id = logical_address / ENTRIES_PER_TRANSLATION_PAGE;
+	long last_on_translation_page = (translation_page_id + 1) * ENTRIES_PER_TRANSLATION_PAGE - 1;
+	last_prefetched_address = min(logical_address + prefetch_depth, last_on_translation_page);
+	if (last_prefetched_address == logical_address) {
+		return;
+	}
+	auto range = prefetch_ranges.find(translation_page_id);
+	if (range == prefetch_ranges.end()) {
+		prefetch_ranges[translation_page_id] = make_pair(logical_address + 1, last_prefetched_address);
+	} else {
+		range->second.first = min(range->second.first, logical_address + 1);
+		range->second.second = max(range->second.second, last_prefetched_address);
+	}
+}
+
+// Caches the planned neighbours of missing entries once their translation page is in RAM. They are clean, so they never
+// need to be written back.
+void DFTL::prefetch(long translation_page_id) {
+	auto range = prefetch_ranges.find(translation_page_id);
+	if (range == prefetch_ranges.end()) {
+		return;
+	}
+	for (long i = range->second.first; i <= range->second.second; i++) {
+		if (page_mapping->get_physical_address(i).valid != NONE && cache->prefetch(i)) {
+			dftl_stats.num_prefetched_entries++;
+		}
+	}
+	prefetch_ranges.erase(range);
+}
+
 void DFTL::notify_garbage_collector(int translation_page_id, double time) {
 	if (gc == NULL) {
 		return;
@@ -110,14 +164,14 @@ void DFTL::notify_garbage_collector(int translation_page_id, double time) {
 	long first_key_in_translation_page = translation_page_id * ENTRIES_PER_TRANSLATION_PAGE;
 	for (int i = first_key_in_translation_page;
 			i < first_key_in_translation_page + ENTRIES_PER_TRANSLATION_PAGE; ++i) {
-		if (cache->contains(i) && cache->cached_mapping_table[i].synch_flag == false) {
-			Address old_address = mapping_pages[translation_page_id].entries[i];
+		if (cache->contains(i) && !cache->is_synchronized(i)) {
+			Address old_address = mapping_pages[translation_page_id].get(i - first_key_in_translation_page);
 			if (old_address.valid == PAGE) {
 				Address current_address = page_mapping->get_physical_address(i);
 				assert(old_address.compare(current_address) != PAGE);
 				gc->invalid_address_notification(old_address, time);
 			}
-			cache->cached_mapping_table[i].synch_flag = true;
+			cache->set_synchronized(i);
 		}
 	}
 
@@ -151,11 +205,13 @@ void DFTL::register_write_completion(Event const& event, enum status result) {
 		int i = 0;
 		i++;
 	}
-	if (event.is_original_application_io() && gc != NULL && cache->contains(event.get_logical_address())) {
+	// A page of the write buffer is host data on its way to flash, so its mapping is updated as that of a host write
+	bool host_data = event.is_original_application_io() || event.is_buffer_flush();
+	if (host_data && gc != NULL && cache->contains(event.get_logical_address())) {
 		Address pa = page_mapping->get_physical_address(event.get_logical_address());
 		gc->invalid_address_notification(pa, event.get_current_time());
 	}
-	if (event.is_original_application_io()) {
+	if (host_data) {
 		cache->register_write_arrival(event);	// caution. Moved this here from the write method. may lead to other problems.
 	}
 	if (event.is_garbage_collection_op()) {
@@ -165,6 +221,13 @@ void DFTL::register_write_completion(Event const& event, enum status result) {
 	if (event.get_noop()) {
 		return;
 	}
+	// The mapping updates of a GC operation are written when it finishes
+	if (!event.is_mapping_op() && event.is_garbage_collection_op() && !event.is_original_application_io()) {
+		cache->register_write_completion(event);
+		translation_pages_updated_by_gc.insert(event.get_logical_address() / ENTRIES_PER_TRANSLATION_PAGE);
+		dftl_stats.num_gc_mapping_updates++;
+		return;
+	}
 	if (!event.is_mapping_op()) {
 		cache->register_write_completion(event);
 		try_clear_space_in_mapping_cache(event.get_current_time());
@@ -180,12 +243,10 @@ void DFTL::register_write_completion(Event const& event, enum status result) {
 	// mark all pages included as clean
 	mark_clean(translation_page_id, event);
 
-	mapping_pages[translation_page_id].entries.clear();
 	long first_key_in_translation_page = translation_page_id * ENTRIES_PER_TRANSLATION_PAGE;
-	for (int i = first_key_in_translation_page;
-			i < first_key_in_translation_page + ENTRIES_PER_TRANSLATION_PAGE; ++i) {
-		Address a = page_mapping->get_physical_address(i);
-		mapping_pages[translation_page_id].entries[i] = a;
+	for (int i = 0; i < ENTRIES_PER_TRANSLATION_PAGE; ++i) {
+		Address a = page_mapping->get_physical_address(first_key_in_translation_page + i);
+		mapping_pages[translation_page_id].set(i, a);
 	}
 
 
@@ -197,6 +258,7 @@ void DFTL::register_write_completion(Event const& event, enum status result) {
 		cache->handle_read_dependency(e);
 		scheduler->schedule_event(e);
 	}
+	prefetch(translation_page_id);
 	//try_clear_space_in_mapping_cache(event.get_current_time());
 }
 
@@ -279,7 +341,7 @@ void DFTL::mark_clean(long translation_page_id, Event const& event) {
 
 	StatisticData::register_statistic("dftl_cache_size", {
 			new Integer(StatisticsGatherer::get_global_instance()->total_writes()),
-			new Integer(cache->cached_mapping_table.size()),
+			new Integer(cache->size()),
 			new Integer(ftl_cache::CACHED_ENTRIES_THRESHOLD)
 	});
 
@@ -300,7 +362,7 @@ void DFTL::mark_clean(long translation_page_id, Event const& event) {
 void DFTL::try_clear_space_in_mapping_cache(double time) {
 	//while (cache.cached_mapping_table.size() >= CACHED_ENTRIES_THRESHOLD && flush_mapping(time, false));
 	cache->clear_clean_entries(time);
-	if (cache->cached_mapping_table.size() <= ftl_cache::CACHED_ENTRIES_THRESHOLD) {
+	if (cache->size() <= ftl_cache::CACHED_ENTRIES_THRESHOLD) {
 		return;
 	}
 	//flush_mapping(time, true);
@@ -314,50 +376,79 @@ void DFTL::try_clear_space_in_mapping_cache(double time) {
 	//victim_entry.hotness = SHRT_MAX;
 
 	long translation_page_id = victim / ENTRIES_PER_TRANSLATION_PAGE;
-		if (ongoing_mapping_operations.count(NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id) == 1) {
-			cache->eviction_queue_dirty.push(victim);
-			return;
-		}
+	if (ongoing_mapping_operations.count(NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id) == 1) {
+		return;
+	}
+	create_mapping_write(translation_page_id, time);
+}
 
-		// create mapping write
-		Event* mapping_event = new Event(WRITE, NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id, 1, time);
-		mapping_event->set_mapping_op(true);
-		if (SEPERATE_MAPPING_PAGES) {
-			int tag = BLOCK_MANAGER_ID == 5 ? NUMBER_OF_ADDRESSABLE_PAGES() * OVER_PROVISIONING_FACTOR + 1 : 1;
-			mapping_event->set_tag(tag);
-		}
+// The completion of a GC operation ends a batch of mapping updates. If the cache is over its size, the translation pages
+// they are on are read, updated and written, once each and those with the most dirty entries first, until it no longer is.
+void DFTL::register_erase_completion(Event & event) {
+	flush_gc_mapping_updates(event.get_current_time());
+}
 
-		// If a translation page on flash does not exist yet, we can flush without a read first
-		if( page_mapping->get_physical_address(NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id).valid == NONE ) {
-			application_ios_waiting_for_translation[translation_page_id] = vector<Event*>();
-			ongoing_mapping_operations.insert(mapping_event->get_logical_address());
-			scheduler->schedule_event(mapping_event);
-			//printf("submitting mapping write %d\n", translation_page_id);
-			return;
+void DFTL::flush_gc_mapping_updates(double time) {
+	cache->clear_clean_entries(time);
+	long excess = (long)cache->size() - ftl_cache::CACHED_ENTRIES_THRESHOLD;
+	vector<pair<uint, long> > translation_pages;
+	if (excess > 0) {
+		for (auto translation_page_id : translation_pages_updated_by_gc) {
+			translation_pages.push_back(make_pair(cache->get_num_dirty_entries_on(translation_page_id), translation_page_id));
 		}
+	}
+	translation_pages_updated_by_gc.clear();
+	sort(translation_pages.rbegin(), translation_pages.rend());
+	for (uint i = 0; i < translation_pages.size() && excess > 0; i++) {
+		long translation_page_id = translation_pages[i].second;
+		if (translation_pages[i].first > 0 && ongoing_mapping_operations.count(NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id) == 0) {
+			dftl_stats.num_gc_mapping_writes++;
+			create_mapping_write(translation_page_id, time);
+			excess -= translation_pages[i].first;
+		}
+	}
+}
+
+void DFTL::create_mapping_write(long translation_page_id, double time) {
+	// create mapping write
+	Event* mapping_event = new Event(WRITE, NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id, 1, time);
+	mapping_event->set_mapping_op(true);
+	if (SEPERATE_MAPPING_PAGES) {
+		int tag = BLOCK_MANAGER_ID == 5 ? NUMBER_OF_ADDRESSABLE_PAGES() * OVER_PROVISIONING_FACTOR + 1 : 1;
+		mapping_event->set_tag(tag);
+	}
 
-		// If the translation page already exists, check if all entries belonging to it are in the cache.
-		long first_key_in_translation_page = translation_page_id * ENTRIES_PER_TRANSLATION_PAGE;
-		bool are_all_mapping_entries_cached = false;
+	// If a translation page on flash does not exist yet, we can flush without a read first
+	if( page_mapping->get_physical_address(NUMBER_OF_ADDRESSABLE_PAGES() - translation_page_id).valid == NONE ) {
+		application_ios_waiting_for_translation[translation_page_id] = vector<Event*>();
+		ongoing_mapping_operations.insert(mapping_event->get_logical_address());
+		scheduler->schedule_event(mapping_event);
+		//printf("submitting mapping write %d\n", translation_page_id);
+		return;
+	}
 
-		long last_addr = first_key_in_translation_page;
-		/*for (int i = first_key_in_translation_page; i < first_key_in_translation_page + ENTRIES_PER_TRANSLATION_PAGE; ++i) {
-			if (cache.cached_mapping_table.count(i) == 0) {
-				are_all_mapping_entries_cached = false;
-				break;
-			}
-		}*/
+	// If the translation page already exists, check if all entries belonging to it are in the cache.
+	long first_key_in_translation_page = translation_page_id * ENTRIES_PER_TRANSLATION_PAGE;
+	bool are_all_mapping_entries_cached = false;
 
-		if (are_all_mapping_entries_cached) {
-			application_ios_waiting_for_translation[translation_page_id] = vector<Event*>();
-			ongoing_mapping_operations.insert(mapping_event->get_logical_address());
-			//printf("submitting mapping write, all in RAM %d\n", translation_page_id);
-			scheduler->schedule_event(mapping_event);
-		}
-		else {
-			//printf("submitting mapping read, since not all entries are in RAM %d\n", translation_page_id);
-			create_mapping_read(translation_page_id, time, mapping_event);
+	long last_addr = first_key_in_translation_page;
+	/*for (int i = first_key_in_translation_page; i < first_key_in_translation_page + ENTRIES_PER_TRANSLATION_PAGE; ++i) {
+		if (cache.cached_mapping_table.count(i) == 0) {
+			are_all_mapping_entries_cached = false;
+			break;
 		}
+	}*/
+
+	if (are_all_mapping_entries_cached) {
+		application_ios_waiting_for_translation[translation_page_id] = vector<Event*>();
+		ongoing_mapping_operations.insert(mapping_event->get_logical_address());
+		//printf("submitting mapping write, all in RAM %d\n", translation_page_id);
+		scheduler->schedule_event(mapping_event);
+	}
+	else {
+		//printf("submitting mapping read, since not all entries are in RAM %d\n", translation_page_id);
+		create_mapping_read(translation_page_id, time, mapping_event);
+	}
 }
 
 void DFTL::create_mapping_read(long translation_page_id, double time, Event* dependant) {
@@ -383,17 +474,17 @@ void DFTL::print_short() const {
 	int num_cold = 0;
 	int num_hot = 0;
 	int num_super_hot = 0;
-	for (auto i : cache->cached_mapping_table) {
-		if (i.second.dirty) num_dirty++;
-		if (!i.second.dirty) num_clean++;
-		if (i.second.fixed) num_fixed++;
-		if (i.second.hotness == 0) num_cold++;
-		if (i.second.hotness == 1) num_hot++;
-		if (i.second.hotness > 1) num_super_hot++;
-	}
-	printf("total: %d\tdirty: %d\tclean: %d\tfixed: %d\tcold: %d\thot: %d\tvery hot: %d\tnum ios: %d\n", cache->cached_mapping_table.size(), num_dirty, num_clean, num_fixed, num_cold, num_hot, num_super_hot, StatisticsGatherer::get_global_instance()->total_writes());
-	printf("clean queue: %d \t dirty queue %d \n", cache->eviction_queue_clean.size(), cache->eviction_queue_dirty.size());
-	printf("threshold: %d\t cache: %d\n", ftl_cache::CACHED_ENTRIES_THRESHOLD, cache->cached_mapping_table.size());
+	for (auto const& e : cache->get_entries()) {
+		if (e.key == UNDEFINED) continue;
+		if (e.dirty) num_dirty++;
+		if (!e.dirty) num_clean++;
+		if (e.fixed) num_fixed++;
+		if (e.hotness == 0) num_cold++;
+		if (e.hotness == 1) num_hot++;
+		if (e.hotness > 1) num_super_hot++;
+	}
+	printf("total: %d\tdirty: %d\tclean: %d\tfixed: %d\tcold: %d\thot: %d\tvery hot: %d\tnum ios: %d\n", cache->size(), num_dirty, num_clean, num_fixed, num_cold, num_hot, num_super_hot, StatisticsGatherer::get_global_instance()->total_writes());
+	printf("threshold: %d\t cache: %d\n", ftl_cache::CACHED_ENTRIES_THRESHOLD, cache->size());
 }
 
 // used for debugging
@@ -412,9 +503,9 @@ void DFTL::print() const {
 
 	// cluster by mapping page
 	map<int, int> bins;
-	for (auto i : cache->cached_mapping_table) {
+	for (auto const& e : cache->get_entries()) {
 		//long translation_page_id = la / ENTRIES_PER_TRANSLATION_PAGE;
-		bins[i.first / ENTRIES_PER_TRANSLATION_PAGE]++;
+		if (e.key != UNDEFINED) bins[e.key / ENTRIES_PER_TRANSLATION_PAGE]++;
 	}
 
 	printf("histogram1:");
@@ -441,6 +532,8 @@ void DFTL::print() const {
 		total += i.second;
 	}
 	//printf("total pages %d\n", total);
+	printf("mapping updates from GC: %ld\tmapping writes for them: %ld\n", dftl_stats.num_gc_mapping_updates, dftl_stats.num_gc_mapping_writes);
+	printf("read misses: %ld\tprefetched entries: %ld\n", dftl_stats.num_read_misses, dftl_stats.num_prefetched_entries);
 
 
 	/*printf("address histogram:");
@@ -25,18 +25,56 @@
 
 using namespace ssd;
 
+Sparse_Map::Sparse_Map(ulong size) :
+	leaves((size >> LEAF_BITS) + 1),
+	num_mapped((size >> LEAF_BITS) + 1, 0),
+	num_keys(size),
+	num_allocated_leaves(0)
+{}
+
+Sparse_Map::Sparse_Map() :
+	leaves(),
+	num_mapped(),
+	num_keys(0),
+	num_allocated_leaves(0)
+{}
+
+// Maps a key to a value, or unmaps it if the value is UNDEFINED
+void Sparse_Map::set(ulong key, long value) {
+	vector<long>& leaf = leaves[key >> LEAF_BITS];
+	uint& mapped = num_mapped[key >> LEAF_BITS];
+	if (leaf.empty()) {
+		if (value == UNDEFINED) {
+			return;
+		}
+		leaf.resize(LEAF_MASK + 1, UNDEFINED);
+		num_allocated_leaves++;
+	}
+	long& entry = leaf[key & LEAF_MASK];
+	if (entry == UNDEFINED && value != UNDEFINED) {
+		mapped++;
+	} else if (entry != UNDEFINED && value == UNDEFINED) {
+		mapped--;
+	}
+	entry = value;
+	if (mapped == 0) {
+		vector<long>().swap(leaf);
+		num_allocated_leaves--;
+	}
+}
+
 FtlImpl_Page::FtlImpl_Page(Ssd *ssd, Block_manager_parent* bm):
 	FtlParent(ssd, bm),
-	logical_to_physical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1, UNDEFINED),
-	physical_to_logical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1, UNDEFINED)
+	logical_to_physical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1),
+	physical_to_logical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1)
 {
 	IS_FTL_PAGE_MAPPING = true;
 }
 
 FtlImpl_Page::FtlImpl_Page() :
 	FtlParent(),
-	logical_to_physical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1, UNDEFINED),
-	physical_to_logical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1, UNDEFINED)
+	logical_to_physical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1),
+	physical_to_logical_map(NUMBER_OF_ADDRESSABLE_PAGES() + 1)
 {
 	IS_FTL_PAGE_MAPPING = true;
 }
@@ -68,12 +106,12 @@ void FtlImpl_Page::register_write_completion(Event const& event, enum status res
 	long new_phys_addr = event.get_address().get_linear_address();
 
 	long logi_addr = event.get_logical_address();
-	logical_to_physical_map[logi_addr] = new_phys_addr;
-	physical_to_logical_map[new_phys_addr] = logi_addr;
+	logical_to_physical_map.set(logi_addr, new_phys_addr);
+	physical_to_logical_map.set(new_phys_addr, logi_addr);
 
 	if (event.get_replace_address().valid == PAGE) {
 		long old_phys_addr = event.get_replace_address().get_linear_address();
-		physical_to_logical_map[old_phys_addr] = UNDEFINED;
+		physical_to_logical_map.set(old_phys_addr, UNDEFINED);
 	}
 }
 
@@ -84,17 +122,17 @@ void FtlImpl_Page::register_read_completion(Event const& event, enum status resu
 void FtlImpl_Page::register_trim_completion(Event & event) {
 	long phys_addr = event.get_replace_address().get_linear_address();
 	long logi_addr = event.get_logical_address();
-	logical_to_physical_map[logi_addr] = UNDEFINED;
-	physical_to_logical_map[phys_addr] = UNDEFINED;
+	logical_to_physical_map.set(logi_addr, UNDEFINED);
+	physical_to_logical_map.set(phys_addr, UNDEFINED);
 }
 
 long FtlImpl_Page::get_logical_address(uint physical_address) const {
-	return physical_to_logical_map[physical_address];
+	return physical_to_logical_map.get(physical_address);
 }
 
 Address FtlImpl_Page::get_physical_address(uint logical_address) const {
 	assert(logical_address <= logical_to_physical_map.size());
-	long phys_addr = logical_to_physical_map[logical_address];
+	long phys_addr = logical_to_physical_map.get(logical_address);
 	return phys_addr == UNDEFINED ? Address() : Address(phys_addr, PAGE);
 }
 
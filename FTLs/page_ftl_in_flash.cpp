@@ -16,20 +16,168 @@ using namespace ssd;
 
 int ftl_cache::CACHED_ENTRIES_THRESHOLD = 10000;
 
+// The table is sized for the threshold with some slack, since fixed and dirty entries can keep it above the threshold
+// for a while. It only grows if that slack runs out.
+ftl_cache::ftl_cache()
+	: entries(),
+	  free_slots(),
+	  index(),
+	  index_bits(1),
+	  num_entries(0),
+	  num_dirty(0),
+	  num_dirty_per_translation_page((NUMBER_OF_ADDRESSABLE_PAGES() + DFTL::ENTRIES_PER_TRANSLATION_PAGE - 1) / DFTL::ENTRIES_PER_TRANSLATION_PAGE, 0)
+{
+	hands[0] = hands[1] = UNDEFINED;
+	uint capacity = CACHED_ENTRIES_THRESHOLD + CACHED_ENTRIES_THRESHOLD / 4 + 64;
+	while ((1u << index_bits) < 2 * capacity) {
+		index_bits++;
+	}
+	entries.resize(capacity);
+	index.resize(1u << index_bits, UNDEFINED);
+	free_slots.reserve(capacity);
+	for (int slot = capacity - 1; slot >= 0; slot--) {
+		free_slots.push_back(slot);
+	}
+}
+
+int ftl_cache::find_slot(long key) const {
+	uint mask = index.size() - 1;
+	for (uint i = hash(key); index[i] != UNDEFINED; i = (i + 1) & mask) {
+		if (entries[index[i]].key == key) {
+			return index[i];
+		}
+	}
+	return UNDEFINED;
+}
+
+// Creates an entry for a key that is not in the cache, and puts it behind the hand of its CLOCK
+int ftl_cache::insert(long key, bool dirty) {
+	if (free_slots.empty()) {
+		grow();
+	}
+	int slot = free_slots.back();
+	free_slots.pop_back();
+	uint mask = index.size() - 1;
+	uint i = hash(key);
+	while (index[i] != UNDEFINED) {
+		i = (i + 1) & mask;
+	}
+	index[i] = slot;
+	entries[slot] = entry();
+	entries[slot].key = key;
+	entries[slot].dirty = dirty;
+	link(slot);
+	num_entries++;
+	if (dirty) {
+		count_dirty_entry(key, 1);
+	}
+	return slot;
+}
+
+// Removes the entry from the index with a backward shift, so that no tombstones are left behind
+void ftl_cache::erase(int slot) {
+	uint mask = index.size() - 1;
+	uint hole = hash(entries[slot].key);
+	while (index[hole] != slot) {
+		hole = (hole + 1) & mask;
+	}
+	for (uint i = (hole + 1) & mask; index[i] != UNDEFINED; i = (i + 1) & mask) {
+		uint home = hash(entries[index[i]].key);
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			index[hole] = index[i];
+			hole = i;
+		}
+	}
+	index[hole] = UNDEFINED;
+	unlink(slot);
+	if (entries[slot].dirty) {
+		count_dirty_entry(entries[slot].key, -1);
+	}
+	entries[slot] = entry();
+	free_slots.push_back(slot);
+	num_entries--;
+}
+
+// Moves the entry to the CLOCK of dirty or clean entries
+void ftl_cache::set_dirty(int slot, bool dirty) {
+	if (entries[slot].dirty == dirty) {
+		return;
+	}
+	unlink(slot);
+	entries[slot].dirty = dirty;
+	link(slot);
+	count_dirty_entry(entries[slot].key, dirty ? 1 : -1);
+}
+
+void ftl_cache::count_dirty_entry(long key, int change) {
+	num_dirty += change;
+	num_dirty_per_translation_page[key / DFTL::ENTRIES_PER_TRANSLATION_PAGE] += change;
+}
+
+void ftl_cache::link(int slot) {
+	entry& e = entries[slot];
+	int& hand = hands[e.dirty];
+	if (hand == UNDEFINED) {
+		e.prev = e.next = hand = slot;
+		return;
+	}
+	e.next = hand;
+	e.prev = entries[hand].prev;
+	entries[e.prev].next = slot;
+	entries[hand].prev = slot;
+}
+
+void ftl_cache::unlink(int slot) {
+	entry& e = entries[slot];
+	int& hand = hands[e.dirty];
+	if (e.next == slot) {
+		hand = UNDEFINED;
+	} else {
+		entries[e.prev].next = e.next;
+		entries[e.next].prev = e.prev;
+		if (hand == slot) {
+			hand = e.next;
+		}
+	}
+	e.prev = e.next = UNDEFINED;
+}
+
+// Doubles the table. Slots keep their numbers, so the CLOCKs are unchanged, and only the index is rebuilt.
+void ftl_cache::grow() {
+	uint old_capacity = entries.size();
+	entries.resize(2 * old_capacity);
+	for (int slot = entries.size() - 1; slot >= (int)old_capacity; slot--) {
+		free_slots.push_back(slot);
+	}
+	index_bits++;
+	index.assign(1u << index_bits, UNDEFINED);
+	uint mask = index.size() - 1;
+	for (uint slot = 0; slot < old_capacity; slot++) {
+		if (entries[slot].key == UNDEFINED) {
+			continue;
+		}
+		uint i = hash(entries[slot].key);
+		while (index[i] != UNDEFINED) {
+			i = (i + 1) & mask;
+		}
+		index[i] = slot;
+	}
+}
+
 void ftl_cache::register_write_arrival(Event const& event)
 {
 	int la = event.get_logical_address();
-	if (cached_mapping_table.count(la) == 1) {
-		entry& e = cached_mapping_table.at(la);
+	int slot = find_slot(la);
+	if (slot != UNDEFINED) {
+		entry& e = entries[slot];
 		e.hotness++;
 		e.fixed++;
 	}
 	else if (!event.is_mapping_op()) {
-		entry e;
+		entry& e = entries[insert(la, false)];
 		e.fixed = 1;
 		e.hotness = 1;
 		e.synch_flag = false;
-		cached_mapping_table[la] = e;
 	}
 	else {
 		assert(false);
@@ -37,24 +185,30 @@ void ftl_cache::register_write_arrival(Event const& event)
 }
 
 void ftl_cache::handle_read_dependency(Event* e) {
-	if (cached_mapping_table.count(e->get_logical_address()) == 0) {
-		ftl_cache::entry entry;
+	int slot = find_slot(e->get_logical_address());
+	if (slot == UNDEFINED) {
+		ftl_cache::entry& entry = entries[insert(e->get_logical_address(), false)];
 		entry.hotness++;
 		entry.synch_flag = true;
-		cached_mapping_table[e->get_logical_address()] = entry;
-		eviction_queue_clean.push(e->get_logical_address());
 	}
 	else {
-		ftl_cache::entry& entry = cached_mapping_table.at(e->get_logical_address());
-		entry.hotness++;
+		entries[slot].hotness++;
+	}
+}
+
+// Caches an entry read along with the translation page of another. It is cold, so it is among the first to go if it is not used.
+bool ftl_cache::prefetch(int key) {
+	if (find_slot(key) != UNDEFINED) {
+		return false;
 	}
+	entries[insert(key, false)].synch_flag = true;
+	return true;
 }
 
 bool ftl_cache::register_read_arrival(Event* app_read) {
-	int la = app_read->get_logical_address();
-	if (cached_mapping_table.count(la) == 1) {
-		ftl_cache::entry& e = cached_mapping_table.at(la);
-		e.hotness++;
+	int slot = find_slot(app_read->get_logical_address());
+	if (slot != UNDEFINED) {
+		entries[slot].hotness++;
 		return true;
 	}
 	return false;
@@ -62,27 +216,25 @@ bool ftl_cache::register_read_arrival(Event* app_read) {
 
 void ftl_cache::register_write_completion(Event const& event) {
 	assert(!event.is_mapping_op());
+	int slot = find_slot(event.get_logical_address());
 	if (event.is_garbage_collection_op() && !event.is_original_application_io()) {
-		if (cached_mapping_table.count(event.get_logical_address()) == 0) {
-			entry e;
+		if (slot == UNDEFINED) {
+			entry& e = entries[insert(event.get_logical_address(), true)];
 			e.timestamp = event.get_current_time();
-			e.dirty = true;
 			e.synch_flag = true;
-			cached_mapping_table[event.get_logical_address()] = e;
-			eviction_queue_dirty.push(event.get_logical_address());
 		}
 		else {
-			entry& e = cached_mapping_table.at(event.get_logical_address());
-			e.dirty = true;
+			set_dirty(slot, true);
+			entry& e = entries[slot];
 			e.timestamp = event.get_current_time();
 			e.fixed = 0;
 		}
 	}
-	else if (event.is_original_application_io()) {
-		entry& e = cached_mapping_table.at(event.get_logical_address());
+	else if (event.is_original_application_io() || event.is_buffer_flush()) {
+		assert(slot != UNDEFINED);
+		set_dirty(slot, true);
+		entry& e = entries[slot];
 		e.fixed = 0;
-		e.dirty = true;
-		eviction_queue_dirty.push(event.get_logical_address());
 		e.timestamp = event.get_current_time();
 	}
 	else {
@@ -91,35 +243,25 @@ void ftl_cache::register_write_completion(Event const& event) {
 	//try_clear_space_in_mapping_cache(event.get_current_time());
 }
 
-void ftl_cache::iterate(long& victim_key, entry& victim_entry, bool allow_choosing_dirty) {
-	queue<long>& queue = allow_choosing_dirty ? eviction_queue_dirty : eviction_queue_clean;
-	for (int i = 0; i < queue.size(); i++) {
-		long addr = queue.front();
-		queue.pop();
-		if (cached_mapping_table.count(addr) == 0) {
-			continue;
-		}
-		entry& e = cached_mapping_table.at(addr);
-		if (!allow_choosing_dirty && e.dirty) {
-			eviction_queue_dirty.push(addr);
-		}
-		else if (allow_choosing_dirty && !e.dirty) {
-			eviction_queue_clean.push(addr);
-		}
-		else if (!e.fixed && e.hotness == 0) {
-			victim_key = addr;
-			victim_entry = e;
-			return;
-		}
-		else if (e.dirty == allow_choosing_dirty) {
-			e.hotness = e.hotness == 0 ? 0 : e.hotness - 1;
-			queue.push(addr);
+// Advances the hand of the CLOCK of clean or dirty entries by at most one revolution, cooling the entries it passes,
+// and stops at the first entry that is cold and not fixed.
+int ftl_cache::find_victim(bool dirty) {
+	int& hand = hands[dirty];
+	uint clock_size = dirty ? num_dirty : num_entries - num_dirty;
+	for (uint i = 0; i < clock_size; i++) {
+		int slot = hand;
+		entry& e = entries[slot];
+		hand = e.next;
+		if (!e.fixed && e.hotness == 0) {
+			return slot;
 		}
+		e.hotness = e.hotness == 0 ? 0 : e.hotness - 1;
 	}
+	return UNDEFINED;
 }
 
 void ftl_cache::clear_clean_entries(double time) {
-	while (cached_mapping_table.size() >= CACHED_ENTRIES_THRESHOLD && erase_victim(time, false) != UNDEFINED);
+	while (num_entries >= CACHED_ENTRIES_THRESHOLD && erase_victim(time, false) != UNDEFINED);
 }
 
 int ftl_cache::choose_dirty_victim(double time) {
@@ -127,38 +269,44 @@ int ftl_cache::choose_dirty_victim(double time) {
 }
 
 bool ftl_cache::mark_clean(int key, double time) {
-	if (cached_mapping_table.count(key) == 0) {
+	int slot = find_slot(key);
+	if (slot == UNDEFINED) {
 		return false;
 	}
-	ftl_cache::entry& e = cached_mapping_table.at(key);
+	ftl_cache::entry& e = entries[slot];
 	bool was_dirty = e.dirty;
 	assert(e.fixed >= 0);
 	if (e.timestamp <= time && e.hotness == 0 && e.fixed == 0) {
-		cached_mapping_table.erase(key);
+		erase(slot);
 	}
 	else if (e.timestamp <= time && e.dirty) {
-		e.dirty = false;
+		set_dirty(slot, false);
 	}
 	return was_dirty;
 }
 
 bool ftl_cache::contains(int key) const {
-	return cached_mapping_table.count(key) == 1;
+	return find_slot(key) != UNDEFINED;
+}
+
+bool ftl_cache::is_synchronized(int key) const {
+	int slot = find_slot(key);
+	return slot != UNDEFINED && entries[slot].synch_flag;
 }
 
 void ftl_cache::set_synchronized(int key) {
-	if (cached_mapping_table.count(key) == 1) {
-		ftl_cache::entry& e = cached_mapping_table.at(key);
-		e.synch_flag = true;
+	int slot = find_slot(key);
+	if (slot != UNDEFINED) {
+		entries[slot].synch_flag = true;
 	}
 }
 
 void flash_resident_page_ftl::update_bitmap(vector<bool>& bitmap, Address block_addr) {
 	int block_id = block_addr.get_block_id();
-	Block* block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
+	Block block = ssd->get_package(block_addr.package)->get_die(block_addr.die)->get_plane(block_addr.plane)->get_block(block_addr.block);
 	for (int i = 0; i < BLOCK_SIZE; i++) {
 		int log_addr = page_mapping->get_logical_address(block_id * BLOCK_SIZE + i);
-		int orig_logical_addr = block->get_page(i).get_logical_addr();
+		int orig_logical_addr = block.get_page(i).get_logical_addr();
 		if (log_addr == UNDEFINED && bitmap[i] == true) {
 			bitmap[i] = false;
 
@@ -185,35 +333,25 @@ void flash_resident_page_ftl::set_synchronized(int logical_address) {
 
 // Uses a clock entry replacement policy
 int ftl_cache::erase_victim(double time, bool allow_flushing_dirty) {
-	//printf("flush called. num dirty: %d     cache size: %d\n", get_num_dirty_entries(), cached_mapping_table.size());
-	// start at a given location
-	// find first entry with hotness 0 and make that the target, or make full traversal and identify least hot entry
-	long victim = UNDEFINED;
-	entry victim_entry;
-	victim_entry.hotness = SHRT_MAX;
-
-	iterate(victim, victim_entry, allow_flushing_dirty);
-
-	if (victim == -1) {
+	int slot = find_victim(allow_flushing_dirty);
+	if (slot == UNDEFINED) {
 		//printf("Warning, could not find a victim to flush from cache\n");
 		return UNDEFINED;
 	}
 
-	// if entry is clean, just erase it. Otherwise, need some mapping IOs.
-	if (!victim_entry.dirty) {
-		//printf("erase %d\n", victim);
-		cached_mapping_table.erase(victim);
-		return victim;
+	// if entry is clean, just erase it. Otherwise, need some mapping IOs. A dirty victim stays in its CLOCK, behind the hand,
+	// until the mapping write marks it clean.
+	long victim = entries[slot].key;
+	if (!entries[slot].dirty) {
+		erase(slot);
 	}
 	return victim;
 }
 
 int ftl_cache::get_num_dirty_entries() const {
-	int num_dirty = 0;
-	for (auto i : cached_mapping_table) {
-		if (i.second.dirty) {
-			num_dirty++;
-		}
-	}
 	return num_dirty;
 }
+
+uint ftl_cache::get_num_dirty_entries_on(long translation_page_id) const {
+	return num_dirty_per_translation_page[translation_page_id];
+}
@@ -8,28 +8,95 @@
 #include "../ssd.h"
 using namespace ssd;
 
-int FIFO_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads) {
-	long double soonest_event_time = std::numeric_limits<long double>::max();
-	int thread_id_with_soonest_event = UNDEFINED;
-	for (auto i : threads) {
-		int id = i.first;
-		Thread* t = i.second;
-		Event* e = t->peek();
-		if (e != NULL && e->get_current_time() < soonest_event_time) {
-			soonest_event_time = e->get_current_time();
-			thread_id_with_soonest_event = id;
+// =================  Indexed_Min_Heap  =============================
+
+void Indexed_Min_Heap::set(int id, double key, double tie) {
+	if (id >= (int)position.size()) {
+		position.resize(id + 1, UNDEFINED);
+	}
+	if (position[id] == UNDEFINED) {
+		position[id] = heap.size();
+		heap.push_back(entry(key, tie, id));
+		sift_up(heap.size() - 1);
+		return;
+	}
+	uint i = position[id];
+	heap[i].key = key;
+	heap[i].tie = tie;
+	sift_up(i);
+	sift_down(position[id]);
+}
+
+void Indexed_Min_Heap::remove(int id) {
+	if (!contains(id)) {
+		return;
+	}
+	uint i = position[id];
+	uint last = heap.size() - 1;
+	swap_entries(i, last);
+	heap.pop_back();
+	position[id] = UNDEFINED;
+	if (i < heap.size()) {
+		int moved_id = heap[i].id;
+		sift_up(i);
+		sift_down(position[moved_id]);
+	}
+}
+
+void Indexed_Min_Heap::clear() {
+	heap.clear();
+	position.clear();
+}
+
+void Indexed_Min_Heap::swap_entries(uint i, uint j) {
+	std::swap(heap[i], heap[j]);
+	position[heap[i].id] = i;
+	position[heap[j].id] = j;
+}
+
+void Indexed_Min_Heap::sift_up(uint i) {
+	while (i > 0 && is_before(heap[i], heap[(i - 1) / 2])) {
+		swap_entries(i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+void Indexed_Min_Heap::sift_down(uint i) {
+	while (true) {
+		uint smallest = i;
+		uint left = 2 * i + 1, right = 2 * i + 2;
+		if (left < heap.size() && is_before(heap[left], heap[smallest])) smallest = left;
+		if (right < heap.size() && is_before(heap[right], heap[smallest])) smallest = right;
+		if (smallest == i) {
+			return;
 		}
+		swap_entries(i, smallest);
+		i = smallest;
+	}
+}
+
+// =================  FIFO_OS_Scheduler  =============================
+
+int FIFO_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads, double time) {
+	return ready.empty() ? UNDEFINED : ready.top();
+}
+
+void FIFO_OS_Scheduler::update(int thread_id, Thread const* thread) {
+	Event* next = thread->peek();
+	if (next == NULL) {
+		ready.remove(thread_id);
+	} else {
+		ready.set(thread_id, next->get_current_time());
 	}
-	return thread_id_with_soonest_event;
 }
 
-int FAIR_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads) {
+int FAIR_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads, double time) {
 
 	for (auto entry : threads)
 	{
 		Thread* t = entry.second;
 		Event* next = t->peek();
-		if (next != NULL && next->get_event_type() == TRIM ) {
+		if (next != NULL && next->get_event_type() == TRIM && is_shown(entry.first)) {
 			return entry.first;
 		}
 	}
@@ -45,7 +112,7 @@ int FAIR_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads) {
 		}
 		int new_id = (*i).first;
 		Thread* t = (*i).second;
-		if (t->peek() != NULL) {
+		if (t->peek() != NULL && is_shown(new_id)) {
 			found = true;
 		}
 		last_id = (*i).first;
@@ -53,3 +120,255 @@ int FAIR_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads) {
 	//printf("%d\n", last_id);
 	return !found ? UNDEFINED : last_id;
 }
+
+void FAIR_OS_Scheduler::update(int thread_id, Thread const* thread) {
+	if (thread_id >= (int)shown.size()) {
+		shown.resize(thread_id + 1, false);
+	}
+	shown[thread_id] = true;
+}
+
+void FAIR_OS_Scheduler::remove(int thread_id) {
+	if (thread_id < (int)shown.size()) {
+		shown[thread_id] = false;
+	}
+}
+
+// =================  QoS_OS_Scheduler  =============================
+
+void QoS_OS_Scheduler::token_bucket::init(double new_rate, double new_depth, double time) {
+	rate = new_rate;
+	depth = new_depth;
+	tokens = new_depth;
+	last_update = time;
+}
+
+// An IO larger than the bucket may go once the bucket is full
+double QoS_OS_Scheduler::token_bucket::get_ready_time(double time, double cost) const {
+	if (rate == 0) {
+		return time;
+	}
+	double needed = min(cost, depth);
+	double available = min(depth, tokens + (max(time, last_update) - last_update) * rate);
+	return available + 0.000001 >= needed ? time : max(time, last_update) + (needed - available) / rate;
+}
+
+void QoS_OS_Scheduler::token_bucket::consume(double time, double cost) {
+	if (rate == 0) {
+		return;
+	}
+	if (time > last_update) {
+		tokens = min(depth, tokens + (time - last_update) * rate);
+		last_update = time;
+	}
+	tokens -= cost;
+}
+
+double QoS_OS_Scheduler::get_release_time(tenant const& t, Event const* event) const {
+	double time = event->get_current_time();
+	double bytes = event->get_size() * PAGE_SIZE;
+	return max(t.iops_bucket.get_ready_time(time, event->get_size()), t.bandwidth_bucket.get_ready_time(time, bytes));
+}
+
+// Tenants released since the last pick are queued before choosing among the queued tenants
+int QoS_OS_Scheduler::pick(unordered_map<int, Thread*> const& threads, double time) {
+	while (!throttled.empty() && throttled.top_key() <= time) {
+		tenant const& t = *tenants_by_index[throttled.top()];
+		throttled.remove(t.index);
+		enqueue(t, get_head(t));
+	}
+	next_release_time = throttled.empty() ? INFINITE : throttled.top_key();
+	int index = choose(time);
+	return index == UNDEFINED ? UNDEFINED : tenants_by_index[index]->threads.top();
+}
+
+void QoS_OS_Scheduler::update(int thread_id, Thread const* thread) {
+	tenant& t = get_tenant(thread_id, thread);
+	Event const* next = thread->peek();
+	if (next == NULL) {
+		t.threads.remove(thread_id);
+	} else {
+		t.threads.set(thread_id, next->get_current_time());
+	}
+	reschedule(t);
+}
+
+void QoS_OS_Scheduler::remove(int thread_id) {
+	if (thread_id >= (int)thread_tenants.size() || thread_tenants[thread_id] == UNDEFINED) {
+		return;
+	}
+	tenant& t = *tenants_by_index[thread_tenants[thread_id]];
+	t.threads.remove(thread_id);
+	thread_table[thread_id] = NULL;
+	thread_tenants[thread_id] = UNDEFINED;
+	reschedule(t);
+}
+
+void QoS_OS_Scheduler::clear() {
+	tenants.clear();
+	tenants_by_index.clear();
+	thread_table.clear();
+	thread_tenants.clear();
+	throttled.clear();
+	next_release_time = INFINITE;
+}
+
+QoS_OS_Scheduler::tenant& QoS_OS_Scheduler::get_tenant(int thread_id, Thread const* thread) {
+	if (thread_id >= (int)thread_table.size()) {
+		thread_table.resize(thread_id + 1, NULL);
+		thread_tenants.resize(thread_id + 1, UNDEFINED);
+	}
+	thread_table[thread_id] = thread;
+	if (thread_tenants[thread_id] != UNDEFINED) {
+		return *tenants_by_index[thread_tenants[thread_id]];
+	}
+	int key = get_key(thread_id, thread);
+	auto it = tenants.find(key);
+	if (it == tenants.end()) {
+		Event const* next = thread->peek();
+		double time = next != NULL ? next->get_current_time() : 0;
+		tenant& t = tenants[key];
+		t.key = key;
+		t.index = tenants_by_index.size();
+		t.qos = thread->get_tenant_qos();
+		t.iops_bucket.init(t.qos.iops_limit / 1000000, max(t.qos.burst, 1.0), time);
+		t.bandwidth_bucket.init(t.qos.bandwidth_limit, max(t.qos.burst, 1.0) * PAGE_SIZE, time);
+		tenants_by_index.push_back(&t);
+		it = tenants.find(key);
+	}
+	thread_tenants[thread_id] = it->second.index;
+	return it->second;
+}
+
+Event const* QoS_OS_Scheduler::get_head(tenant const& t) const {
+	return t.threads.empty() ? NULL : thread_table[t.threads.top()]->peek();
+}
+
+// Queues the tenant according to its head IO. It is throttled if its tokens only allow the IO after the IO's own time.
+void QoS_OS_Scheduler::reschedule(tenant& t) {
+	dequeue(t);
+	throttled.remove(t.index);
+	Event const* head = get_head(t);
+	if (head == NULL) {
+		return;
+	}
+	double release_time = get_release_time(t, head);
+	if (release_time <= head->get_current_time()) {
+		enqueue(t, head);
+	} else {
+		throttled.set(t.index, release_time);
+	}
+}
+
+void QoS_OS_Scheduler::register_dispatch(int thread_id, Thread const* thread, Event const* event) {
+	if (thread_id >= (int)thread_tenants.size() || thread_tenants[thread_id] == UNDEFINED) {
+		return;
+	}
+	tenant& t = *tenants_by_index[thread_tenants[thread_id]];
+	double time = event->get_current_time();
+	t.iops_bucket.consume(time, event->get_size());
+	t.bandwidth_bucket.consume(time, event->get_size() * PAGE_SIZE);
+	// Tags are based on the time the thread issued the IO, so that OS queueing does not slow a tenant down further
+	charge(t, event->get_start_time(), event->get_size());
+	reschedule(t);
+}
+
+// =================  WFQ_OS_Scheduler  =============================
+
+void WFQ_OS_Scheduler::clear() {
+	QoS_OS_Scheduler::clear();
+	backlogged.clear();
+}
+
+// The start tag of a backlogged tenant never falls below the virtual time, since the virtual time is the start tag of
+// the tenant served last, which had the smallest one. So the tags in the heap stay right as the virtual time moves on.
+void WFQ_OS_Scheduler::enqueue(tenant const& t, Event const* head) {
+	backlogged.set(t.index, max(virtual_time, t.finish_tag), head->get_current_time());
+}
+
+void WFQ_OS_Scheduler::dequeue(tenant const& t) {
+	backlogged.remove(t.index);
+}
+
+// Serves the tenant with the smallest start tag
+int WFQ_OS_Scheduler::choose(double time) {
+	return backlogged.empty() ? UNDEFINED : backlogged.top();
+}
+
+void WFQ_OS_Scheduler::charge(tenant& t, double time, double cost) {
+	double start_tag = max(virtual_time, t.finish_tag);
+	t.finish_tag = start_tag + cost / t.qos.weight;
+	virtual_time = start_tag;
+}
+
+// =================  MClock_OS_Scheduler  =============================
+
+// Tags are in microseconds. An IO of a tenant at its limit is released when the limit tag is reached.
+double MClock_OS_Scheduler::get_release_time(tenant const& t, Event const* event) const {
+	double release_time = QoS_OS_Scheduler::get_release_time(t, event);
+	if (t.qos.limit > 0) {
+		double limit_tag = max(t.limit_tag + event->get_size() * 1000000 / t.qos.limit, event->get_current_time());
+		release_time = max(release_time, limit_tag);
+	}
+	return release_time;
+}
+
+double MClock_OS_Scheduler::get_reservation_tag(tenant const& t, double time, double cost) const {
+	return t.qos.reservation > 0 ? max(t.reservation_tag + cost * 1000000 / t.qos.reservation, time) : INFINITE;
+}
+
+void MClock_OS_Scheduler::clear() {
+	QoS_OS_Scheduler::clear();
+	by_reservation.clear();
+	by_weight.clear();
+}
+
+void MClock_OS_Scheduler::enqueue(tenant const& t, Event const* head) {
+	by_weight.set(t.index, max(virtual_time, t.proportional_tag), head->get_current_time());
+	if (t.qos.reservation > 0) {
+		by_reservation.set(t.index, get_reservation_tag(t, head->get_current_time(), head->get_size()), head->get_current_time());
+	}
+}
+
+void MClock_OS_Scheduler::dequeue(tenant const& t) {
+	by_weight.remove(t.index);
+	by_reservation.remove(t.index);
+}
+
+int MClock_OS_Scheduler::choose(double time) {
+	// Constraint based phase: the tenant furthest behind its reservation, if its reservation tag is due
+	picked_by_reservation = false;
+	if (!by_reservation.empty()) {
+		tenant const& t = *tenants_by_index[by_reservation.top()];
+		if (by_reservation.top_key() <= max(time, get_head(t)->get_current_time())) {
+			picked_by_reservation = true;
+			picked_key = t.key;
+			return t.index;
+		}
+	}
+	// Weight based phase
+	if (by_weight.empty()) {
+		return UNDEFINED;
+	}
+	picked_key = tenants_by_index[by_weight.top()]->key;
+	return by_weight.top();
+}
+
+void MClock_OS_Scheduler::charge(tenant& t, double time, double cost) {
+	bool served_by_reservation = picked_by_reservation && t.key == picked_key;
+	if (t.qos.reservation > 0) {
+		t.reservation_tag = get_reservation_tag(t, time, cost);
+	}
+	if (t.qos.limit > 0) {
+		t.limit_tag = max(t.limit_tag + cost * 1000000 / t.qos.limit, time);
+	}
+	if (!served_by_reservation) {
+		double start_tag = max(virtual_time, t.proportional_tag);
+		t.proportional_tag = start_tag + cost / t.qos.weight;
+		virtual_time = start_tag;
+		// IOs served by weight do not use up the reservation
+		if (t.qos.reservation > 0) {
+			t.reservation_tag -= cost * 1000000 / t.qos.reservation;
+		}
+	}
+}
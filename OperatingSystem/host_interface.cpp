@@ -0,0 +1,251 @@
+/*
+ * host_interface.cpp
+ *
+ *  NVMe-style submission/completion queue pairs between the operating system and the storage device.
+ */
+
+#include "../ssd.h"
+using namespace ssd;
+
+Host_Interface::queue_pair::queue_pair()
+	: priority(MEDIUM_PRIORITY),
+	  software_queue(),
+	  submission_queue(),
+	  completion_queue(),
+	  num_outstanding(0),
+	  interrupt_deadline(INFINITE),
+	  num_interrupts(0),
+	  latencies()
+{}
+
+Host_Interface::Host_Interface(OperatingSystem* os)
+	: os(os),
+	  queues(NVME_NUM_QUEUES),
+	  num_commands_in_device(0),
+	  time(0),
+	  current_queue(UNDEFINED),
+	  num_fetched_in_burst(0),
+	  last_queue_per_priority(LOW_PRIORITY + 1, UNDEFINED),
+	  credits_per_priority(LOW_PRIORITY + 1, 0)
+{}
+
+Host_Interface::~Host_Interface() {
+	for (auto& qp : queues) {
+		while (!qp.software_queue.empty()) {
+			delete qp.software_queue.front();
+			qp.software_queue.pop();
+		}
+		while (!qp.submission_queue.empty()) {
+			delete qp.submission_queue.front();
+			qp.submission_queue.pop();
+		}
+		for (auto e : qp.completion_queue) {
+			delete e;
+		}
+	}
+}
+
+// Returns the queue the thread submits to. Threads that were not bound to a queue are spread over the queues.
+int Host_Interface::bind(Thread* thread, int thread_id) {
+	int queue = thread->get_host_queue();
+	if (queue == UNDEFINED) {
+		return thread_id % queues.size();
+	}
+	if (queue < 0 || queue >= (int)queues.size()) {
+		fprintf(stderr, "A thread is bound to host queue %d, but there are only %d queues. Increase NVME_NUM_QUEUES.\n", queue, (int)queues.size());
+		throw;
+	}
+	queues[queue].priority = thread->get_host_queue_priority();
+	return queue;
+}
+
+bool Host_Interface::is_controller_full() const {
+	return num_commands_in_device >= MAX_SSD_QUEUE_SIZE;
+}
+
+void Host_Interface::submit(Event* event, int queue) {
+	queue_pair& qp = queues[queue];
+	if (qp.num_outstanding < NVME_QUEUE_DEPTH) {
+		qp.submission_queue.push(event);
+		qp.num_outstanding++;
+	} else {
+		qp.software_queue.push(event);
+	}
+	fetch();
+}
+
+// The controller fetches commands from the submission queues for as long as it has room for them
+void Host_Interface::fetch() {
+	while (!is_controller_full()) {
+		int queue = arbitrate();
+		if (queue == UNDEFINED) {
+			return;
+		}
+		Event* event = queues[queue].submission_queue.front();
+		queues[queue].submission_queue.pop();
+		if (event->get_ssd_submission_time() < time) {
+			event->incr_os_wait_time(time - event->get_ssd_submission_time());
+		}
+		num_commands_in_device++;
+		os->submit_to_device(event);
+	}
+}
+
+bool Host_Interface::is_eligible(int queue) const {
+	queue_pair const& qp = queues[queue];
+	return !qp.submission_queue.empty() && qp.submission_queue.front()->get_ssd_submission_time() <= time;
+}
+
+// Returns the candidate following the last picked queue, and remembers it
+int Host_Interface::pick_round_robin(vector<int> const& candidates, int& last) {
+	int picked = candidates.front();
+	for (auto q : candidates) {
+		if (q > last) {
+			picked = q;
+			break;
+		}
+	}
+	last = picked;
+	return picked;
+}
+
+// Returns the queue to fetch the next command from, or UNDEFINED if all submission queues are empty
+int Host_Interface::arbitrate() {
+	vector<int> eligible;
+	for (uint q = 0; q < queues.size(); q++) {
+		if (is_eligible(q)) {
+			eligible.push_back(q);
+		}
+	}
+	// No command has been submitted yet by the current time, so the controller waits for the soonest one
+	if (eligible.empty()) {
+		int soonest = UNDEFINED;
+		for (uint q = 0; q < queues.size(); q++) {
+			queue<Event*> const& sq = queues[q].submission_queue;
+			if (!sq.empty() && (soonest == UNDEFINED || sq.front()->get_ssd_submission_time() < queues[soonest].submission_queue.front()->get_ssd_submission_time())) {
+				soonest = q;
+			}
+		}
+		current_queue = soonest;
+		num_fetched_in_burst = soonest == UNDEFINED ? 0 : 1;
+		return soonest;
+	}
+
+	vector<int> candidates = eligible;
+	int* last = &current_queue;
+	if (NVME_ARBITRATION == 1) {
+		vector<vector<int> > per_priority(LOW_PRIORITY + 1);
+		for (auto q : eligible) {
+			per_priority[queues[q].priority].push_back(q);
+		}
+		int priority = URGENT_PRIORITY;
+		if (per_priority[URGENT_PRIORITY].empty()) {
+			const uint weights[] = {0, NVME_HIGH_PRIORITY_WEIGHT, NVME_MEDIUM_PRIORITY_WEIGHT, NVME_LOW_PRIORITY_WEIGHT};
+			priority = UNDEFINED;
+			for (int round = 0; round < 2 && priority == UNDEFINED; round++) {
+				for (int p = HIGH_PRIORITY; p <= LOW_PRIORITY && priority == UNDEFINED; p++) {
+					if (!per_priority[p].empty() && credits_per_priority[p] > 0) {
+						priority = p;
+					}
+				}
+				// All classes with pending commands have used up their credits
+				if (priority == UNDEFINED) {
+					for (int p = HIGH_PRIORITY; p <= LOW_PRIORITY; p++) {
+						credits_per_priority[p] = max(weights[p], (uint)1);
+					}
+				}
+			}
+			credits_per_priority[priority]--;
+		}
+		candidates = per_priority[priority];
+		last = &last_queue_per_priority[priority];
+	}
+
+	bool continue_burst = current_queue != UNDEFINED && num_fetched_in_burst < NVME_ARBITRATION_BURST
+			&& find(candidates.begin(), candidates.end(), current_queue) != candidates.end();
+	if (continue_burst) {
+		num_fetched_in_burst++;
+		return current_queue;
+	}
+	current_queue = pick_round_robin(candidates, *last);
+	num_fetched_in_burst = 1;
+	return current_queue;
+}
+
+void Host_Interface::register_completion(Event* event) {
+	raise_due_interrupts(event->get_current_time());
+	time = max(time, event->get_current_time());
+	num_commands_in_device--;
+	int queue = os->get_host_queue(event);
+	queue_pair& qp = queues[queue];
+	qp.completion_queue.push_back(event);
+	if (NVME_COALESCING_THRESHOLD <= 1 || qp.completion_queue.size() >= NVME_COALESCING_THRESHOLD) {
+		raise_interrupt(queue, time);
+	} else if (qp.completion_queue.size() == 1) {
+		qp.interrupt_deadline = event->get_current_time() + NVME_COALESCING_TIME;
+	}
+	fetch();
+}
+
+double Host_Interface::get_next_interrupt_time() const {
+	double soonest = INFINITE;
+	for (auto const& qp : queues) {
+		soonest = min(soonest, qp.interrupt_deadline);
+	}
+	return soonest;
+}
+
+void Host_Interface::raise_due_interrupts(double current_time) {
+	double deadline;
+	while ((deadline = get_next_interrupt_time()) <= current_time) {
+		for (uint q = 0; q < queues.size(); q++) {
+			if (queues[q].interrupt_deadline == deadline) {
+				time = max(time, deadline);
+				raise_interrupt(q, deadline);
+				break;
+			}
+		}
+	}
+}
+
+// Reports all completions in the completion queue to the host, and lets waiting commands into the submission queue
+void Host_Interface::raise_interrupt(int queue, double interrupt_time) {
+	queue_pair& qp = queues[queue];
+	vector<Event*> completions;
+	swap(completions, qp.completion_queue);
+	qp.interrupt_deadline = INFINITE;
+	qp.num_interrupts++;
+	for (auto e : completions) {
+		if (e->get_current_time() < interrupt_time) {
+			e->incr_accumulated_wait_time(interrupt_time - e->get_current_time());
+		}
+		qp.latencies.push_back(e->get_current_time() - e->get_start_time());
+		qp.num_outstanding--;
+		os->deliver_completion(e);
+		delete e;
+	}
+	while (!qp.software_queue.empty() && qp.num_outstanding < NVME_QUEUE_DEPTH) {
+		qp.submission_queue.push(qp.software_queue.front());
+		qp.software_queue.pop();
+		qp.num_outstanding++;
+	}
+	fetch();
+}
+
+void Host_Interface::print_statistics() const {
+	const char* priority_names[] = {"urgent", "high", "medium", "low"};
+	printf("\nHost interface: %d queues of depth %d, %s arbitration\n", (int)queues.size(), NVME_QUEUE_DEPTH, NVME_ARBITRATION == 1 ? "weighted round robin" : "round robin");
+	printf("\tcount\tavg\t\tp50\t\tp90\t\tp99\t\tp99.9\t\tmax\n");
+	for (uint q = 0; q < queues.size(); q++) {
+		stringstream name;
+		name << "Q" << q;
+		StatisticsGatherer::print_latency_distribution(name.str(), queues[q].latencies);
+	}
+	printf("\n\tpriority\tinterrupts\tcompletions per interrupt\n");
+	for (uint q = 0; q < queues.size(); q++) {
+		queue_pair const& qp = queues[q];
+		double per_interrupt = qp.num_interrupts == 0 ? 0 : qp.latencies.size() / (double)qp.num_interrupts;
+		printf("Q%d\t%s\t\t%ld\t\t%f\n", q, priority_names[qp.priority], qp.num_interrupts, per_interrupt);
+	}
+	printf("\n");
+}
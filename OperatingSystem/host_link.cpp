@@ -0,0 +1,56 @@
+/*
+ * host_link.cpp
+ *
+ *  The PCIe or SATA link between the operating system and the storage device.
+ */
+
+#include "../ssd.h"
+using namespace ssd;
+
+Host_Link::Host_Link()
+	: bandwidth(get_bandwidth()),
+	  free_at(2, 0)
+{}
+
+// The effective bandwidth of the link after encoding overhead
+double Host_Link::get_bandwidth() {
+	if (HOST_LINK_TYPE == 2) {
+		return 600;
+	}
+	const double pcie_lane_bandwidth[] = {250, 500, 985, 1969};
+	if (HOST_LINK_TYPE != 1 || HOST_LINK_PCIE_GENERATION < 1 || HOST_LINK_PCIE_GENERATION > 4 || HOST_LINK_PCIE_LANES == 0) {
+		fprintf(stderr, "Invalid host link: type %d, PCIe generation %d with %d lanes\n", HOST_LINK_TYPE, HOST_LINK_PCIE_GENERATION, HOST_LINK_PCIE_LANES);
+		throw;
+	}
+	return pcie_lane_bandwidth[HOST_LINK_PCIE_GENERATION - 1] * HOST_LINK_PCIE_LANES;
+}
+
+// Occupies the link for the given duration as soon as it is free, and returns the time at which the transfer ends
+double Host_Link::reserve(direction dir, double time, double duration) {
+	int lane = HOST_LINK_FULL_DUPLEX && HOST_LINK_TYPE != 2 ? dir : TO_DEVICE;
+	double start = max(time, free_at[lane]);
+	free_at[lane] = start + duration;
+	Utilization_Meter::register_host_link_transfer(lane, start, duration);
+	return free_at[lane];
+}
+
+// The SSD receives the command once it, and the data of a write, has crossed the link
+void Host_Link::transfer_to_device(Event* event) {
+	double duration = HOST_LINK_COMMAND_OVERHEAD;
+	if (event->get_event_type() == WRITE && !event->get_noop()) {
+		duration += event->get_size() * PAGE_SIZE / bandwidth;
+	}
+	double arrival_time = reserve(TO_DEVICE, event->get_current_time(), duration);
+	event->incr_os_wait_time(arrival_time - event->get_current_time());
+}
+
+// The host sees a read once its data has crossed the link
+void Host_Link::transfer_to_host(Event* event) {
+	event_type type = event->get_event_type();
+	if ((type != READ && type != READ_TRANSFER) || event->get_noop()) {
+		return;
+	}
+	double duration = event->get_size() * PAGE_SIZE / bandwidth;
+	double arrival_time = reserve(TO_HOST, event->get_current_time(), duration);
+	event->incr_accumulated_wait_time(arrival_time - event->get_current_time());
+}
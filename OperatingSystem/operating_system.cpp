@@ -11,20 +11,46 @@ using namespace ssd;
 int OperatingSystem::thread_id_generator = 0;
 
 OperatingSystem::OperatingSystem()
-	: ssd(new Ssd()),
+	: ssd(NULL),
+	  device(NULL),
 	  threads(),
+	  thread_table(),
+	  in_flight(),
+	  free_slots(),
+	  num_in_flight(0),
 	  NUM_WRITES_TO_STOP_AFTER(UNDEFINED),
 	  num_writes_completed(0),
-	  idle_time(0),
 	  time(0),
 	  scheduler(NULL),
+	  held_threads(),
 	  progress_meter_granularity(20),
-	  counter_for_user(0)
+	  counter_for_user(0),
+	  host_interface(NULL),
+	  thread_id_to_host_queue(),
+	  host_link(NULL)
 {
-	ssd->set_operating_system(this);
+	if (RAID_LEVEL != UNDEFINED) {
+		device = new RaidSsd();
+	} else if (ENABLE_TIERED_STORAGE) {
+		device = new Tiered_Ssd();
+	} else {
+		ssd = new Ssd();
+		device = ssd;
+	}
+	device->set_operating_system(this);
+	if (NVME_NUM_QUEUES > 0) {
+		host_interface = new Host_Interface(this);
+	}
+	if (HOST_LINK_TYPE != 0) {
+		host_link = new Host_Link();
+	}
 	thread_id_generator = 0;
 	if (OS_SCHEDULER == 0) {
 		scheduler = new FIFO_OS_Scheduler();
+	} else if (OS_SCHEDULER == 2) {
+		scheduler = new WFQ_OS_Scheduler();
+	} else if (OS_SCHEDULER == 3) {
+		scheduler = new MClock_OS_Scheduler();
 	} else {
 		scheduler = new FAIR_OS_Scheduler();
 	}
@@ -38,14 +64,53 @@ void OperatingSystem::set_threads(vector<Thread*> new_threads) {
 	historical_threads.clear();
 	num_writes_completed = 0;
 	threads.clear();
+	thread_table.assign(thread_table.size(), NULL);
+	scheduler->clear();
+	held_threads.clear();
 	for (auto t : new_threads) {
 		t->init(this, time);
 		int new_id = ++thread_id_generator;
-		threads[new_id] = t;
+		register_thread(new_id, t);
 		historical_threads.push_back(t);
 	}
 }
 
+void OperatingSystem::register_thread(int thread_id, Thread* thread) {
+	threads[thread_id] = thread;
+	if (thread_id >= (int)thread_table.size()) {
+		thread_table.resize(thread_id + 1, NULL);
+		thread_id_to_host_queue.resize(thread_id + 1, UNDEFINED);
+	}
+	thread_table[thread_id] = thread;
+	thread->set_id(thread_id);
+	update_scheduler(thread_id, thread);
+	if (host_interface != NULL) {
+		thread_id_to_host_queue[thread_id] = host_interface->bind(thread, thread_id);
+	}
+}
+
+// Without host queues, the device queue bounds how far ahead of the OS clock the threads get. The host queues take any
+// number of IOs, so there a thread is held back from the scheduler until the OS clock reaches the start time of its next
+// IO. Otherwise, an open loop thread would generate and queue its whole arrival stream before the first IO completes.
+void OperatingSystem::update_scheduler(int thread_id, Thread const* thread) {
+	Event const* next = thread->peek();
+	if (host_interface != NULL && next != NULL && next->get_start_time() > time) {
+		scheduler->remove(thread_id);
+		held_threads.set(thread_id, next->get_start_time());
+		return;
+	}
+	held_threads.remove(thread_id);
+	scheduler->update(thread_id, thread);
+}
+
+void OperatingSystem::release_held_threads() {
+	while (!held_threads.empty() && held_threads.top_key() <= time) {
+		int thread_id = held_threads.top();
+		held_threads.remove(thread_id);
+		scheduler->update(thread_id, thread_table[thread_id]);
+	}
+}
+
 vector<Thread*> OperatingSystem::get_non_finished_threads() {
 	vector<Thread*> vec;
 	for (auto t : historical_threads) {
@@ -56,41 +121,37 @@ vector<Thread*> OperatingSystem::get_non_finished_threads() {
 }
 
 OperatingSystem::~OperatingSystem() {
-	delete ssd;
+	delete device;
 	for (auto t : historical_threads) {
 		delete t;
 	}
 	threads.clear();
 	delete scheduler;
+	delete host_interface;
+	delete host_link;
 }
 
+// Called when the OS has nothing to dispatch and nothing will ever change that: the device is idle, and no interrupt
+// or throttled thread is due. Either IOs got lost inside the device, or the threads stopped submitting IOs.
 void OperatingSystem::check_if_stuck(bool no_pending_event, bool queue_is_full) {
-	const int idle_limit = 3000000;
-	if (idle_time > 100000 && idle_time % 100000 == 0) {
-		printf("Idle for %f seconds. No_pending_event=%d  Queue_is_full=%d\n", (double) idle_time / 1000000, no_pending_event, queue_is_full);
-		PRINT_LEVEL = 2;
-	}
-	if (idle_time >= idle_limit) {
-		printf("\n");
-		if (queue_is_full) {
-			fprintf(stderr, "For some reason, application IOs are getting stuck inside the SSD and never making it back to the OS.\n");
-			fprintf(stderr, "Normally the SSD invokes the OS's register_event_completion method whenever an application IO completes.\n");
-			fprintf(stderr, "This isn't happening, though. Since these IOs are still in the IO queue, we are stuck. We cannot submit any more IOs.\n");
-			fprintf(stderr, "The IOs that were submitted but never completed have the following application IDs:\n");
-		}
-		else if (no_pending_event) {
-			fprintf(stderr, "For some reason, the application threads are not submitting IOs.\n");
-			fprintf(stderr, "This means we are not making any progress. We are stuck an infinite loop.\n");
-			fprintf(stderr, "Hint: try to debug the OS_Scheduler method \"pick\", and try to see why the threads are not submitting IOs.\n");
-		}
-		for (auto it : currently_executing_ios) {
-			printf("%d ", it);
+	if (queue_is_full || num_in_flight > 0) {
+		fprintf(stderr, "For some reason, application IOs are getting stuck inside the SSD and never making it back to the OS.\n");
+		fprintf(stderr, "Normally the SSD invokes the OS's register_event_completion method whenever an application IO completes.\n");
+		fprintf(stderr, "This isn't happening, though. The device is idle, yet these IOs are still in the IO queue, so we are stuck.\n");
+		fprintf(stderr, "The IOs that were submitted but never completed have the following application IDs:\n");
+	}
+	else if (no_pending_event) {
+		fprintf(stderr, "For some reason, the application threads are not submitting IOs.\n");
+		fprintf(stderr, "This means we are not making any progress. We are stuck an infinite loop.\n");
+		fprintf(stderr, "Hint: try to debug the OS_Scheduler method \"pick\", and try to see why the threads are not submitting IOs.\n");
+	}
+	for (auto const& io : in_flight) {
+		if (io.thread != NULL) {
+			fprintf(stderr, "%d ", io.application_io_id);
 		}
-
-		printf("\n");
-		throw;
 	}
-	idle_time++;
+	fprintf(stderr, "\n");
+	throw;
 }
 
 void OperatingSystem::print_progess() {
@@ -105,29 +166,33 @@ void OperatingSystem::print_progess() {
 	}
 }
 
-// The operating system loops until one of two conditions holds:
-// 		- no thread
+// The operating system loops until the experiment is finished, or until no thread has any more work.
+// Every iteration dispatches as many IOs as the device queue has room for. If there is nothing to dispatch,
+// time advances to whichever comes first: a coalesced interrupt, the release of a throttled or held thread, or the next device event.
 void OperatingSystem::run() {
-
-	bool finished_experiment = false, still_more_work = true;
-	do {
-		int thread_id = scheduler->pick(threads);
-		bool no_pending_event = thread_id == UNDEFINED;
-		bool queue_is_full = currently_executing_ios.size() >= MAX_SSD_QUEUE_SIZE;
-		int queue_size = currently_executing_ios.size();
-		if (no_pending_event || queue_is_full) {
-			check_if_stuck(no_pending_event, queue_is_full);
-			ssd->progress_since_os_is_waiting();
+	while (!is_finished_experiment() && (num_in_flight > 0 || threads.size() > 0)) {
+		if (dispatch_ready_events() > 0) {
+			print_progess();
+			continue;
 		}
-		else {
-			dispatch_event(thread_id);
+		bool queue_is_full = host_interface == NULL && num_in_flight >= MAX_SSD_QUEUE_SIZE;
+		double release_time = queue_is_full ? INFINITE : scheduler->get_next_release_time();
+		if (!queue_is_full && !held_threads.empty()) {
+			release_time = min(release_time, held_threads.top_key());
+		}
+		double interrupt_time = host_interface != NULL ? host_interface->get_next_interrupt_time() : INFINITE;
+		double device_time = device->is_busy() ? device->get_next_event_time() : INFINITE;
+		if (interrupt_time != INFINITE && interrupt_time <= release_time && interrupt_time <= device_time) {
+			host_interface->raise_due_interrupts(interrupt_time);
+		} else if (release_time != INFINITE && release_time <= device_time) {
+			time = max(time, release_time);
+		} else if (device->is_busy()) {
+			device->progress_since_os_is_waiting();
+		} else {
+			check_if_stuck(!queue_is_full, queue_is_full);
 		}
 		print_progess();
-
-		finished_experiment = NUM_WRITES_TO_STOP_AFTER != UNDEFINED && NUM_WRITES_TO_STOP_AFTER <= num_writes_completed;
-		still_more_work = currently_executing_ios.size() > 0 || threads.size() > 0;
-		//printf("num_writes   %d\n", num_writes_completed);
-	} while (!finished_experiment && still_more_work);
+	}
 
 	for (auto entry : threads) {
 		Thread* t = entry.second;
@@ -135,48 +200,125 @@ void OperatingSystem::run() {
 	}
 }
 
+// Dispatches the next IO of the thread picked by the scheduler for as long as the device queue has room for it.
+// The host queues absorb any number of IOs, but only get those whose start time the OS clock has reached.
+// Returns the number of IOs dispatched.
+int OperatingSystem::dispatch_ready_events() {
+	release_held_threads();
+	int num_dispatched = 0;
+	while ((host_interface != NULL || num_in_flight < MAX_SSD_QUEUE_SIZE) && !is_finished_experiment()) {
+		int thread_id = scheduler->pick(threads, time);
+		if (thread_id == UNDEFINED) {
+			break;
+		}
+		dispatch_event(thread_id);
+		num_dispatched++;
+	}
+	return num_dispatched;
+}
+
 void OperatingSystem::dispatch_event(int thread_id) {
-	idle_time = 0;
-	Event* event = threads[thread_id]->pop();
+	Thread* thread = thread_table[thread_id];
+	Event* event = thread->pop();
+	update_scheduler(thread_id, thread);
 	if (event->get_start_time() < time) {
 		event->incr_os_wait_time(time - event->get_start_time());
 	}
-	//printf("submitting:   " ); event->print();
+	scheduler->register_dispatch(thread_id, thread, event);
 
-	currently_executing_ios.insert(event->get_application_io_id());
-	app_id_to_thread_id_mapping[event->get_application_io_id()] = thread_id;
+	int slot;
+	if (free_slots.empty()) {
+		slot = in_flight.size();
+		in_flight.push_back(in_flight_io());
+	} else {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	int host_queue = host_interface != NULL ? thread_id_to_host_queue[thread_id] : UNDEFINED;
+	in_flight[slot].thread = thread;
+	in_flight[slot].application_io_id = event->get_application_io_id();
+	in_flight[slot].host_queue = host_queue;
+	event->set_os_slot(slot);
+	num_in_flight++;
 
 	//printf("dispatching:\t"); event->print();
 
-	ssd->submit(event);
+	if (host_interface != NULL) {
+		host_interface->submit(event, host_queue);
+	} else {
+		submit_to_device(event);
+	}
+}
+
+void OperatingSystem::submit_to_device(Event* event) {
+	if ((long)event->get_logical_address() > device->get_num_logical_pages()) {
+		printf("invalid logical address, too big  %lu   %ld\n", event->get_logical_address(), device->get_num_logical_pages());
+		assert(false);
+	}
+	if (host_link != NULL) {
+		host_link->transfer_to_device(event);
+	}
+	device->submit(event);
 }
 
 void OperatingSystem::setup_follow_up_threads(int thread_id, double current_time) {
-	vector<Thread*>& follow_up_threads = threads[thread_id]->get_follow_up_threads();
+	vector<Thread*>& follow_up_threads = thread_table[thread_id]->get_follow_up_threads();
 	if (PRINT_LEVEL >= 1) printf("Switching to new follow up thread\n");
 	printf("Switching to new follow up thread\n");
 	//PRINT_LEVEL = 2;
 	for (auto t : follow_up_threads) {
 		t->init(this, current_time);
 		int new_id = ++thread_id_generator;
-		threads[new_id] = t;
+		register_thread(new_id, t);
 		historical_threads.push_back(t);
 	}
 	follow_up_threads.clear();
 }
 
 void OperatingSystem::register_event_completion(Event* event) {
+	if (host_link != NULL) {
+		host_link->transfer_to_host(event);
+	}
+	// With a host interface, the completion is delivered once its completion queue raises an interrupt
+	if (host_interface != NULL) {
+		host_interface->register_completion(event);
+		release_held_threads();
+		int thread_id;
+		while ((thread_id = scheduler->pick(threads, time)) != UNDEFINED) {
+			dispatch_event(thread_id);
+		}
+		return;
+	}
+
+	deliver_completion(event);
+
+	int thread_with_soonest_event = scheduler->pick(threads, time);
+	if (thread_with_soonest_event != UNDEFINED) {
+		dispatch_event(thread_with_soonest_event);
+	}
+
+	delete event;
+}
 
-	//bool queue_was_full = currently_executing_ios.size() == MAX_SSD_QUEUE_SIZE;
-	currently_executing_ios.erase(event->get_application_io_id());
+void OperatingSystem::deliver_completion(Event* event) {
+	int slot = event->get_os_slot();
+	if (slot == UNDEFINED || slot >= (int)in_flight.size() || in_flight[slot].application_io_id != event->get_application_io_id()) {
+		fprintf(stderr, "The OS received the completion of application IO %d, which it does not know to be executing.\n", event->get_application_io_id());
+		throw;
+	}
+	Thread* thread = in_flight[slot].thread;
+	in_flight[slot] = in_flight_io();
+	free_slots.push_back(slot);
+	num_in_flight--;
 
 	//printf("finished:\t"); event->print();
-	//printf("queue size:\t%d\n", currently_executing_ios_counter);
 
-	long thread_id = app_id_to_thread_id_mapping.at(event->get_application_io_id());
-	app_id_to_thread_id_mapping.erase(event->get_application_io_id());
-	Thread* thread = threads[thread_id];
+	int thread_id = thread->get_id();
 	thread->register_event_completion(event);
+	StatisticsGatherer::get_global_instance()->register_host_completion(*event);
+	if (thread->get_tenant() != UNDEFINED) {
+		StatisticsGatherer::get_global_instance()->register_tenant_completion(thread->get_tenant(), *event);
+	}
 
 	if (!event->get_noop() /*&& event->get_event_type() == WRITE*/ && event->get_event_type() != TRIM) {
 		num_writes_completed++;
@@ -185,27 +327,45 @@ void OperatingSystem::register_event_completion(Event* event) {
 	if (thread->is_finished() && thread->get_num_ongoing_IOs() == 0) {
 		setup_follow_up_threads(thread_id, event->get_current_time());
 		threads.erase(thread_id);
+		thread_table[thread_id] = NULL;
+		held_threads.remove(thread_id);
+		scheduler->remove(thread_id);
 	}
 	if (!event->get_noop()) {
 		//assert(time <= event->get_current_time() + 1);
 	}
 	time = max(time, event->get_current_time());
+}
 
-	int thread_with_soonest_event = scheduler->pick(threads);
-	if (thread_with_soonest_event != UNDEFINED) {
-		dispatch_event(thread_with_soonest_event);
-	}
 
-	delete event;
+void OperatingSystem::print_statistics() const {
+	if (host_interface != NULL) {
+		host_interface->print_statistics();
+	}
+	StatisticsGatherer::get_global_instance()->print_tenant_statistics();
+	for (auto t : historical_threads) {
+		t->print_statistics();
+	}
 }
 
+void OperatingSystem::register_queue_head_change(Thread const* thread) {
+	int thread_id = thread->get_id();
+	if (thread_id >= 0 && thread_id < (int)thread_table.size() && thread_table[thread_id] == thread) {
+		update_scheduler(thread_id, thread);
+	}
+}
 
 void OperatingSystem::set_num_writes_to_stop_after(long num_writes) {
 	NUM_WRITES_TO_STOP_AFTER = num_writes;
 }
 
 Flexible_Reader* OperatingSystem::create_flexible_reader(vector<Address_Range> ranges) {
-	FtlParent* ftl = ssd->get_ftl();
+	// A flexible reader picks the physical pages to read, so it needs the mapping of a single SSD
+	FtlParent* ftl = device->get_ftl();
+	if (ftl == NULL) {
+		fprintf(stderr, "Error: flexible reads are only supported on a single SSD, not on a RAID array or tiered storage.\n");
+		throw;
+	}
 	Flexible_Reader* reader = new Flexible_Reader(*ftl, ranges);
 	return reader;
 }
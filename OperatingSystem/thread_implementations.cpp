@@ -17,7 +17,9 @@ bool Thread::record_internal_statistics = false;
 Thread::Thread() :
 		finished(false), time(1), threads_to_start_when_this_thread_finishes(),
 		os(NULL), internal_statistics_gatherer(new StatisticsGatherer()),
-		external_statistics_gatherer(NULL), num_IOs_executing(0), io_queue(), stopped(false) {}
+		external_statistics_gatherer(NULL), num_IOs_executing(0), io_queue(), stopped(false),
+		host_queue(UNDEFINED), host_queue_priority_class(MEDIUM_PRIORITY), id(UNDEFINED),
+		tenant(UNDEFINED), tenant_qos() {}
 
 Thread::~Thread() {
 	for (auto t : threads_to_start_when_this_thread_finishes) {
@@ -32,6 +34,9 @@ Event* Thread::pop() {
 	} else {
 		Event* next = io_queue.front();
 		io_queue.pop();
+		if (io_queue.empty()) {
+			handle_queue_drained();
+		}
 		return next;
 	}
 }
@@ -40,6 +45,20 @@ Event* Thread::peek() const {
 	return io_queue.size() == 0 ? NULL : io_queue.front();
 }
 
+// A tenant with no weight would never be served, and one whose reservation exceeds its limit cannot get both
+void Thread::set_tenant(int new_tenant, Tenant_QoS const& qos) {
+	if (qos.weight <= 0) {
+		fprintf(stderr, "Error: the weight of tenant %d must be positive, but it is %f.\n", new_tenant, qos.weight);
+		throw;
+	}
+	if (qos.reservation > 0 && qos.limit > 0 && qos.reservation > qos.limit) {
+		fprintf(stderr, "Error: the reservation of tenant %d (%f IOPS) exceeds its limit (%f IOPS).\n", new_tenant, qos.reservation, qos.limit);
+		throw;
+	}
+	tenant = new_tenant;
+	tenant_qos = qos;
+}
+
 void Thread::init(OperatingSystem* new_os, double new_time) {
 	os = new_os;
 	time = new_time;
@@ -100,6 +119,9 @@ void Thread::submit(Event* event) {
 	event->set_start_time(event->get_current_time());
 	io_queue.push(event);
 	num_IOs_executing++;
+	if (io_queue.size() == 1 && os != NULL) {
+		os->register_queue_head_change(this);
+	}
 	if (!can_submit_more()) {
 		printf("Reached the maximum of events that can be submitted at the same time: %d\n", io_queue.size());
 		assert(false);
@@ -118,7 +140,8 @@ Simple_Thread::Simple_Thread(IO_Pattern* generator, IO_Mode_Generator* mode_gen,
 	  io_gen(generator),
 	  io_type_gen(mode_gen),
 	  number_of_times_to_repeat(num_IOs),
-	  io_size(1)
+	  io_size(1),
+	  batch()
 {
 	assert(MAX_IOS > 0);
 }
@@ -128,7 +151,8 @@ Simple_Thread::Simple_Thread(IO_Pattern* generator, int MAX_IOS, IO_Mode_Generat
 	  MAX_IOS(MAX_IOS),
 	  io_gen(generator),
 	  io_type_gen(mode_gen),
-	  io_size(1)
+	  io_size(1),
+	  batch()
 {
 	assert(MAX_IOS > 0);
 	number_of_times_to_repeat = generator->max_LBA - generator->min_LBA + 1;
@@ -142,8 +166,9 @@ Simple_Thread::~Simple_Thread() {
 void Simple_Thread::generate_io() {
 	while (get_num_ongoing_IOs() < MAX_IOS && number_of_times_to_repeat > 0 && !is_finished() && !is_stopped()) {
 		number_of_times_to_repeat--;
-		event_type type = io_type_gen->next();
-		long logical_addr = io_gen->next();
+		event_type type;
+		long logical_addr;
+		batch.next(io_type_gen, io_gen, type, logical_addr);
 		Event* e = new Event(type, logical_addr, io_size, get_current_time());
 		submit(e);
 	}
@@ -160,48 +185,398 @@ void Simple_Thread::handle_event_completion(Event* event) {
 	}
 }
 
-Random_IO_Pattern_Collision_Free::Random_IO_Pattern_Collision_Free(long min_LBA, long max_LBA, ulong seed) : IO_Pattern(min_LBA, max_LBA), random_number_generator(seed), counter(0) {
+Random_IO_Pattern_Collision_Free::Random_IO_Pattern_Collision_Free(long min_LBA, long max_LBA, ulong seed)
+	: IO_Pattern(min_LBA, max_LBA),
+	  random_number_generator(seed),
+	  counter(0),
+	  half_bits(1)
+{
+	assert(max_LBA > min_LBA);
+	while ((1UL << (2 * half_bits)) < (ulong)(max_LBA - min_LBA)) {
+		half_bits++;
+	}
 	reinit();
-};
+}
 
+// Draws a new permutation
 void Random_IO_Pattern_Collision_Free::reinit() {
-	candidates.clear();
-	candidates.reserve(max_LBA - min_LBA);
-	for (int i = min_LBA; i < max_LBA; i++ ) {
-		candidates.push_back(i);
+	for (int i = 0; i < NUM_ROUNDS; i++) {
+		round_keys[i] = ((ulong)random_number_generator() << 32) | random_number_generator();
 	}
+	counter = 0;
 }
 
-int Random_IO_Pattern_Collision_Free::next() {
-	bool found = false;
-	int index = UNDEFINED;
+// A balanced Feistel network is a permutation of the numbers below 2^(2 * half_bits), whatever its round function
+ulong Random_IO_Pattern_Collision_Free::permute(ulong x) const {
+	const ulong mask = (1UL << half_bits) - 1;
+	ulong left = x >> half_bits, right = x & mask;
+	for (int i = 0; i < NUM_ROUNDS; i++) {
+		ulong f = (right + round_keys[i]) * 0x9E3779B97F4A7C15UL;
+		f ^= f >> 29;
+		f *= 0xBF58476D1CE4E5B9UL;
+		f ^= f >> 32;
+		ulong new_right = left ^ (f & mask);
+		left = right;
+		right = new_right;
+	}
+	return (left << half_bits) | right;
+}
 
+// Applying the permutation again to results outside the range keeps it a permutation of the range.
+// Since the permutation domain is less than four times the range, this takes fewer than four rounds on average.
+int Random_IO_Pattern_Collision_Free::next() {
+	ulong num_LBAs = max_LBA - min_LBA;
+	if ((ulong)counter == num_LBAs) {
+		reinit();
+	}
+	ulong x = counter++;
 	do {
-		index = random_number_generator() % candidates.size();
-		if (candidates[index] != UNDEFINED) {
-			found = true;
+		x = permute(x);
+	} while (x >= num_LBAs);
+	return min_LBA + x;
+}
+
+// =================  Skewed_IO_Pattern  =============================
+
+Alias_Table::Alias_Table(vector<double> const& weights)
+	: probability(weights.size(), 1),
+	  alias(weights.size(), 0)
+{
+	double sum = 0;
+	for (auto w : weights) sum += w;
+	if (weights.empty() || sum <= 0) {
+		fprintf(stderr, "An alias table needs at least one positive weight\n");
+		throw;
+	}
+	vector<int> small, large;
+	vector<double> scaled(weights.size());
+	for (uint i = 0; i < weights.size(); i++) {
+		scaled[i] = weights[i] * weights.size() / sum;
+		if (scaled[i] < 1) small.push_back(i);
+		else large.push_back(i);
+	}
+	while (!small.empty() && !large.empty()) {
+		int s = small.back(); small.pop_back();
+		int l = large.back();
+		probability[s] = scaled[s];
+		alias[s] = l;
+		scaled[l] -= 1 - scaled[s];
+		if (scaled[l] < 1) {
+			large.pop_back();
+			small.push_back(l);
 		}
-	} while (!found);
-	int lba = candidates[index];
-	candidates[index] = UNDEFINED;
-	if (candidates.size() == 1 && candidates.front() == UNDEFINED) {
-		reinit();
-		counter = candidates.size();
-	}
-	if (++counter >= candidates.size() / 2) {
-		vector<int> new_candidates;
-		new_candidates.reserve(candidates.size() / 2);
-		for (auto i : candidates) {
-			if (i != UNDEFINED) {
-				new_candidates.push_back(i);
-			}
+	}
+	// Whatever is left over only differs from 1 by rounding errors
+	for (auto i : small) alias[i] = i;
+	for (auto i : large) alias[i] = i;
+}
+
+Skewed_IO_Pattern::Skewed_IO_Pattern(long min_LBA, long max_LBA, vector<double> const& weights, vector<long> const& bucket_sizes, ulong seed)
+	: IO_Pattern(min_LBA, max_LBA),
+	  buckets(weights),
+	  bucket_start(1, min_LBA),
+	  random_number_generator(seed)
+{
+	for (auto size : bucket_sizes) {
+		bucket_start.push_back(bucket_start.back() + size);
+	}
+	assert(weights.size() == bucket_sizes.size() && bucket_start.back() == max_LBA + 1);
+}
+
+int Skewed_IO_Pattern::next() {
+	int bucket = buckets.sample(random_number_generator());
+	long size = bucket_start[bucket + 1] - bucket_start[bucket];
+	return bucket_start[bucket] + min((long)(random_number_generator() * size), size - 1);
+}
+
+// Addresses are ranked from 0 for the hottest one. The mass function gives the weight of the ranks in [first, last),
+// so that building the pattern costs one evaluation per bucket rather than one per address.
+Skewed_IO_Pattern* Skewed_IO_Pattern::from_mass(long min_LBA, long max_LBA, vector<long> const& bucket_sizes, function<double(long, long)> mass, ulong seed) {
+	vector<double> weights;
+	long start = 0;
+	for (auto size : bucket_sizes) {
+		weights.push_back(max(mass(start, start + size), 0.0));
+		start += size;
+	}
+	return new Skewed_IO_Pattern(min_LBA, max_LBA, weights, bucket_sizes, seed);
+}
+
+// For distributions whose density falls with the rank. Each of the HEAD_RANKS hottest addresses gets a bucket of its own,
+// and the buckets after them grow geometrically, each spanning at most 1/HEAD_RANKS of its first rank. So the density
+// varies by less than a factor of 1 + 1/HEAD_RANKS within a bucket, and there are about HEAD_RANKS * ln(num_LBAs / HEAD_RANKS) buckets.
+vector<long> Skewed_IO_Pattern::geometric_buckets(long num_LBAs) {
+	vector<long> bucket_sizes;
+	for (long start = 0; start < num_LBAs; start += bucket_sizes.back()) {
+		bucket_sizes.push_back(min(max(start / HEAD_RANKS, 1L), num_LBAs - start));
+	}
+	return bucket_sizes;
+}
+
+// For distributions that are not hottest at rank 0. Large address spaces are grouped into at most MAX_BUCKETS equal buckets.
+vector<long> Skewed_IO_Pattern::equal_buckets(long num_LBAs) {
+	long bucket_size = (num_LBAs + MAX_BUCKETS - 1) / MAX_BUCKETS;
+	vector<long> bucket_sizes;
+	for (long start = 0; start < num_LBAs; start += bucket_size) {
+		bucket_sizes.push_back(min(bucket_size, num_LBAs - start));
+	}
+	return bucket_sizes;
+}
+
+// Rank r has weight (r + 1)^-theta. The sum over a bucket of several ranks is taken as the integral of x^-theta between
+// the midpoints around it, which is exact to well within the variation of the density inside the bucket.
+Skewed_IO_Pattern* Skewed_IO_Pattern::zipf(long min_LBA, long max_LBA, double theta, ulong seed) {
+	auto mass = [theta](long first, long last) {
+		if (last - first == 1) {
+			return pow(first + 1, -theta);
+		}
+		double low = first + 0.5, high = last + 0.5;
+		return theta == 1 ? log(high / low) : (pow(high, 1 - theta) - pow(low, 1 - theta)) / (1 - theta);
+	};
+	return from_mass(min_LBA, max_LBA, geometric_buckets(max_LBA - min_LBA + 1), mass, seed);
+}
+
+// A Pareto distribution with a scale of one address, discretised over the ranks. Its mass over a bucket is exact.
+Skewed_IO_Pattern* Skewed_IO_Pattern::pareto(long min_LBA, long max_LBA, double shape, ulong seed) {
+	auto mass = [shape](long first, long last) { return pow(first + 1, -shape) - pow(last + 1, -shape); };
+	return from_mass(min_LBA, max_LBA, geometric_buckets(max_LBA - min_LBA + 1), mass, seed);
+}
+
+Skewed_IO_Pattern* Skewed_IO_Pattern::normal(long min_LBA, long max_LBA, double deviation, ulong seed) {
+	long num_LBAs = max_LBA - min_LBA + 1;
+	double mean = num_LBAs / 2.0;
+	double scale = max(deviation * num_LBAs, 1.0) * sqrt(2.0);
+	auto mass = [mean, scale](long first, long last) { return 0.5 * (erf((last - 0.5 - mean) / scale) - erf((first - 0.5 - mean) / scale)); };
+	return from_mass(min_LBA, max_LBA, equal_buckets(num_LBAs), mass, seed);
+}
+
+Skewed_IO_Pattern* Skewed_IO_Pattern::zoned(long min_LBA, long max_LBA, vector<double> const& access_fractions, vector<double> const& space_fractions, ulong seed) {
+	long num_LBAs = max_LBA - min_LBA + 1;
+	vector<double> weights;
+	vector<long> bucket_sizes;
+	double accesses_left = 1;
+	long space_left = num_LBAs;
+	for (uint i = 0; i < access_fractions.size(); i++) {
+		long size = min((long)round(space_fractions[i] * num_LBAs), space_left);
+		if (size > 0) {
+			weights.push_back(access_fractions[i]);
+			bucket_sizes.push_back(size);
 		}
-		candidates = new_candidates;
-		//printf("size %d\n", candidates.size());
-		counter = 0;
+		accesses_left -= access_fractions[i];
+		space_left -= size;
+	}
+	if (space_left > 0) {
+		weights.push_back(max(accesses_left, 0.0));
+		bucket_sizes.push_back(space_left);
 	}
+	return new Skewed_IO_Pattern(min_LBA, max_LBA, weights, bucket_sizes, seed);
+}
+
+IO_Size_Generator::IO_Size_Generator(vector<int> const& sizes, vector<double> const& weights, ulong seed)
+	: sizes(sizes),
+	  largest(*max_element(sizes.begin(), sizes.end())),
+	  table(weights),
+	  random_number_generator(seed)
+{}
+
+void IO_Batch::refill(IO_Mode_Generator* type_gen, IO_Pattern* address_gen) {
+	types.resize(SIZE);
+	addresses.resize(SIZE);
+	type_gen->next_batch(&types[0], SIZE);
+	address_gen->next_batch(&addresses[0], SIZE);
+	cursor = 0;
+}
+
+// =================  Arrival processes  =============================
+
+MMPP_Arrivals::MMPP_Arrivals(double burst_rate, double quiet_rate, double mean_burst_duration, double mean_quiet_duration, ulong seed)
+	: state(0),
+	  time_left_in_state(0),
+	  random_number_generator(seed)
+{
+	rate[0] = burst_rate;
+	rate[1] = quiet_rate;
+	mean_duration[0] = mean_burst_duration;
+	mean_duration[1] = mean_quiet_duration;
+	time_left_in_state = -log(random_number_generator()) * mean_duration[state];
+}
+
+// Since both the arrivals and the state durations are memoryless, the next arrival is drawn afresh after every state change
+double MMPP_Arrivals::next() {
+	double time_until_arrival = 0;
+	while (true) {
+		double gap = rate[state] > 0 ? -log(random_number_generator()) * 1000000 / rate[state] : time_left_in_state + 1;
+		if (gap <= time_left_in_state) {
+			time_left_in_state -= gap;
+			return time_until_arrival + gap;
+		}
+		time_until_arrival += time_left_in_state;
+		state = 1 - state;
+		time_left_in_state = -log(random_number_generator()) * mean_duration[state];
+	}
+}
+
+Replayed_Arrivals::Replayed_Arrivals(vector<double> arrival_times, bool sample_randomly, ulong seed)
+	: inter_arrival_times(),
+	  index(0),
+	  sample_randomly(sample_randomly),
+	  random_number_generator(seed)
+{
+	sort(arrival_times.begin(), arrival_times.end());
+	for (uint i = 1; i < arrival_times.size(); i++) {
+		inter_arrival_times.push_back(arrival_times[i] - arrival_times[i - 1]);
+	}
+	if (inter_arrival_times.empty()) {
+		fprintf(stderr, "At least two arrival times are needed to replay arrivals.\n");
+		throw;
+	}
+}
+
+Replayed_Arrivals* Replayed_Arrivals::from_file(string file_name, bool sample_randomly) {
+	ifstream file(file_name.c_str());
+	if (!file.is_open()) {
+		fprintf(stderr, "Could not open the arrival times file %s\n", file_name.c_str());
+		throw;
+	}
+	vector<double> arrival_times;
+	double time;
+	while (file >> time) {
+		arrival_times.push_back(time);
+	}
+	return new Replayed_Arrivals(arrival_times, sample_randomly);
+}
+
+double Replayed_Arrivals::next() {
+	if (sample_randomly) {
+		return inter_arrival_times[random_number_generator() % inter_arrival_times.size()];
+	}
+	double gap = inter_arrival_times[index];
+	index = (index + 1) % inter_arrival_times.size();
+	return gap;
+}
+
+// =================  Open_Loop_Thread  =============================
+
+Open_Loop_Thread::Open_Loop_Thread(IO_Pattern* generator, IO_Mode_Generator* type, Arrival_Process* arrivals, long num_IOs)
+	: Thread(),
+	  io_gen(generator),
+	  io_type_gen(type),
+	  arrivals(arrivals),
+	  number_of_times_to_repeat(num_IOs),
+	  io_size(1),
+	  io_sizes(NULL),
+	  batch(),
+	  next_arrival_time(0),
+	  first_arrival_time(UNDEFINED),
+	  host_queueing_delays(),
+	  device_latencies(),
+	  latencies()
+{}
+
+Open_Loop_Thread::~Open_Loop_Thread() {
+	delete io_gen;
+	delete io_type_gen;
+	delete arrivals;
+	delete io_sizes;
+}
+
+// Only the next arrival waits in the queue of the thread. The one after it is generated once the OS takes it.
+void Open_Loop_Thread::issue_next_arrival() {
+	if (number_of_times_to_repeat <= 0 || is_finished() || is_stopped()) {
+		return;
+	}
+	number_of_times_to_repeat--;
+	next_arrival_time += arrivals->next();
+	event_type type;
+	long logical_addr;
+	int size = io_sizes == NULL ? io_size : io_sizes->next();
+	// Addresses are only batched when every IO is a single page, since the pattern has to know how far each IO reaches
+	if ((io_sizes == NULL ? io_size : io_sizes->get_largest()) == 1) {
+		batch.next(io_type_gen, io_gen, type, logical_addr);
+	} else {
+		type = io_type_gen->next();
+		logical_addr = io_gen->next_extent(size);
+	}
+	submit(new Event(type, logical_addr, size, next_arrival_time));
+}
+
+void Open_Loop_Thread::issue_first_IOs() {
+	next_arrival_time = get_current_time();
+	first_arrival_time = UNDEFINED;
+	issue_next_arrival();
+}
+
+void Open_Loop_Thread::handle_queue_drained() {
+	issue_next_arrival();
+}
+
+void Open_Loop_Thread::handle_event_completion(Event* event) {
+	if (event->get_noop()) {
+		return;
+	}
+	if (first_arrival_time == UNDEFINED || event->get_start_time() < first_arrival_time) {
+		first_arrival_time = event->get_start_time();
+	}
+	host_queueing_delays.push_back(event->get_ssd_submission_time() - event->get_start_time());
+	device_latencies.push_back(event->get_current_time() - event->get_ssd_submission_time());
+	latencies.push_back(event->get_current_time() - event->get_start_time());
+}
+
+void Open_Loop_Thread::print_statistics() const {
+	if (latencies.empty()) {
+		return;
+	}
+	double duration = next_arrival_time - first_arrival_time;
+	printf("\nOpen loop thread: %lu IOs completed, offered load %f IOPS\n", latencies.size(), duration <= 0 ? 0 : latencies.size() * 1000000 / duration);
+	printf("\tcount\tavg\t\tp50\t\tp90\t\tp99\t\tp99.9\t\tmax\n");
+	StatisticsGatherer::print_latency_distribution("host queue", host_queueing_delays);
+	StatisticsGatherer::print_latency_distribution("device", device_latencies);
+	StatisticsGatherer::print_latency_distribution("total", latencies);
+	printf("\n");
+}
+
+// =================  Job_Thread  =============================
+
+Job_Thread::Job_Thread(IO_Pattern* generator, IO_Mode_Generator* type, IO_Size_Generator* sizes, int io_depth, long num_IOs)
+	: Thread(),
+	  io_gen(generator),
+	  io_type_gen(type),
+	  io_sizes(sizes),
+	  batch(),
+	  io_depth(io_depth),
+	  number_of_times_to_repeat(num_IOs),
+	  think_time(0)
+{
+	assert(io_depth > 0);
+}
+
+Job_Thread::~Job_Thread() {
+	delete io_gen;
+	delete io_type_gen;
+	delete io_sizes;
+}
+
+void Job_Thread::generate_io(double start_time) {
+	while (get_num_ongoing_IOs() < io_depth && number_of_times_to_repeat > 0 && !is_finished() && !is_stopped()) {
+		number_of_times_to_repeat--;
+		event_type type;
+		long logical_addr;
+		int size = io_sizes->next();
+		if (io_sizes->get_largest() == 1) {
+			batch.next(io_type_gen, io_gen, type, logical_addr);
+		} else {
+			type = io_type_gen->next();
+			logical_addr = io_gen->next_extent(size);
+		}
+		submit(new Event(type, logical_addr, size, start_time));
+	}
+}
+
+void Job_Thread::issue_first_IOs() {
+	generate_io(get_current_time());
+}
 
-	return lba;
+void Job_Thread::handle_event_completion(Event* event) {
+	generate_io(get_current_time() + think_time);
 }
 
 // =================  Flexible_Reader_Thread  =============================
@@ -13,6 +13,49 @@
 
 namespace ssd {
 
+// The priority classes of NVMe weighted round robin arbitration. Urgent queues are always served first.
+enum host_queue_priority {URGENT_PRIORITY, HIGH_PRIORITY, MEDIUM_PRIORITY, LOW_PRIORITY};
+
+// The quality of service a tenant gets from the WFQ and mClock OS schedulers. Rates of 0 are unlimited.
+struct Tenant_QoS {
+	Tenant_QoS() : weight(1), reservation(0), limit(0), iops_limit(0), bandwidth_limit(0), burst(1) {}
+	double weight;				// the share of the device the tenant gets under contention
+	double reservation;			// the IOPS guaranteed to the tenant (mClock)
+	double limit;				// the IOPS the tenant never exceeds (mClock)
+	double iops_limit;			// token bucket throttling, in IOPS
+	double bandwidth_limit;		// token bucket throttling, in MB/s
+	double burst;				// the depth of the token buckets, in IOs
+};
+
+// A circular buffer that grows by doubling, so that queueing and dequeueing IOs does not allocate
+template <class T>
+class Ring_Buffer
+{
+public:
+	Ring_Buffer() : items(16), head(0), count(0) {}
+	inline bool empty() const { return count == 0; }
+	inline uint size() const { return count; }
+	inline T& front() { return items[head]; }
+	inline T const& front() const { return items[head]; }
+	inline void pop() { head = (head + 1) & (items.size() - 1); count--; }
+	inline void push(T const& item) {
+		if (count == items.size()) {
+			vector<T> larger(items.size() * 2);
+			for (uint i = 0; i < count; i++) {
+				larger[i] = items[(head + i) & (items.size() - 1)];
+			}
+			items.swap(larger);
+			head = 0;
+		}
+		items[(head + count) & (items.size() - 1)] = item;
+		count++;
+	}
+private:
+	vector<T> items; // the size is always a power of two
+	uint head;
+	uint count;
+};
+
 /*
  *
  */
@@ -40,16 +83,29 @@ public:
 	StatisticsGatherer* get_external_statistics_gatherer() { return external_statistics_gatherer; }
 	void set_statistics_gatherer(StatisticsGatherer* new_statistics_gatherer);
 	void set_finished() { finished = true; }
+	// Binds the thread to a submission/completion queue pair of the host interface, and sets the priority class of the queue
+	inline void set_host_queue(int queue, host_queue_priority priority = MEDIUM_PRIORITY) { host_queue = queue; host_queue_priority_class = priority; }
+	inline int get_host_queue() const { return host_queue; }
+	inline host_queue_priority get_host_queue_priority() const { return host_queue_priority_class; }
+	// Threads in the same tenant share one QoS allocation, which is taken from the first of them the OS scheduler sees
+	void set_tenant(int new_tenant, Tenant_QoS const& qos = Tenant_QoS());
+	inline int get_tenant() const { return tenant; }
+	inline Tenant_QoS const& get_tenant_qos() const { return tenant_qos; }
+	inline void set_id(int new_id) { id = new_id; }
+	inline int get_id() const { return id; }
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version) {
     	ar & threads_to_start_when_this_thread_finishes;
     }
     static void set_record_internal_statistics(bool val) { record_internal_statistics = val; }
+	virtual void print_statistics() const {}
 protected:
 	virtual void issue_first_IOs() = 0;
 	virtual void handle_event_completion(Event* event) = 0;
 	virtual void handle_no_IOs_left() {}
+	// Called when the OS has taken the last IO waiting in the thread's queue
+	virtual void handle_queue_drained() {}
 	inline double get_current_time() { return time; }
 	vector<Thread*> threads_to_start_when_this_thread_finishes;
 	OperatingSystem* os;
@@ -61,12 +117,45 @@ private:
 	StatisticsGatherer* internal_statistics_gatherer;
 	StatisticsGatherer* external_statistics_gatherer;
 	int num_IOs_executing;
-	queue<Event*> io_queue;
+	Ring_Buffer<Event*> io_queue;
 	bool finished;
 	bool stopped;
+	int host_queue;
+	host_queue_priority host_queue_priority_class;
+	int id;		// the id the OS knows this thread by
+	int tenant;
+	Tenant_QoS tenant_qos;
 	static bool record_internal_statistics;
 };
 
+// A thread whose IO pattern is written as straight-line code in run(), which suspends until IOs complete.
+// C++0x has no coroutines, so run() is a stackless coroutine built on a switch statement: the OS calls it again
+// after every completion, and it jumps back to where it last suspended. A suspension costs a single jump.
+// Anything that must survive a suspension has to be a member, including loop counters. The CO_ macros cannot
+// be used inside a switch statement of their own, and at most one of them can be on each line.
+class Coroutine_Thread : public Thread
+{
+public:
+	Coroutine_Thread() : Thread(), resume_point(0) {}
+protected:
+	virtual void run() = 0;
+	// Submits an IO without waiting for it
+	inline void issue(event_type type, long logical_address, int size = 1) { submit(new Event(type, logical_address, size, get_current_time())); }
+	int resume_point; // the line to resume from, 0 before the start and UNDEFINED at the end
+private:
+	void issue_first_IOs() { run(); }
+	void handle_event_completion(Event* event) { run(); }
+};
+
+#define CO_BEGIN switch (resume_point) { case 0:
+#define CO_END default: resume_point = UNDEFINED; }
+// Suspends until the condition holds. It is checked after each completion.
+#define CO_WAIT_UNTIL(condition) do { resume_point = __LINE__; case __LINE__: if (!(condition)) return; } while (0)
+#define CO_AWAIT_ALL() CO_WAIT_UNTIL(get_num_ongoing_IOs() == 0)
+#define CO_AWAIT_FEWER_THAN(num_IOs) CO_WAIT_UNTIL(get_num_ongoing_IOs() < (num_IOs))
+// Issues an IO and suspends until all outstanding IOs, including this one, have completed
+#define CO_AWAIT(type, logical_address) do { issue(type, logical_address); CO_AWAIT_ALL(); } while (0)
+
 /*
  * Class Heirarchy for generating IO types.
  */
@@ -74,6 +163,8 @@ class IO_Mode_Generator {
 public:
 	virtual ~IO_Mode_Generator() {};
 	virtual event_type next() = 0;
+	// Generates many IO types with a single virtual call
+	virtual void next_batch(event_type* types, int count) { for (int i = 0; i < count; i++) types[i] = next(); }
 	virtual void init() {}
     friend class boost::serialization::access;
     template<class Archive> void serialize(Archive & ar, const unsigned int version) {}
@@ -84,6 +175,7 @@ class WRITES : public IO_Mode_Generator {
 public:
 	~WRITES() {};
 	event_type next() { return WRITE; };
+	void next_batch(event_type* types, int count) { fill(types, types + count, WRITE); }
     friend class boost::serialization::access;
     template<class Archive> void serialize(Archive & ar, const unsigned int version) {
     	ar & boost::serialization::base_object<IO_Mode_Generator>(*this);
@@ -95,6 +187,7 @@ class TRIMS : public IO_Mode_Generator {
 public:
 	~TRIMS() {};
 	event_type next() { return TRIM; };
+	void next_batch(event_type* types, int count) { fill(types, types + count, TRIM); }
     friend class boost::serialization::access;
     template<class Archive> void serialize(Archive & ar, const unsigned int version) {
     	ar & boost::serialization::base_object<IO_Mode_Generator>(*this);
@@ -106,6 +199,7 @@ class READS : public IO_Mode_Generator {
 public:
 	~READS() {};
 	event_type next() { return READ; };
+	void next_batch(event_type* types, int count) { fill(types, types + count, READ); }
     friend class boost::serialization::access;
     template<class Archive> void serialize(Archive & ar, const unsigned int version) {
     	ar & boost::serialization::base_object<IO_Mode_Generator>(*this);
@@ -121,6 +215,9 @@ public:
 	~READS_OR_WRITES() {};
 	virtual void init() {  }
 	event_type next() { return random_number_generator() <= write_probability ? WRITE : READ; };
+	void next_batch(event_type* types, int count) {
+		for (int i = 0; i < count; i++) types[i] = random_number_generator() <= write_probability ? WRITE : READ;
+	}
     friend class boost::serialization::access;
     template<class Archive> void serialize(Archive & ar, const unsigned int version) {
     	ar & boost::serialization::base_object<IO_Mode_Generator>(*this);
@@ -142,6 +239,14 @@ public:
 	IO_Pattern(long min_LBA, long max_LBA) : min_LBA(min_LBA), max_LBA(max_LBA) {};
 	virtual ~IO_Pattern() {};
 	virtual int next() = 0;
+	// Generates many addresses with a single virtual call
+	virtual void next_batch(long* addresses, int count) { for (int i = 0; i < count; i++) addresses[i] = next(); }
+	// Returns the first page of an IO of the given size, which is shortened so that the IO does not run past max_LBA
+	virtual long next_extent(int& size) {
+		long address = next();
+		size = min((long)size, max_LBA - address + 1);
+		return address;
+	}
 	long min_LBA, max_LBA;
     friend class boost::serialization::access;
     template<class Archive>
@@ -159,6 +264,10 @@ public:
 	Random_IO_Pattern(long min_LBA, long max_LBA, ulong seed) : IO_Pattern(min_LBA, max_LBA), random_number_generator(seed) {};
 	~Random_IO_Pattern() {};
 	int next() { return min_LBA + random_number_generator() % (max_LBA - min_LBA + 1); };
+	void next_batch(long* addresses, int count) {
+		const ulong range = max_LBA - min_LBA + 1;
+		for (int i = 0; i < count; i++) addresses[i] = min_LBA + random_number_generator() % range;
+	}
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version) {
@@ -169,11 +278,12 @@ private:
 	MTRand_int32 random_number_generator;
 };
 
-// Creates a uniformly randomly distributed IO pattern acress the target logical address space
+// Visits every address in [min_LBA, max_LBA) exactly once in a random order, and then starts over in a new order.
+// The order is a keyed Feistel permutation, cycle-walked down to the address range, so it takes constant memory.
 class Random_IO_Pattern_Collision_Free : public IO_Pattern
 {
 public:
-	Random_IO_Pattern_Collision_Free() : IO_Pattern(), random_number_generator(23623620), counter(0) {}
+	Random_IO_Pattern_Collision_Free() : IO_Pattern(), random_number_generator(23623620), counter(0), half_bits(0) {}
 	Random_IO_Pattern_Collision_Free(long min_LBA, long max_LBA, ulong seed);
 	~Random_IO_Pattern_Collision_Free() {};
 	void reinit();
@@ -183,11 +293,17 @@ public:
     void serialize(Archive & ar, const unsigned int version) {
     	ar & boost::serialization::base_object<IO_Pattern>(*this);
     	ar & random_number_generator;
+    	ar & counter;
+    	ar & half_bits;
+    	ar & round_keys;
     }
 private:
+	ulong permute(ulong x) const;
+	static const int NUM_ROUNDS = 4;
 	MTRand_int32 random_number_generator;
-	vector<int> candidates;
-	int counter;
+	long counter;	// how many addresses have been visited in the current order
+	int half_bits;	// the permutation works on numbers of twice this many bits
+	ulong round_keys[NUM_ROUNDS];
 };
 
 // Creates a uniformly randomly distributed IO pattern acress the target logical address space
@@ -198,6 +314,16 @@ public:
 	Sequential_IO_Pattern(long min_LBA, long max_LBA) : IO_Pattern(min_LBA, max_LBA), counter(min_LBA - 1) {};
 	~Sequential_IO_Pattern() {};
 	int next() { return counter == max_LBA ? counter = min_LBA : ++counter; };
+	void next_batch(long* addresses, int count) {
+		for (int i = 0; i < count; i++) addresses[i] = counter == max_LBA ? counter = min_LBA : ++counter;
+	}
+	// Moves past the whole IO, so that consecutive IOs do not overlap. The IO reaching max_LBA is shortened, and the next one starts over at min_LBA.
+	long next_extent(int& size) {
+		long start = counter == max_LBA ? min_LBA : counter + 1;
+		size = min((long)size, max_LBA - start + 1);
+		counter = start + size - 1;
+		return start;
+	}
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version) {
@@ -208,6 +334,198 @@ private:
 	long counter;
 };
 
+// Samples an index from a discrete distribution in constant time, using Vose's alias method
+class Alias_Table
+{
+public:
+	Alias_Table() : probability(), alias() {}
+	Alias_Table(vector<double> const& weights);
+	// Maps a uniformly distributed number in [0, 1) to an index
+	inline int sample(double uniform) const {
+		double x = uniform * probability.size();
+		int i = min((int)x, (int)probability.size() - 1);
+		return x - i < probability[i] ? i : alias[i];
+	}
+	inline int size() const { return probability.size(); }
+private:
+	vector<double> probability;
+	vector<int> alias;
+};
+
+// Creates a skewed IO pattern across the target logical address space. The space is divided into buckets,
+// a bucket is picked with its weight, and the address is uniformly distributed within the bucket.
+// The hottest addresses are at the start of the space.
+class Skewed_IO_Pattern : public IO_Pattern
+{
+public:
+	Skewed_IO_Pattern(long min_LBA, long max_LBA, vector<double> const& weights, vector<long> const& bucket_sizes, ulong seed);
+	~Skewed_IO_Pattern() {};
+	static Skewed_IO_Pattern* zipf(long min_LBA, long max_LBA, double theta, ulong seed);
+	static Skewed_IO_Pattern* pareto(long min_LBA, long max_LBA, double shape, ulong seed);
+	// The deviation is a fraction of the address space, around its middle
+	static Skewed_IO_Pattern* normal(long min_LBA, long max_LBA, double deviation, ulong seed);
+	// Each zone gets a fraction of the accesses and a fraction of the address space. The remainder of both forms a last zone.
+	static Skewed_IO_Pattern* zoned(long min_LBA, long max_LBA, vector<double> const& access_fractions, vector<double> const& space_fractions, ulong seed);
+	int next();
+private:
+	static Skewed_IO_Pattern* from_mass(long min_LBA, long max_LBA, vector<long> const& bucket_sizes, function<double(long, long)> mass, ulong seed);
+	static vector<long> geometric_buckets(long num_LBAs);
+	static vector<long> equal_buckets(long num_LBAs);
+	static const long HEAD_RANKS = 1 << 10;
+	static const long MAX_BUCKETS = 1 << 20;
+	Alias_Table buckets;
+	vector<long> bucket_start; // one more entry than there are buckets
+	MTRand_open random_number_generator;
+};
+
+// Draws the size of each IO, in pages, from a discrete distribution
+class IO_Size_Generator
+{
+public:
+	IO_Size_Generator(vector<int> const& sizes, vector<double> const& weights, ulong seed);
+	inline int next() { return sizes[table.sample(random_number_generator())]; }
+	inline int get_largest() const { return largest; }
+private:
+	vector<int> sizes;
+	int largest;
+	Alias_Table table;
+	MTRand_open random_number_generator;
+};
+
+// Generates the types and addresses of IOs in bulk, so that the virtual calls to the generators are amortised over many IOs.
+// Since the two generators are independent, the IOs are the same as when they are generated one at a time.
+class IO_Batch
+{
+public:
+	IO_Batch() : types(), addresses(), cursor(0) {}
+	inline void next(IO_Mode_Generator* type_gen, IO_Pattern* address_gen, event_type& type, long& address) {
+		if (cursor == addresses.size()) {
+			refill(type_gen, address_gen);
+		}
+		type = types[cursor];
+		address = addresses[cursor++];
+	}
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+    	ar & types;
+    	ar & addresses;
+    	ar & cursor;
+    }
+private:
+	void refill(IO_Mode_Generator* type_gen, IO_Pattern* address_gen);
+	static const int SIZE = 256;
+	vector<event_type> types;
+	vector<long> addresses;
+	uint cursor;
+};
+
+/*
+ * Class Heirarchy for generating the arrival times of open loop threads
+ */
+class Arrival_Process
+{
+public:
+	virtual ~Arrival_Process() {}
+	// Returns the time in microseconds until the next arrival
+	virtual double next() = 0;
+};
+
+// Arrivals with exponentially distributed inter-arrival times, at the given rate in IOs per second
+class Poisson_Arrivals : public Arrival_Process
+{
+public:
+	Poisson_Arrivals(double rate, ulong seed) : rate(rate), random_number_generator(seed) {}
+	double next() { return -log(random_number_generator()) * 1000000 / rate; }
+private:
+	double rate;
+	MTRand_open random_number_generator;
+};
+
+// A two state Markov modulated Poisson process, which alternates between bursts and quiet periods.
+// Each state is held for an exponentially distributed time with the given mean in microseconds.
+class MMPP_Arrivals : public Arrival_Process
+{
+public:
+	MMPP_Arrivals(double burst_rate, double quiet_rate, double mean_burst_duration, double mean_quiet_duration, ulong seed);
+	double next();
+private:
+	double rate[2];
+	double mean_duration[2];
+	int state;
+	double time_left_in_state;
+	MTRand_open random_number_generator;
+};
+
+// Replays recorded arrival times, in microseconds, in order or by sampling their inter-arrival times at random.
+// Loops over the recording when it runs out.
+class Replayed_Arrivals : public Arrival_Process
+{
+public:
+	Replayed_Arrivals(vector<double> arrival_times, bool sample_randomly = false, ulong seed = 23623620);
+	// Reads one arrival time per line
+	static Replayed_Arrivals* from_file(string file_name, bool sample_randomly = false);
+	double next();
+private:
+	vector<double> inter_arrival_times;
+	uint index;
+	bool sample_randomly;
+	MTRand_int32 random_number_generator;
+};
+
+// An open loop thread issues IOs when they arrive, no matter how many of its IOs are still executing.
+// Under overload, IOs wait on the host, and this host queueing delay is reported apart from the device latency.
+class Open_Loop_Thread : public Thread
+{
+public:
+	Open_Loop_Thread(IO_Pattern* generator, IO_Mode_Generator* type, Arrival_Process* arrivals, long num_IOs);
+	~Open_Loop_Thread();
+	void set_io_size(int size) { io_size = size; }
+	// Takes ownership of the generator, which overrides the fixed IO size
+	void set_io_sizes(IO_Size_Generator* sizes) { io_sizes = sizes; }
+	void print_statistics() const;
+protected:
+	void issue_first_IOs();
+	void handle_event_completion(Event* event);
+	void handle_queue_drained();
+private:
+	void issue_next_arrival();
+	IO_Pattern* io_gen;
+	IO_Mode_Generator* io_type_gen;
+	Arrival_Process* arrivals;
+	long number_of_times_to_repeat;
+	int io_size; // in pages
+	IO_Size_Generator* io_sizes;
+	IO_Batch batch;
+	double next_arrival_time;
+	double first_arrival_time;
+	vector<double> host_queueing_delays;
+	vector<double> device_latencies;
+	vector<double> latencies;
+};
+
+// A closed loop thread that keeps up to a given number of IOs outstanding, as described by a job file section.
+// It can wait a think time after each completion before issuing the next IO, and draws IO sizes from a distribution.
+class Job_Thread : public Thread
+{
+public:
+	Job_Thread(IO_Pattern* generator, IO_Mode_Generator* type, IO_Size_Generator* sizes, int io_depth, long num_IOs);
+	~Job_Thread();
+	void set_think_time(double time) { think_time = time; }
+protected:
+	void issue_first_IOs();
+	void handle_event_completion(Event* event);
+private:
+	void generate_io(double start_time);
+	IO_Pattern* io_gen;
+	IO_Mode_Generator* io_type_gen;
+	IO_Size_Generator* io_sizes;
+	IO_Batch batch;
+	int io_depth;
+	long number_of_times_to_repeat;
+	double think_time; // microseconds
+};
+
 class File_Reading_Thread : public Thread {
 public:
 	File_Reading_Thread();
@@ -240,7 +558,7 @@ private:
 class Simple_Thread : public Thread
 {
 public:
-	Simple_Thread() : io_gen(NULL), io_type_gen(NULL), number_of_times_to_repeat(0), MAX_IOS(0), io_size(1) {}
+	Simple_Thread() : io_gen(NULL), io_type_gen(NULL), number_of_times_to_repeat(0), MAX_IOS(0), io_size(1), batch() {}
 	Simple_Thread(IO_Pattern* generator, int MAX_IOS, IO_Mode_Generator* type);
 	Simple_Thread(IO_Pattern* generator, IO_Mode_Generator* type, int MAX_IOS, long num_IOs);
 	virtual ~Simple_Thread();
@@ -258,6 +576,7 @@ public:
     	ar & io_gen;
     	ar & io_type_gen;
     	ar & io_size;
+    	ar & batch;
     }
 private:
 	long number_of_times_to_repeat;
@@ -265,6 +584,7 @@ private:
 	IO_Pattern* io_gen;
 	IO_Mode_Generator* io_type_gen;
 	int io_size; // in pages
+	IO_Batch batch;
 };
 
 
@@ -386,23 +706,21 @@ public:
 };
 
 
-// This thread simulates the IO pattern of an external sort algorithm
-class External_Sort : public Thread
+// This thread simulates the IO pattern of an external sort algorithm.
+// It sorts the relation in runs that fit in RAM and writes them to the free space, merges the runs, and then trims them.
+class External_Sort : public Coroutine_Thread
 {
 public:
 	External_Sort(long relation_min_LBA, long relation_max_LBA, long RAM_available,
 			long free_space_min_LBA, long free_space_max_LBA);
-	void issue_first_IOs();
-	Event* execute_first_phase();
-	Event* execute_second_phase();
-	Event* execute_third_phase();
-	void handle_event_completion(Event* event);
+protected:
+	void run();
 private:
-	long relation_min_LBA, relation_max_LBA, RAM_available, free_space_min_LBA, free_space_max_LBA, cursor, counter, number_finished;
+	long get_partition_size(int partition) const;
+	long relation_min_LBA, relation_max_LBA, RAM_available, free_space_min_LBA, free_space_max_LBA;
 	int num_partitions, num_pages_in_last_partition;
-	enum external_sort_phase {FIRST_PHASE_READ, FIRST_PHASE_WRITE, SECOND_PHASE, THIRD_PHASE, FINISHED};
-	external_sort_phase phase;
-	bool can_start_next_read;
+	int partition;
+	long offset;
 };
 
 // A thread that simulates the IO pattern of a grace hash join between two relations
@@ -633,22 +951,237 @@ private:
 class OS_Scheduler {
 public:
 	virtual ~OS_Scheduler() {}
-	virtual int pick(unordered_map<int, Thread*> const& threads) = 0;
+	// Returns the thread whose next IO the OS should dispatch at the given time, or UNDEFINED
+	virtual int pick(unordered_map<int, Thread*> const& threads, double time) = 0;
+	// The OS calls these whenever the IO at the head of a thread's queue changes, and when threads leave it.
+	// With host queues, a thread whose next IO starts later than the OS clock is removed until the clock gets there.
+	virtual void update(int thread_id, Thread const* thread) {}
+	virtual void remove(int thread_id) {}
+	virtual void clear() {}
+	// Called when an IO of the thread is dispatched to the device
+	virtual void register_dispatch(int thread_id, Thread const* thread, Event const* event) {}
+	// The time at which a thread that is currently held back by throttling may dispatch its next IO, or INFINITE
+	virtual double get_next_release_time() const { return INFINITE; }
+};
+
+// A min-heap of small non-negative ids that knows where each id is, so that the key of any id can be changed, or the id
+// removed, in O(log n). Equal keys are ordered by a second key, and then by id.
+class Indexed_Min_Heap {
+public:
+	Indexed_Min_Heap() : heap(), position() {}
+	void set(int id, double key, double tie = 0);
+	void remove(int id);
+	void clear();
+	inline bool contains(int id) const { return id < (int)position.size() && position[id] != UNDEFINED; }
+	inline bool empty() const { return heap.empty(); }
+	inline int top() const { return heap.front().id; }
+	inline double top_key() const { return heap.front().key; }
+private:
+	struct entry {
+		entry(double key, double tie, int id) : key(key), tie(tie), id(id) {}
+		double key;
+		double tie;
+		int id;
+	};
+	inline bool is_before(entry const& a, entry const& b) const {
+		return a.key < b.key || (a.key == b.key && (a.tie < b.tie || (a.tie == b.tie && a.id < b.id)));
+	}
+	void swap_entries(uint i, uint j);
+	void sift_up(uint i);
+	void sift_down(uint i);
+	vector<entry> heap;
+	vector<int> position;	// id -> index in the heap, or UNDEFINED
 };
 
 // This is a FIFO scheduler that implements a simple IO queue.
+// It keeps the threads with pending IOs in a ready queue: an indexed min-heap keyed by the time of their next IO,
+// so picking costs O(1) and an update O(log n), no matter how many threads are idle.
 class FIFO_OS_Scheduler : public OS_Scheduler {
 public:
-	int pick(unordered_map<int, Thread*> const& threads);
+	FIFO_OS_Scheduler() : ready() {}
+	int pick(unordered_map<int, Thread*> const& threads, double time);
+	void update(int thread_id, Thread const* thread);
+	void remove(int thread_id) { ready.remove(thread_id); }
+	void clear() { ready.clear(); }
+private:
+	Indexed_Min_Heap ready;
 };
 
 // This is a fair IO scheduler that tries to schedule IOs from different threads in round robin
+// It only picks the threads the OS has shown it through update, and not removed since.
 class FAIR_OS_Scheduler : public OS_Scheduler {
 public:
-	FAIR_OS_Scheduler() : last_id(0) {}
-	int pick(unordered_map<int, Thread*> const& threads);
+	FAIR_OS_Scheduler() : last_id(0), shown() {}
+	int pick(unordered_map<int, Thread*> const& threads, double time);
+	void update(int thread_id, Thread const* thread);
+	void remove(int thread_id);
+	void clear() { shown.clear(); }
 private:
+	inline bool is_shown(int thread_id) const { return thread_id < (int)shown.size() && shown[thread_id]; }
 	int last_id;
+	vector<bool> shown;		// thread id -> whether the OS has shown the thread
+};
+
+// The base of schedulers that share the device among tenants according to their Tenant_QoS.
+// A thread that is not in a tenant is a tenant of its own. The threads of a tenant are served in FIFO order.
+// A tenant with an IOPS or bandwidth limit is throttled by token buckets.
+// Like FIFO_OS_Scheduler, it follows the head of every thread through update and remove. Each tenant keeps its threads
+// in an indexed heap, whose top is the head IO of the tenant. A tenant whose head IO may be dispatched is queued by the
+// subclass in its own order, and one that waits for its tokens is queued by release time, so picking costs O(log T).
+class QoS_OS_Scheduler : public OS_Scheduler {
+public:
+	QoS_OS_Scheduler() : tenants(), tenants_by_index(), thread_table(), thread_tenants(), throttled(), next_release_time(INFINITE) {}
+	virtual ~QoS_OS_Scheduler() {}
+	int pick(unordered_map<int, Thread*> const& threads, double time);
+	void update(int thread_id, Thread const* thread);
+	void remove(int thread_id);
+	void clear();
+	void register_dispatch(int thread_id, Thread const* thread, Event const* event);
+	double get_next_release_time() const { return next_release_time; }
+protected:
+	struct token_bucket {
+		token_bucket() : rate(0), depth(0), tokens(0), last_update(0) {}
+		void init(double rate, double depth, double time);
+		double get_ready_time(double time, double cost) const;
+		void consume(double time, double cost);
+		double rate;		// tokens per microsecond, or 0 if unlimited
+		double depth;
+		double tokens;
+		double last_update;
+	};
+	struct tenant {
+		tenant() : key(0), index(0), qos(), iops_bucket(), bandwidth_bucket(), threads(), finish_tag(0), reservation_tag(0), limit_tag(0), proportional_tag(0) {}
+		int key;
+		int index;
+		Tenant_QoS qos;
+		token_bucket iops_bucket;
+		token_bucket bandwidth_bucket;
+		Indexed_Min_Heap threads;	// with pending IOs, by the time of their next IO
+		double finish_tag;			// WFQ
+		double reservation_tag;		// mClock
+		double limit_tag;			// mClock
+		double proportional_tag;	// mClock
+	};
+	// The earliest time at which the IO may be dispatched
+	virtual double get_release_time(tenant const& t, Event const* event) const;
+	// Subclasses queue the tenants whose head IO may be dispatched, and choose among them
+	virtual void enqueue(tenant const& t, Event const* head) = 0;
+	virtual void dequeue(tenant const& t) = 0;
+	// Returns the index of the tenant to serve, or UNDEFINED
+	virtual int choose(double time) = 0;
+	virtual void charge(tenant& t, double time, double cost) = 0;
+	Event const* get_head(tenant const& t) const;
+	static inline int get_key(int thread_id, Thread const* thread) { return thread->get_tenant() != UNDEFINED ? thread->get_tenant() : -thread_id - 1; }
+	map<int, tenant> tenants;
+	vector<tenant*> tenants_by_index;
+private:
+	tenant& get_tenant(int thread_id, Thread const* thread);
+	void reschedule(tenant& t);
+	vector<Thread const*> thread_table;
+	vector<int> thread_tenants;		// thread id -> tenant index, or UNDEFINED
+	Indexed_Min_Heap throttled;		// tenants whose head IO waits for tokens, by release time
+	double next_release_time;
+};
+
+// Start-time fair queueing. Tenants with pending IOs share the device in proportion to their weights.
+class WFQ_OS_Scheduler : public QoS_OS_Scheduler {
+public:
+	WFQ_OS_Scheduler() : QoS_OS_Scheduler(), backlogged(), virtual_time(0) {}
+	void clear();
+protected:
+	void enqueue(tenant const& t, Event const* head);
+	void dequeue(tenant const& t);
+	int choose(double time);
+	void charge(tenant& t, double time, double cost);
+private:
+	Indexed_Min_Heap backlogged;	// by start tag, and then by the time of the head IO
+	double virtual_time;
+};
+
+// mClock. Tenants first get their reservations, in order of their reservation tags. The remaining capacity is
+// shared in proportion to the weights, among tenants that are below their limit.
+class MClock_OS_Scheduler : public QoS_OS_Scheduler {
+public:
+	MClock_OS_Scheduler() : QoS_OS_Scheduler(), by_reservation(), by_weight(), virtual_time(0), picked_key(UNDEFINED), picked_by_reservation(false) {}
+	void clear();
+protected:
+	double get_release_time(tenant const& t, Event const* event) const;
+	void enqueue(tenant const& t, Event const* head);
+	void dequeue(tenant const& t);
+	int choose(double time);
+	void charge(tenant& t, double time, double cost);
+private:
+	double get_reservation_tag(tenant const& t, double time, double cost) const;
+	Indexed_Min_Heap by_reservation;	// tenants with a reservation, by reservation tag
+	Indexed_Min_Heap by_weight;		// by proportional start tag, and then by the time of the head IO
+	double virtual_time;		// the proportional tag of the last IO served by weight
+	int picked_key;
+	bool picked_by_reservation;
+};
+
+/* The link between the host and the SSD. Every command occupies the link for HOST_LINK_COMMAND_OVERHEAD on its way
+ * to the SSD, write data follows the command, and read data occupies the link on its way back to the host.
+ * Transfers in the same direction are served in the order they arrive. */
+class Host_Link
+{
+public:
+	Host_Link();
+	void transfer_to_device(Event* event);
+	void transfer_to_host(Event* event);
+	// in MB/s, which is also bytes per microsecond
+	static double get_bandwidth();
+	enum direction {TO_DEVICE, TO_HOST};
+private:
+	double reserve(direction dir, double time, double duration);
+	double bandwidth;
+	vector<double> free_at;		// the time at which the link is next free in each direction
+};
+
+/* An NVMe-style host interface with NVME_NUM_QUEUES submission/completion queue pairs.
+ * Every thread is bound to a queue. A queue has at most NVME_QUEUE_DEPTH outstanding commands, and further
+ * commands wait in a software queue on the host. The controller executes at most MAX_SSD_QUEUE_SIZE commands
+ * at a time, and fetches new commands from the submission queues according to NVME_ARBITRATION.
+ * A completion is reported to the host by an interrupt of its completion queue, which may be coalesced. */
+class Host_Interface
+{
+public:
+	Host_Interface(OperatingSystem* os);
+	~Host_Interface();
+	int bind(Thread* thread, int thread_id);
+	void submit(Event* event, int queue);
+	void register_completion(Event* event);
+	// The time at which the next coalesced interrupt fires, or INFINITE
+	double get_next_interrupt_time() const;
+	void raise_due_interrupts(double time);
+	bool is_controller_full() const;
+	void print_statistics() const;
+private:
+	struct queue_pair {
+		queue_pair();
+		host_queue_priority priority;
+		queue<Event*> software_queue;
+		queue<Event*> submission_queue;
+		vector<Event*> completion_queue;	// completions that were not yet reported by an interrupt
+		uint num_outstanding;
+		double interrupt_deadline;
+		long num_interrupts;
+		vector<double> latencies;
+	};
+	void fetch();
+	int arbitrate();
+	int pick_round_robin(vector<int> const& candidates, int& last);
+	bool is_eligible(int queue) const;
+	void raise_interrupt(int queue, double time);
+
+	OperatingSystem* os;
+	vector<queue_pair> queues;
+	int num_commands_in_device;
+	double time;
+	// Arbitration state
+	int current_queue;
+	uint num_fetched_in_burst;
+	vector<int> last_queue_per_priority;
+	vector<uint> credits_per_priority;
 };
 
 class OperatingSystem
@@ -664,33 +1197,62 @@ public:
 	void print_progess();
 	void register_event_completion(Event* event);
 	void set_num_writes_to_stop_after(long num_writes);
+	void print_statistics() const;
 	void set_progress_meter_granularity(int num) { progress_meter_granularity = num; }
 	Flexible_Reader* create_flexible_reader(vector<Address_Range>);
 	void submit(Event* event);
 	Ssd* get_ssd() { return ssd; }
+	Storage_Device* get_device() { return device; }
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
     {
     	ar & ssd;
+    	if (Archive::is_loading::value) {
+    		device = ssd;
+    	}
     }
 private:
+	friend class Host_Interface;
+	// An IO that was dispatched and has not completed yet. The IO carries the index of its slot.
+	struct in_flight_io {
+		in_flight_io() : thread(NULL), application_io_id(UNDEFINED), host_queue(UNDEFINED) {}
+		Thread* thread;
+		uint application_io_id;
+		int host_queue;
+	};
 	void dispatch_event(int thread_id);
+	int dispatch_ready_events();
+	void deliver_completion(Event* event);
+	void submit_to_device(Event* event);
+	int get_host_queue(Event const* event) const { return in_flight[event->get_os_slot()].host_queue; }
+	bool is_finished_experiment() const { return NUM_WRITES_TO_STOP_AFTER != UNDEFINED && NUM_WRITES_TO_STOP_AFTER <= num_writes_completed; }
+	friend class Thread;
+	void register_queue_head_change(Thread const* thread);
+	void register_thread(int thread_id, Thread* thread);
+	void update_scheduler(int thread_id, Thread const* thread);
+	void release_held_threads();
 	double get_event_minimal_completion_time(Event const*const event) const;
 	void setup_follow_up_threads(int thread_id, double time);
-	Ssd * ssd;
+	Ssd * ssd;				// NULL if the OS runs on top of a RAID array or tiered storage
+	Storage_Device* device;
 	unordered_map<int, Thread*> threads;
+	vector<Thread*> thread_table;		// thread id -> thread, NULL once the thread has left
 	vector<Thread*> historical_threads;
-	unordered_map<long, long> app_id_to_thread_id_mapping;
-	set<uint> currently_executing_ios;
+	vector<in_flight_io> in_flight;
+	vector<int> free_slots;
+	int num_in_flight;
 	long NUM_WRITES_TO_STOP_AFTER;
 	long num_writes_completed;
 	int counter_for_user;
-	int idle_time;
 	double time;
 	static int thread_id_generator;
 	OS_Scheduler* scheduler;
+	Indexed_Min_Heap held_threads;		// with host queues, the threads whose next IO starts later than the OS clock, by its start time
 	int progress_meter_granularity;
+	Host_Interface* host_interface;		// NULL if the OS talks to the device through a single queue
+	vector<int> thread_id_to_host_queue;
+	Host_Link* host_link;			// NULL if the host link is not modelled
 };
 
 }
@@ -165,6 +165,20 @@ bool IOScheduler::is_empty() {
 	return current_events->empty() && future_events->empty() && overdue_events->empty();
 }
 
+// The time of the soonest event that execute_soonest_events will act on,
+// including application IOs that have completed but were not yet sent back to the SSD
+double IOScheduler::get_next_event_time() const {
+	bool nothing_pending = current_events->empty() && overdue_events->empty() && future_events->empty();
+	if (nothing_pending) {
+		return completed_events->get_earliest_time();
+	}
+	double time = get_current_time();
+	if (!completed_events->empty()) {
+		time = min(time, completed_events->get_earliest_time());
+	}
+	return time;
+}
+
 double IOScheduler::get_soonest_event_time(vector<Event*> const& events) const {
 	double earliest_time = events.front()->get_current_time();
 	for (uint i = 1; i < events.size(); i++) {
@@ -260,7 +274,7 @@ void IOScheduler::handle(Event* event) {
 
 // executes read_commands, read_transfers and erases
 void IOScheduler::handle_event(Event* event) {
-	double time = bm->in_how_long_can_this_event_be_scheduled(event->get_address(), event->get_current_time());
+	double time = bm->in_how_long_can_this_event_be_scheduled(event->get_address(), event->get_current_time(), event->get_event_type());
 	bool can_schedule = bm->can_schedule_on_die(event->get_address(), event->get_event_type(), event->get_application_io_id());
 	if (!can_schedule) {
 		event->incr_bus_wait_time(BUS_DATA_DELAY + BUS_CTRL_DELAY + time);
@@ -282,7 +296,7 @@ void IOScheduler::handle_read(Event* event) {
 		i++;
 	}
 
-	double time = bm->in_how_long_can_this_event_be_scheduled(event->get_address(), event->get_current_time());
+	double time = bm->in_how_long_can_this_event_be_scheduled(event->get_address(), event->get_current_time(), event->get_event_type());
 	bool can_schedule = bm->can_schedule_on_die(event->get_address(), event->get_event_type(), event->get_application_io_id());
 
 	if (event->get_application_io_id() == 1622620) {
@@ -384,7 +398,7 @@ void IOScheduler::handle_write(Event* event) {
 		addr = bm->choose_write_address(*event);
 	}
 	try_to_put_in_safe_cache(event);
-	double wait_time = bm->in_how_long_can_this_event_be_scheduled(addr, event->get_current_time(), WRITE);
+	double wait_time = bm->in_how_long_can_this_event_be_scheduled(addr, event->get_current_time(), event->get_event_type());
 	//double wait_time = bm->in_how_long_can_this_write_be_scheduled2(event->get_current_time());
 
 	if (addr.valid == NONE && event->get_event_type() == COPY_BACK) {
@@ -434,10 +448,10 @@ bool IOScheduler::should_event_be_scheduled(Event* event) {
 void IOScheduler::remove_current_operation(Event* event) {
 	event->set_noop(true);
 	if (event->get_event_type() == READ_TRANSFER) {
-		ssd->get_package(event->get_address().package)->get_die(event->get_address().die)->clear_register();
+		ssd->get_package(event->get_address().package)->get_die(event->get_address().die)->clear_register(event->get_address().plane, event->get_application_io_id());
 		bm->register_register_cleared();
 	} else if (event->get_event_type() == COPY_BACK) {
-		ssd->get_package(event->get_replace_address().package)->get_die(event->get_replace_address().die)->clear_register();
+		ssd->get_package(event->get_replace_address().package)->get_die(event->get_replace_address().die)->clear_register(event->get_replace_address().plane, event->get_application_io_id());
 		bm->register_register_cleared();
 	}
 }
@@ -512,13 +526,15 @@ void IOScheduler::setup_dependent_event(Event* event, Event* dependent) {
 	//dependent->incr_os_wait_time(event->get_os_wait_time());
 	dependent->incr_accumulated_wait_time(diff);
 	dependent->incr_pure_ssd_wait_time(event->get_bus_wait_time() + event->get_execution_time());
-	if (dependent->get_current_time() != event->get_current_time()) {
+	// The times are sums of different wait times, so they may differ by rounding
+	bool same_time = fabs(dependent->get_current_time() - event->get_current_time()) < 0.00001;
+	if (!same_time) {
 		printf("%f\n", dependent->get_current_time());
 		printf("%f\n", event->get_current_time());
 		dependent->print();
 		event->print();
 	}
-	assert(dependent->get_current_time() == event->get_current_time());
+	assert(same_time);
 	dependent->set_noop(event->get_noop());
 
 	// The dependent event might have a different LBA and type - record this in bookkeeping maps
@@ -761,7 +777,8 @@ void IOScheduler::init_event(Event* event) {
 
 
 void IOScheduler::trigger_next_migration(Event* event) {
-	if (!migrator->more_migrations(event)) {
+	// A GC read that was cancelled before it got an address does not tell which block's migrations depend on it
+	if (event->get_address().valid == NONE || !migrator->more_migrations(event)) {
 		return;
 	}
 	deque<Event*> migration = migrator->trigger_next_migration(event);
@@ -856,11 +873,13 @@ void IOScheduler::remove_redundant_events(Event* new_event) {
 	}
 
 	if (IS_FTL_PAGE_MAPPING && new_event->is_garbage_collection_op() && scheduled_op_code == WRITE) {
+		// a flush of the write buffer is neither an application IO nor a GC op, so check the latter before promoting
+		bool existing_event_is_gc = existing_event->is_garbage_collection_op();
 		promote_to_gc(existing_event);
 		remove_current_operation(new_event);
 		push(new_event); // Make sure the old GC READ is run, even though it is now a NOOP command
 		LBA_currently_executing[common_logical_address] = dependency_code_of_other_event;
-		if (existing_event->is_garbage_collection_op() && !existing_event->is_original_application_io() && !existing_event->is_mapping_op()) {
+		if (existing_event_is_gc && !existing_event->is_original_application_io() && !existing_event->is_mapping_op()) {
 			bm->register_trim_making_gc_redundant(new_event);
 		}
 	}
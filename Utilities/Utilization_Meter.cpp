@@ -5,12 +5,18 @@ vector<double> Utilization_Meter::channel_used 		= vector<double>();
 vector<double> Utilization_Meter::channel_unused 	= vector<double>();
 vector<double> Utilization_Meter::LUNs_used 		= vector<double>();
 vector<double> Utilization_Meter::LUNs_unused 		= vector<double>();
+vector<double> Utilization_Meter::host_link_used 	= vector<double>(2, 0);
+double Utilization_Meter::host_link_first_use 		= UNDEFINED;
+double Utilization_Meter::host_link_last_use 		= 0;
 
 void Utilization_Meter::init() {
 	Utilization_Meter::channel_used = vector<double>(SSD_SIZE, 0);
 	Utilization_Meter::channel_unused = vector<double>(SSD_SIZE, 0);
 	Utilization_Meter::LUNs_used = vector<double>(SSD_SIZE * PACKAGE_SIZE, 0);
 	Utilization_Meter::LUNs_unused = vector<double>(SSD_SIZE * PACKAGE_SIZE, 0);
+	Utilization_Meter::host_link_used = vector<double>(2, 0);
+	Utilization_Meter::host_link_first_use = UNDEFINED;
+	Utilization_Meter::host_link_last_use = 0;
 }
 
 void Utilization_Meter::register_event(double prev_time, double duration, Event const& event, address_valid gran) {
@@ -40,6 +46,11 @@ void Utilization_Meter::print() {
 		double util = channel_used[i] / (channel_used[i] + channel_unused[i]);
 		printf("C%d\t%f\n", i, util);
 	}
+	if (host_link_first_use != UNDEFINED) {
+		printf("\nHost Link Utilization\n");
+		printf("to device\t%f\n", get_host_link_utilization(Host_Link::TO_DEVICE));
+		printf("to host\t\t%f\n", get_host_link_utilization(Host_Link::TO_HOST));
+	}
 	/*printf("\nLUN Utilization\n");
 	for (uint i = 0; i < SSD_SIZE * PACKAGE_SIZE; i++) {
 		double util = LUNs_used[i] / (LUNs_used[i] + LUNs_unused[i]);
@@ -70,3 +81,17 @@ double Utilization_Meter::get_avg_LUN_utilization() {
 	}
 	return avg / (SSD_SIZE * PACKAGE_SIZE);
 }
+
+// A half duplex link registers all transfers in the TO_DEVICE direction
+void Utilization_Meter::register_host_link_transfer(int direction, double start_time, double duration) {
+	if (host_link_first_use == UNDEFINED) {
+		host_link_first_use = start_time;
+	}
+	host_link_used[direction] += duration;
+	host_link_last_use = max(host_link_last_use, start_time + duration);
+}
+
+double Utilization_Meter::get_host_link_utilization(int direction) {
+	double period = host_link_last_use - host_link_first_use;
+	return host_link_first_use == UNDEFINED || period <= 0 ? 0 : host_link_used[direction] / period;
+}
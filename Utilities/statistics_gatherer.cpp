@@ -10,6 +10,7 @@ using namespace ssd;
 #include <stdio.h>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
 
 StatisticsGatherer *StatisticsGatherer::inst = NULL;
 
@@ -25,6 +26,9 @@ StatisticsGatherer::StatisticsGatherer()
 	  num_reads_per_LUN(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
 	  num_mapping_reads_per_LUN(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
 	  num_mapping_writes_per_LUN(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
+	  num_buffer_flush_writes_per_LUN(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
+	  num_writes_served_from_ram(0),
+	  num_reads_served_from_ram(0),
 	  bus_wait_time_for_writes_per_LUN(SSD_SIZE, vector<vector<double> >(PACKAGE_SIZE, vector<double>())),
 	  num_writes_per_LUN(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
 	  num_gc_reads_per_LUN(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
@@ -49,7 +53,9 @@ StatisticsGatherer::StatisticsGatherer()
 	  num_gc_targeting_anything(0),
 	  num_wl_writes_per_LUN_origin(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
 	  num_wl_writes_per_LUN_destination(SSD_SIZE, vector<uint>(PACKAGE_SIZE, 0)),
-	  end_time(0)
+	  end_time(0),
+	  tenant_stats(),
+	  host_stats()
 {}
 
 vector<vector<double> > num_valid_pages_per_gc_op;
@@ -70,6 +76,103 @@ StatisticsGatherer *StatisticsGatherer::get_global_instance()
 	return inst;
 }
 
+// Prints a row of a latency table: count, average, p50, p90, p99, p99.9 and max
+void StatisticsGatherer::print_latency_distribution(string name, vector<double> latencies) {
+	if (latencies.empty()) {
+		return;
+	}
+	sort(latencies.begin(), latencies.end());
+	double sum = 0;
+	for (auto l : latencies) sum += l;
+	printf("%s\t%lu\t%f\t", name.c_str(), latencies.size(), sum / latencies.size());
+	const double percentiles[] = {0.5, 0.9, 0.99, 0.999, 1};
+	for (auto p : percentiles) {
+		uint index = min((uint)latencies.size() - 1, (uint)ceil(p * latencies.size()) - 1);
+		printf("%f\t", latencies[index]);
+	}
+	printf("\n");
+}
+
+void StatisticsGatherer::host_io_statistics::add(Event const& event) {
+	double latency = event.get_current_time() - event.get_start_time();
+	if (event.get_event_type() == WRITE) {
+		num_writes++;
+		write_latencies.push_back(latency);
+	} else if (event.get_event_type() == READ || event.get_event_type() == READ_TRANSFER) {
+		num_reads++;
+		read_latencies.push_back(latency);
+	} else {
+		return;
+	}
+	num_pages += event.get_size();
+	if (first_start_time < 0 || event.get_start_time() < first_start_time) {
+		first_start_time = event.get_start_time();
+	}
+	last_completion_time = max(last_completion_time, event.get_current_time());
+}
+
+double StatisticsGatherer::host_io_statistics::get_iops() const {
+	double duration = last_completion_time - first_start_time;
+	return duration <= 0 ? 0 : (num_reads + num_writes) * 1000000 / duration;
+}
+
+void StatisticsGatherer::register_tenant_completion(int tenant, Event const& event) {
+	if (!record_statistics || event.get_noop()) {
+		return;
+	}
+	tenant_stats[tenant].add(event);
+}
+
+void StatisticsGatherer::register_host_completion(Event const& event) {
+	if (!record_statistics || event.get_noop()) {
+		return;
+	}
+	host_stats.add(event);
+}
+
+double StatisticsGatherer::get_host_avg_latency() const {
+	double sum = 0;
+	for (auto l : host_stats.read_latencies) sum += l;
+	for (auto l : host_stats.write_latencies) sum += l;
+	long count = host_stats.read_latencies.size() + host_stats.write_latencies.size();
+	return count == 0 ? 0 : sum / count;
+}
+
+// Returns the latency below which the given fraction of the application IOs completed
+double StatisticsGatherer::get_host_latency_percentile(double percentile) const {
+	vector<double> latencies = host_stats.read_latencies;
+	latencies.insert(latencies.end(), host_stats.write_latencies.begin(), host_stats.write_latencies.end());
+	if (latencies.empty()) {
+		return 0;
+	}
+	uint index = min((uint)latencies.size() - 1, (uint)max(ceil(percentile * latencies.size()) - 1, 0.0));
+	nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+	return latencies[index];
+}
+
+void StatisticsGatherer::print_tenant_statistics() const {
+	if (tenant_stats.empty()) {
+		return;
+	}
+	printf("\nTenants\n");
+	printf("\treads\twrites\tIOPS\t\tMB/s\n");
+	for (auto const& entry : tenant_stats) {
+		host_io_statistics const& stats = entry.second;
+		double duration = stats.last_completion_time - stats.first_start_time;
+		double iops = stats.get_iops();
+		double bandwidth = duration <= 0 ? 0 : stats.num_pages * PAGE_SIZE / duration;
+		printf("T%d\t%ld\t%ld\t%f\t%f\n", entry.first, stats.num_reads, stats.num_writes, iops, bandwidth);
+	}
+	printf("\n\tcount\tavg\t\tp50\t\tp90\t\tp99\t\tp99.9\t\tmax\n");
+	for (auto const& entry : tenant_stats) {
+		stringstream name;
+		name << "T" << entry.first;
+		print_latency_distribution(name.str() + " reads", entry.second.read_latencies);
+		print_latency_distribution(name.str() + " writes", entry.second.write_latencies);
+	}
+	printf("\n");
+}
+
 void StatisticsGatherer::register_completed_event(Event const& event) {
 	if (!record_statistics) {
 		return;
@@ -86,7 +189,11 @@ void StatisticsGatherer::register_completed_event(Event const& event) {
 	}
 
 	Address a = event.get_address();
-	if (event.get_event_type() == WRITE || event.get_event_type() == COPY_BACK) {
+	// An IO that the controller's write buffer or read cache completed used no die
+	if (event.is_served_from_ram()) {
+		if (event.get_event_type() == WRITE) num_writes_served_from_ram++;
+		else num_reads_served_from_ram++;
+	} else if (event.get_event_type() == WRITE || event.get_event_type() == COPY_BACK) {
 		if (event.is_original_application_io()) {
 			num_writes_per_LUN[a.package][a.die]++;
 			bus_wait_time_for_writes_per_LUN[a.package][a.die].push_back(event.get_latency());
@@ -117,6 +224,9 @@ void StatisticsGatherer::register_completed_event(Event const& event) {
 		else if (event.is_mapping_op()) {
 			num_mapping_writes_per_LUN[a.package][a.die]++;
 		}
+		else if (event.is_buffer_flush()) {
+			num_buffer_flush_writes_per_LUN[a.package][a.die]++;
+		}
 	} else if (event.get_event_type() == READ_TRANSFER) {
 		if (event.is_original_application_io()) {
 			bus_wait_time_for_reads_per_LUN[a.package][a.die].push_back(event.get_latency());
@@ -446,6 +556,31 @@ void StatisticsGatherer::print_mapping_info() {
 	printf("\n\n");
 }
 
+void StatisticsGatherer::print_controller_ram_info() {
+	int all_flush_writes = get_sum(num_buffer_flush_writes_per_LUN);
+	if (all_flush_writes == 0 && num_writes_served_from_ram == 0 && num_reads_served_from_ram == 0) {
+		return;
+	}
+
+	printf("\n\t");
+	printf("flush writes\t");
+	printf("\n");
+
+	for (uint i = 0; i < SSD_SIZE; i++) {
+		for (uint j = 0; j < PACKAGE_SIZE; j++) {
+			printf("C%d D%d\t", i, j);
+			printf("%d\t\t", num_buffer_flush_writes_per_LUN[i][j]);
+			printf("\n");
+		}
+	}
+
+	printf("\nTotals:\t");
+	printf("%d\t\t", all_flush_writes);
+	printf("\n");
+	printf("writes served from RAM:\t%d\n", num_writes_served_from_ram);
+	printf("reads served from RAM:\t%d\n\n", num_reads_served_from_ram);
+}
+
 void StatisticsGatherer::print_simple(FILE* stream) {
 
 	vector<double> all_write_latency;
@@ -605,11 +740,11 @@ vector<string> StatisticsGatherer::totals_vector_header() {
 }
 
 uint StatisticsGatherer::total_reads() const {
-	return get_sum(num_reads_per_LUN);
+	return get_sum(num_reads_per_LUN) + num_reads_served_from_ram;
 }
 
 uint StatisticsGatherer::total_writes() const {
-	return get_sum(num_writes_per_LUN);
+	return get_sum(num_writes_per_LUN) + num_writes_served_from_ram;
 }
 
 double StatisticsGatherer::get_reads_throughput() const {
@@ -919,8 +1054,8 @@ uint SsdStatisticsExtractor::max_age() {
 		for (uint j = 0; j < PACKAGE_SIZE; j++) {
 			for (uint k = 0; k < DIE_SIZE; k++) {
 				for (uint t = 0; t < PLANE_SIZE; t++) {
-					Block* block = get_instance()->ssd.get_package(i)->get_die(j)->get_plane(k)->get_block(t);
-					uint age = BLOCK_ERASES - block->get_erases_remaining();
+					Block block = get_instance()->ssd.get_package(i)->get_die(j)->get_plane(k)->get_block(t);
+					uint age = BLOCK_ERASES - block.get_erases_remaining();
 					max_age = max(age, max_age);
 				}
 			}
@@ -936,8 +1071,8 @@ uint SsdStatisticsExtractor::max_age_freq() {
 		for (uint j = 0; j < PACKAGE_SIZE; j++) {
 			for (uint k = 0; k < DIE_SIZE; k++) {
 				for (uint t = 0; t < PLANE_SIZE; t++) {
-					Block* block = get_instance()->ssd.get_package(i)->get_die(j)->get_plane(k)->get_block(t);
-					uint age = BLOCK_ERASES - block->get_erases_remaining();
+					Block block = get_instance()->ssd.get_package(i)->get_die(j)->get_plane(k)->get_block(t);
+					uint age = BLOCK_ERASES - block.get_erases_remaining();
 					age_histogram[floor((double) age / age_histogram_bin_size)*age_histogram_bin_size]++;
 				}
 			}
@@ -957,8 +1092,8 @@ string SsdStatisticsExtractor::age_histogram_csv() {
 		for (uint j = 0; j < PACKAGE_SIZE; j++) {
 			for (uint k = 0; k < DIE_SIZE; k++) {
 				for (uint t = 0; t < PLANE_SIZE; t++) {
-					Block* block = get_instance()->ssd.get_package(i)->get_die(j)->get_plane(k)->get_block(t);
-					uint age = BLOCK_ERASES - block->get_erases_remaining();
+					Block block = get_instance()->ssd.get_package(i)->get_die(j)->get_plane(k)->get_block(t);
+					uint age = BLOCK_ERASES - block.get_erases_remaining();
 					age_histogram[floor((double) age / age_histogram_bin_size)*age_histogram_bin_size]++;
 				}
 			}
@@ -11,16 +11,17 @@ using namespace ssd;
 
 Workload_Definition::Workload_Definition() :
 		min_lba(0),
-		max_lba(OVER_PROVISIONING_FACTOR * NUMBER_OF_ADDRESSABLE_BLOCKS() * BLOCK_SIZE)
+		max_lba(0)
 {}
 
-void Workload_Definition::recalculate_lba_range() {
+// The workload spans the logical space of the device the operating system submits to
+void Workload_Definition::recalculate_lba_range(OperatingSystem* os) {
 	min_lba = 0;
-	max_lba = OVER_PROVISIONING_FACTOR * NUMBER_OF_ADDRESSABLE_PAGES();
+	max_lba = os->get_device()->get_num_logical_pages();
 }
 
-vector<Thread*> Workload_Definition::generate_instance() {
-	recalculate_lba_range();
+vector<Thread*> Workload_Definition::generate_instance(OperatingSystem* os) {
+	recalculate_lba_range(os);
 	return generate();
 }
 
@@ -95,6 +96,233 @@ vector<Thread*> Asynch_Random_Workload::generate() {
 	return threads;
 }
 
+//*****************************************************************************************
+//				Open-loop RANDOM WORKLOAD
+//*****************************************************************************************
+
+Open_Loop_Workload::Open_Loop_Workload(double arrival_rate, double writes_probability)
+	: arrival_rate(arrival_rate), writes_probability(writes_probability) {}
+
+vector<Thread*> Open_Loop_Workload::generate() {
+	IO_Pattern* pattern = new Random_IO_Pattern(min_lba, max_lba, 6271);
+	IO_Mode_Generator* mode = new READS_OR_WRITES(3467, writes_probability);
+	Thread* thread = new Open_Loop_Thread(pattern, mode, new Poisson_Arrivals(arrival_rate, 8423), INFINITE);
+	return vector<Thread*>(1, thread);
+}
+
+//*****************************************************************************************
+//				Job file workload
+//*****************************************************************************************
+
+static string trim_whitespace(string const& str) {
+	size_t first = str.find_first_not_of(" \t\r\n");
+	size_t last = str.find_last_not_of(" \t\r\n");
+	return first == string::npos ? "" : str.substr(first, last - first + 1);
+}
+
+// Parses lists such as 80/20:15/30, as used by bssplit and zoned distributions
+static vector<pair<double, double> > parse_pairs(string const& value, string const& option) {
+	vector<pair<double, double> > pairs;
+	stringstream ss(value);
+	string entry;
+	while (getline(ss, entry, ':')) {
+		double first, second;
+		if (sscanf(entry.c_str(), "%lf/%lf", &first, &second) != 2) {
+			fprintf(stderr, "Could not parse '%s' in the %s option of a job file. Expected entries like 80/20 separated by colons.\n", entry.c_str(), option.c_str());
+			throw;
+		}
+		pairs.push_back(pair<double, double>(first, second));
+	}
+	return pairs;
+}
+
+Job_File_Workload::Job_File_Workload(string file_name)
+	: Workload_Definition(),
+	  file_name(file_name),
+	  jobs()
+{
+	const string known_options[] = {"rw", "readwrite", "rwmixread", "rwmixwrite", "bs", "bssplit", "iodepth", "numjobs", "offset", "size",
+			"random_distribution", "thinktime", "rate_iops", "number_ios", "randseed", "wait_for"};
+	const string* known_options_end = known_options + sizeof(known_options) / sizeof(known_options[0]);
+	ifstream file(file_name.c_str());
+	if (!file.is_open()) {
+		fprintf(stderr, "Could not open the job file %s\n", file_name.c_str());
+		throw;
+	}
+	job_options global;
+	job_options* current = NULL;
+	string line;
+	for (int line_number = 1; getline(file, line); line_number++) {
+		line = trim_whitespace(line.substr(0, line.find_first_of("#;")));
+		if (line.empty()) {
+			continue;
+		}
+		if (line[0] == '[') {
+			size_t end = line.find(']');
+			if (end == string::npos) {
+				fprintf(stderr, "Job file %s, line %d: the section name is not closed with ]\n", file_name.c_str(), line_number);
+				throw;
+			}
+			string name = trim_whitespace(line.substr(1, end - 1));
+			if (name == "global") {
+				current = &global;
+			} else {
+				jobs.push_back(pair<string, job_options>(name, global));
+				current = &jobs.back().second;
+			}
+			continue;
+		}
+		size_t equals = line.find('=');
+		string key = trim_whitespace(line.substr(0, equals));
+		string value = equals == string::npos ? "" : trim_whitespace(line.substr(equals + 1));
+		if (current == NULL) {
+			fprintf(stderr, "Job file %s, line %d: option %s is not inside a section\n", file_name.c_str(), line_number, key.c_str());
+			throw;
+		}
+		if (find(known_options, known_options_end, key) == known_options_end) {
+			fprintf(stderr, "Job file %s, line %d: unknown option %s\n", file_name.c_str(), line_number, key.c_str());
+			throw;
+		}
+		(*current)[key == "readwrite" ? "rw" : key] = value;
+	}
+	if (jobs.empty()) {
+		fprintf(stderr, "The job file %s does not define any jobs\n", file_name.c_str());
+		throw;
+	}
+}
+
+string Job_File_Workload::get_option(job_options const& options, string name, string default_value) {
+	job_options::const_iterator it = options.find(name);
+	return it == options.end() || it->second.empty() ? default_value : it->second;
+}
+
+// Addresses are given in pages, or as a percentage of the logical address space of the workload
+long Job_File_Workload::get_address(job_options const& options, string name, long default_value) const {
+	string value = get_option(options, name, "");
+	if (value.empty()) {
+		return default_value;
+	}
+	if (value[value.size() - 1] == '%') {
+		return round(atof(value.c_str()) / 100 * (max_lba - min_lba + 1));
+	}
+	return atol(value.c_str());
+}
+
+// Jobs start together, unless they wait for an earlier job. They then start when the first copy of that job finishes.
+vector<Thread*> Job_File_Workload::generate() {
+	map<string, Thread*> first_copies;
+	vector<Thread*> threads;
+	for (auto const& job : jobs) {
+		int num_copies = atoi(get_option(job.second, "numjobs", "1").c_str());
+		string wait_for = get_option(job.second, "wait_for", "");
+		if (!wait_for.empty() && first_copies.count(wait_for) == 0) {
+			fprintf(stderr, "Job %s waits for job %s, which is not defined before it in %s\n", job.first.c_str(), wait_for.c_str(), file_name.c_str());
+			throw;
+		}
+		for (int copy = 0; copy < num_copies; copy++) {
+			Thread* thread = create_thread(job.first, job.second, copy);
+			if (copy == 0) {
+				first_copies[job.first] = thread;
+			}
+			if (wait_for.empty()) {
+				threads.push_back(thread);
+			} else {
+				first_copies[wait_for]->add_follow_up_thread(thread);
+			}
+		}
+	}
+	return threads;
+}
+
+Thread* Job_File_Workload::create_thread(string const& job_name, job_options const& options, int copy) {
+	ulong seed = strtoul(get_option(options, "randseed", "23623").c_str(), NULL, 10) + hash<string>()(job_name) % 100003 + copy * 7919;
+
+	long first_lba = min_lba + get_address(options, "offset", 0);
+	long last_lba = min(max_lba, first_lba + get_address(options, "size", max_lba - first_lba + 1) - 1);
+	if (first_lba > last_lba) {
+		fprintf(stderr, "Job %s does not cover any logical addresses\n", job_name.c_str());
+		throw;
+	}
+
+	string rw = get_option(options, "rw", "read");
+	bool random = rw.compare(0, 4, "rand") == 0;
+	string mode = random ? rw.substr(4) : rw;
+	IO_Mode_Generator* type;
+	if (mode == "read") {
+		type = new READS();
+	} else if (mode == "write") {
+		type = new WRITES();
+	} else if (mode == "trim") {
+		type = new TRIMS();
+	} else if (mode == "rw" || mode == "readwrite") {
+		string rwmixwrite = get_option(options, "rwmixwrite", "");
+		double write_percentage = rwmixwrite.empty() ? 100 - atof(get_option(options, "rwmixread", "50").c_str()) : atof(rwmixwrite.c_str());
+		type = new READS_OR_WRITES(seed * 3 + 1, write_percentage / 100);
+	} else {
+		fprintf(stderr, "Job %s has an unknown rw mode %s\n", job_name.c_str(), rw.c_str());
+		throw;
+	}
+
+	IO_Pattern* pattern;
+	string distribution = get_option(options, "random_distribution", "random");
+	string distribution_name = distribution.substr(0, distribution.find(':'));
+	string parameter = distribution.find(':') == string::npos ? "" : distribution.substr(distribution.find(':') + 1);
+	if (!random) {
+		pattern = new Sequential_IO_Pattern(first_lba, last_lba);
+	} else if (distribution_name == "random") {
+		pattern = new Random_IO_Pattern(first_lba, last_lba, seed);
+	} else if (distribution_name == "zipf") {
+		pattern = Skewed_IO_Pattern::zipf(first_lba, last_lba, atof(parameter.c_str()), seed);
+	} else if (distribution_name == "pareto") {
+		pattern = Skewed_IO_Pattern::pareto(first_lba, last_lba, atof(parameter.c_str()), seed);
+	} else if (distribution_name == "normal") {
+		pattern = Skewed_IO_Pattern::normal(first_lba, last_lba, atof(parameter.c_str()) / 100, seed);
+	} else if (distribution_name == "zoned") {
+		vector<double> access_fractions, space_fractions;
+		for (auto zone : parse_pairs(parameter, "random_distribution")) {
+			access_fractions.push_back(zone.first / 100);
+			space_fractions.push_back(zone.second / 100);
+		}
+		pattern = Skewed_IO_Pattern::zoned(first_lba, last_lba, access_fractions, space_fractions, seed);
+	} else {
+		fprintf(stderr, "Job %s has an unknown random_distribution %s\n", job_name.c_str(), distribution.c_str());
+		throw;
+	}
+
+	vector<int> sizes;
+	vector<double> weights;
+	string bssplit = get_option(options, "bssplit", "");
+	if (bssplit.empty()) {
+		sizes.push_back(atoi(get_option(options, "bs", "1").c_str()));
+		weights.push_back(1);
+	} else {
+		for (auto split : parse_pairs(bssplit, "bssplit")) {
+			sizes.push_back(split.first);
+			weights.push_back(split.second);
+		}
+	}
+	IO_Size_Generator* io_sizes = new IO_Size_Generator(sizes, weights, seed * 5 + 2);
+
+	string number_ios = get_option(options, "number_ios", "");
+	// A sequential job covers its range once by default
+	double mean_size = 0, total_weight = 0;
+	for (uint i = 0; i < sizes.size(); i++) {
+		mean_size += sizes[i] * weights[i];
+		total_weight += weights[i];
+	}
+	mean_size /= total_weight;
+	long num_IOs = !number_ios.empty() ? atol(number_ios.c_str()) : random ? INFINITE : (long)ceil((last_lba - first_lba + 1) / mean_size);
+	double rate = atof(get_option(options, "rate_iops", "0").c_str());
+	if (rate > 0) {
+		Open_Loop_Thread* thread = new Open_Loop_Thread(pattern, type, new Poisson_Arrivals(rate, seed * 7 + 3), num_IOs);
+		thread->set_io_sizes(io_sizes);
+		return thread;
+	}
+	Job_Thread* thread = new Job_Thread(pattern, type, io_sizes, atoi(get_option(options, "iodepth", "1").c_str()), num_IOs);
+	thread->set_think_time(atof(get_option(options, "thinktime", "0").c_str()));
+	return thread;
+}
+
 //*****************************************************************************************
 //				Classical INIT workload
 //*****************************************************************************************
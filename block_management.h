@@ -28,6 +28,7 @@ public:
 	void register_event_completion(Event* event);
 	void register_ECC_check_on(uint logical_address);
 	uint how_many_gc_operations_are_scheduled() const;
+	uint how_many_gc_operations_are_scheduled_on(Address const& lun) const;
 	void set_block_manager(Block_manager_parent* b) { bm = b; }
 	Garbage_Collector* get_garbage_collector() { return gc; }
     friend class boost::serialization::access;
@@ -59,7 +60,7 @@ private:
 	vector<queue<Event*> > erase_queue;
 	vector<int> num_erases_scheduled_per_package;
 	unordered_map<long, vector<deque<Event*> > > dependent_gc;
-	unordered_map<Block*, double> gc_time_stat;
+	unordered_map<long, double> gc_time_stat;  // physical address of the victim block to when its GC started
 };
 
 class Block_manager_parent {
@@ -98,11 +99,10 @@ public:
 		num_available_pages_for_new_writes -= num;
 		//printf("%d   %d\n", num_available_pages_for_new_writes, num_free_pages);
 	}
-	vector<Block*> const& get_all_blocks() const { return all_blocks; }
 	uint sort_into_age_class(Address const& address) const;
 	void copy_state(Block_manager_parent* bm);
-	virtual bool bm(Block* block, double current_time) { return true; }
-	virtual bool may_garbage_collect_this_block(Block* block, double current_time) { return true;}
+	virtual bool bm(Block const& block, double current_time) { return true; }
+	virtual bool may_garbage_collect_this_block(Block const& block, double current_time) { return true;}
 	static Block_manager_parent* get_new_instance();
     friend class boost::serialization::access;
     template<class Archive>
@@ -114,11 +114,11 @@ public:
     	ar & free_block_pointers;
 
     	ar & free_blocks;
-    	ar & all_blocks;
     	ar & num_age_classes;
     	ar & num_free_pages;
     	ar & num_available_pages_for_new_writes;
     	ar & free_block_pointers;
+    	ar & multi_plane_stripes;
 
     	ar & wl;
     	ar & gc;
@@ -138,6 +138,8 @@ protected:
 	virtual Address choose_best_address(Event& write) = 0;
 	virtual Address choose_any_address(Event const& write) = 0;
 	void increment_pointer(Address& pointer);
+	void advance_write_pointer(Address& pointer);
+	void set_block_pointer(uint package_id, uint die_id, Address const& block, double time);
 	bool can_schedule_write_immediately(Address const& prospective_dest, double current_time);
 	bool can_write(Event const& write) const;
 	Address get_free_block_pointer_with_shortest_IO_queue();
@@ -148,6 +150,7 @@ protected:
 	FtlParent* ftl;
 	IOScheduler *scheduler;
 	vector<vector<Address> > free_block_pointers;
+	vector<vector<vector<Address> > > multi_plane_stripes; // package -> die -> one block per plane that the die's pointer fills in lockstep
 	Migrator* migrator;
 	vector<vector<vector<deque<Address> > > > free_blocks;  // package -> die -> class -> list of such free blocks
 
@@ -156,6 +159,8 @@ protected:
 	int get_num_available_pages_for_new_writes() const { return num_available_pages_for_new_writes; }
 private:
 	Address find_free_unused_block(uint package_id, uint die_id, uint age_class, double time);
+	Address find_free_unused_block_in_plane(uint package_id, uint die_id, uint plane_id, double time);
+	Address open_multi_plane_stripe(uint package_id, uint die_id, Address const& block, double time);
 	void issue_erase(Address a, double time);
 
 
@@ -164,8 +169,6 @@ private:
 	void register_ECC_check_on(uint logical_address);
 	bool schedule_queued_erase(Address location);
 
-	vector<Block*> all_blocks;
-
 	// The num_age_classes variable controls into how many age classes we divide blocks.
 	// In every LUN, the block manager tries to keep num_age_classes free blocks.
 	// This allows doing efficient dynamic wear-leveling by putting pages of a certain temperature in blocks of a certain age.
@@ -193,14 +196,13 @@ public:
 	Wear_Leveling_Strategy(Ssd* ssd, Migrator*);
 	~Wear_Leveling_Strategy() {};
 	void register_erase_completion(Event const& event);
-	bool schedule_wear_leveling_op(Block* block);
+	bool schedule_wear_leveling_op(Block const& block);
 	double get_normalised_age(uint age) const;
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
     {
     	ar & age_distribution;
-    	ar & all_blocks;
     	ar & num_erases_up_to_date;
     	ar & ssd;
     	ar & average_erase_cycle_time;
@@ -216,14 +218,13 @@ private:
 	double get_min_age() const;
 	//void update_blocks_with_min_age(uint min_age);
 	void find_wl_candidates(double current_time);
-	//set<Block*> blocks_with_min_age;
+	//set<Block> blocks_with_min_age;
 	map<int, int> age_distribution;  // maps block ages to the number of blocks with this age
-	vector<Block*> all_blocks;
 	int num_erases_up_to_date;
 	Ssd* ssd;
 	double average_erase_cycle_time;
-	set<Block*> blocks_being_wl;
-	set<Block*> blocks_to_wl;
+	set<Block> blocks_being_wl;
+	set<Block> blocks_to_wl;
 	Migrator* migrator;
 	int max_age;
 	MTRand_int32 random_number_generator;
@@ -268,7 +269,7 @@ public:
 	void register_write_outcome(Event const& event, enum status status);
 	void check_if_should_trigger_more_GC(Event const& event);
 	void register_erase_outcome(Event& event, enum status status);
-	bool may_garbage_collect_this_block(Block* block, double current_time);
+	bool may_garbage_collect_this_block(Block const& block, double current_time);
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
@@ -278,7 +279,7 @@ public:
 protected:
 	Address choose_best_address(Event& write);
 	Address choose_any_address(Event const& write);
-	map<Block*, Address> pointers_for_ongoing_gc_operations;
+	map<Block, Address> pointers_for_ongoing_gc_operations;
 	vector<vector<queue<Address> > > partially_used_blocks;
 private:
 	int get_num_partially_empty_blocks() const;
@@ -481,7 +482,7 @@ public:
 	Garbage_Collector(Ssd* ssd, Block_manager_parent* bm) : ssd(ssd), bm(bm), num_age_classes(bm->get_num_age_classes()) {}
 	virtual ~Garbage_Collector() {}
 	virtual void register_event_completion(Event const& event) {};
-	virtual Block* choose_gc_victim(int package_id, int die_id, int klass) const = 0;
+	virtual Block choose_gc_victim(int package_id, int die_id, int klass) const = 0;
 	virtual void commit_choice_of_victim(Address const& phys_address, double time) = 0;
 	void set_block_manager(Block_manager_parent* b) { bm = b; }
 	virtual void set_scheduler(IOScheduler*) {}
@@ -515,7 +516,7 @@ public:
 	virtual void register_event_completion(Event const& event);
 
 	// Called by the block manager to ask the garbage-collector for a good block to garbage-collect in a given package, die, and with a certain age.
-	Block* choose_gc_victim(int package_id, int die_id, int klass) const;
+	Block choose_gc_victim(int package_id, int die_id, int klass) const;
 	// Called by the block manager when a GC operation for a certain block has been issued. This block is removed from the gc_candidates structure.
 	void commit_choice_of_victim(Address const& phys_address, double time);
 	friend class boost::serialization::access;
@@ -534,7 +535,7 @@ class Garbage_Collector_LRU : public Garbage_Collector {
 public:
 	Garbage_Collector_LRU();
 	Garbage_Collector_LRU(Ssd* ssd, Block_manager_parent* bm);
-	Block* choose_gc_victim(int package_id, int die_id, int klass) const;
+	Block choose_gc_victim(int package_id, int die_id, int klass) const;
 	void commit_choice_of_victim(Address const& phys_address, double time);
 	friend class boost::serialization::access;
     template<class Archive>
@@ -552,7 +553,7 @@ public:
 	Garbage_Collector_LRU2();
 	Garbage_Collector_LRU2(Ssd* ssd, Block_manager_parent* bm);
 	virtual void register_event_completion(Event const& event);
-	Block* choose_gc_victim(int package_id, int die_id, int klass) const;
+	Block choose_gc_victim(int package_id, int die_id, int klass) const;
 	void commit_choice_of_victim(Address const& phys_address, double time);
 	friend class boost::serialization::access;
     template<class Archive>
@@ -627,10 +628,10 @@ public:
 	double get_write_amp(write_amp_choice choice) const;
 	void register_write_outcome(Event const& event);
 	void register_erase_outcome(Event& event);
-	Block* get_gc_victim_LRU(int package, int die) const;
-	Block* get_gc_victim_window_greedy(int package, int die) const;
+	Block get_gc_victim_LRU(int package, int die) const;
+	Block get_gc_victim_window_greedy(int package, int die) const;
 	inline double get_normalized_hits_per_page() const { return (prob / num_pages) * OVER_PROVISIONING_FACTOR * NUMBER_OF_ADDRESSABLE_PAGES(); }
-	Block* get_gc_victim_greedy(int package, int die) const;
+	Block get_gc_victim_greedy(int package, int die) const;
 	bool is_starved() const;
 	void accept_block(Address block_addr);
 	bool needs_more_blocks() const;
@@ -655,9 +656,9 @@ public:
 
 	double prob, size, offset, OP, OP_greedy, OP_prob, OP_average, actual_prob;
 	pointers free_blocks, next_free_blocks;
-	set<Block*> block_ids, blocks_being_garbage_collected;
+	set<Block> block_ids, blocks_being_garbage_collected;
 	vector<vector<int> > num_pages_per_die, num_blocks_per_die, num_blocks_ever_given;
-	vector<vector<vector<Block*> > > blocks_queue_per_die;
+	vector<vector<vector<Block> > > blocks_queue_per_die;
 	struct group_stats {
 		group_stats() : num_gc_in_group(0), num_writes_to_group(0), num_gc_writes_to_group(0),
 				num_requested_gc(0), num_requested_gc_to_balance(0), num_requested_gc_starved(0),
@@ -741,7 +742,7 @@ public:
 	void change_update_frequencies(Groups_Message const& message);
 	void check_if_should_trigger_more_GC(Event const&);
 	void try_to_allocate_block_to_group(int group_id, int package, int die, double time);
-	bool may_garbage_collect_this_block(Block* block, double current_time);
+	bool may_garbage_collect_this_block(Block const& block, double current_time);
 	void register_logical_address(Event const& event, int group_id);
     void print() const;
     void add_group(double starting_prob_val = 0);
@@ -50,9 +50,18 @@ uint SSD_SIZE = 4;
 uint PACKAGE_SIZE = 8;
 
 // Number of planes in a die
-// We currently do not support multiple planes per die
 uint DIE_SIZE = 1;
 
+// With several planes per die, reads, writes and erases of the same type that target different planes of a die at the same
+// page offset are executed as one multi-plane operation, taking a single array time. Write points are then striped over the planes.
+// Off by default, so that each plane of a die executes its operations on its own.
+bool ENABLE_MULTI_PLANE_OPERATIONS = false;
+
+// Each plane has a cache register next to its page register. A write can be sent to a die while the die programs the previous
+// write, and a read can be sensed while the page of the previous read waits in the cache register to be transferred.
+// Off by default, so that each die executes one operation at a time.
+bool ENABLE_CACHE_MODE = false;
+
 // Number of blocks in a plane
 uint PLANE_SIZE = 64;
 
@@ -75,9 +84,12 @@ double PAGE_WRITE_DELAY = 0.00001;
 uint PAGE_SIZE = 4096;
 
 // The IO scheduler used by the Operating System.
-// There are currently two schedulers available
+// There are currently four schedulers available
 // 0 corresponds to a FIFO scheduler, which is similar to the noop IO scheduler in Linux
 // 1 corresponds to a fair scheduler that scheduels IOs in a round robin manner from different threads. It is similar to the CFQ Linux scheduler
+// 2 corresponds to weighted fair queueing among tenants, with token bucket throttling of their IOPS and bandwidth
+// 3 corresponds to mClock, which gives tenants reservations, limits and weights, with token bucket throttling as well
+// Tenants and their QoS parameters are set with Thread::set_tenant.
 // You can create more schedulers by extending the OS_Scheduler class.
 int OS_SCHEDULER = 0;
 
@@ -180,6 +192,99 @@ uint MAX_ITEMS_IN_COPY_BACK_MAP = 1024;
 /* Defines the maximal length of the number of outstanding IOs that the OS can submit to the SSD  */
 int MAX_SSD_QUEUE_SIZE = 32;
 
+/* An IO that spans several pages is executed as single page IOs. The SSD issues at most this many pages of such IOs
+ * at a time, in the order the IOs arrived, and issues further pages as earlier ones finish. 0 means there is no such limit,
+ * and every page of an IO is issued at once. Two pages per plane is a window that keeps the dies busy. */
+uint MAX_LARGE_IO_PAGES_IN_FLIGHT = 0;
+
+/* The DRAM write-back buffer of the SSD controller, in pages. 0 means there is no buffer, and writes go straight to flash.
+ * Host writes complete once their page is in the buffer. The buffer starts writing dirty pages to flash once it is
+ * WRITE_BUFFER_HIGH_WATERMARK full, and keeps going until it is down to WRITE_BUFFER_LOW_WATERMARK. */
+uint WRITE_BUFFER_SIZE = 0;
+double WRITE_BUFFER_HIGH_WATERMARK = 0.75;
+double WRITE_BUFFER_LOW_WATERMARK = 0.5;
+
+/* The DRAM read cache of the SSD controller, in pages. 0 means there is no cache.
+ * READ_CACHE_POLICY: 0 -> LRU, 1 -> 2Q, 2 -> ARC
+ * READ_CACHE_READAHEAD is the number of pages read ahead when the host reads sequentially. 0 means no readahead. */
+uint READ_CACHE_SIZE = 0;
+int READ_CACHE_POLICY = 0;
+uint READ_CACHE_READAHEAD = 0;
+
+/* The host interface. With 0 queues, the OS submits through a single queue of MAX_SSD_QUEUE_SIZE outstanding IOs.
+ * Otherwise, the host has NVME_NUM_QUEUES submission/completion queue pairs, each with at most NVME_QUEUE_DEPTH outstanding IOs.
+ * Threads are bound to queues with Thread::set_host_queue, or spread over the queues round robin.
+ * The controller executes MAX_SSD_QUEUE_SIZE IOs at a time, and fetches IOs from the submission queues according to NVME_ARBITRATION:
+ * 0 -> round robin
+ * 1 -> weighted round robin with an urgent priority class. Urgent queues are served first, and then the high, medium and low
+ * 		priority classes according to their weights. */
+uint NVME_NUM_QUEUES = 0;
+uint NVME_QUEUE_DEPTH = 64;
+int NVME_ARBITRATION = 0;
+
+// The maximal number of IOs the controller fetches from a submission queue before moving on to the next queue
+uint NVME_ARBITRATION_BURST = 1;
+
+uint NVME_HIGH_PRIORITY_WEIGHT = 8;
+uint NVME_MEDIUM_PRIORITY_WEIGHT = 4;
+uint NVME_LOW_PRIORITY_WEIGHT = 1;
+
+/* Interrupt coalescing. A completion queue raises an interrupt once it holds NVME_COALESCING_THRESHOLD completions,
+ * or NVME_COALESCING_TIME microseconds after its oldest unreported completion. A threshold of 0 or 1 disables coalescing. */
+uint NVME_COALESCING_THRESHOLD = 0;
+double NVME_COALESCING_TIME = 100;
+
+/* The link between the host and the SSD. Writes occupy it on their way to the SSD, and reads on their way back.
+ * 0 -> no link model, the host link is infinitely fast
+ * 1 -> PCIe with HOST_LINK_PCIE_LANES lanes of generation HOST_LINK_PCIE_GENERATION (1 to 4)
+ * 2 -> SATA 3, 600 MB/s, which is always half duplex */
+int HOST_LINK_TYPE = 0;
+uint HOST_LINK_PCIE_GENERATION = 3;
+uint HOST_LINK_PCIE_LANES = 4;
+
+// The time in microseconds for which every command occupies the link on its way to the SSD
+double HOST_LINK_COMMAND_OVERHEAD = 1;
+
+// If false, transfers to the SSD and to the host share the link
+bool HOST_LINK_FULL_DUPLEX = true;
+
+/* The storage exposed to the Operating System. RAID_LEVEL -1 means a single SSD.
+ * Otherwise, a RAID array of RAID_NUM_DEVICES SSDs is created, each with the architecture defined in this file.
+ * 0 -> RAID-0, striping
+ * 1 -> RAID-1, mirroring across all devices
+ * 5 -> RAID-5, striping with rotating parity. Requires at least 3 devices.
+ * 10 -> RAID-10, striping across mirrored pairs. Requires an even number of devices. */
+int RAID_LEVEL = -1;
+uint RAID_NUM_DEVICES = 4;
+
+// The number of consecutive logical pages placed on one device before moving to the next device in the stripe
+uint RAID_CHUNK_SIZE = 1;
+
+// If true, reads targeting a LUN that is being garbage-collected are served from a mirror or reconstructed from parity
+bool RAID_GC_AWARE_READS = false;
+
+/* If true, and RAID_LEVEL is -1, the storage is a small cache SSD in front of a capacity SSD.
+ * The capacity SSD has the architecture defined in this file. The architecture of the cache SSD is given to Tiered_Ssd::set_cache_tier_config. */
+bool ENABLE_TIERED_STORAGE = false;
+
+/* Which pages are placed in the cache tier
+ * 0 -> write-allocate: every written page is cached. Read misses are served from the capacity tier without caching the page.
+ * 1 -> frequency: a page is cached on a write or a read miss once it was accessed TIER_ADMISSION_THRESHOLD times */
+int TIER_ADMISSION_POLICY = 0;
+uint TIER_ADMISSION_THRESHOLD = 2;
+
+/* Which clean page is evicted from the cache tier to make room for a new page
+ * 0 -> LRU
+ * 1 -> ARC */
+int TIER_EVICTION_POLICY = 0;
+
+// Dirty pages are destaged to the capacity tier once they fill the high watermark fraction of the cache tier, until they are below the low watermark
+double TIER_DESTAGE_HIGH_WATERMARK = 0.5;
+double TIER_DESTAGE_LOW_WATERMARK = 0.3;
+
+// The maximal number of pages being destaged at the same time
+uint TIER_MAX_ONGOING_DESTAGES = 8;
+
 // These are internal deadlines for scheduling IOs inside the SSD. They are in microseconds.
 int WRITE_DEADLINE = 10000000;
 int READ_DEADLINE =  10000000;
@@ -200,6 +305,10 @@ void load_entry(char *name, double value, uint line_number) {
 		PACKAGE_SIZE = (uint) value;
 	else if (!strcmp(name, "DIE_SIZE"))
 		DIE_SIZE = (uint) value;
+	else if (!strcmp(name, "ENABLE_MULTI_PLANE_OPERATIONS"))
+		ENABLE_MULTI_PLANE_OPERATIONS = value;
+	else if (!strcmp(name, "ENABLE_CACHE_MODE"))
+		ENABLE_CACHE_MODE = value;
 	else if (!strcmp(name, "PLANE_SIZE"))
 		PLANE_SIZE = (uint) value;
 	else if (!strcmp(name, "BLOCK_SIZE"))
@@ -220,6 +329,52 @@ void load_entry(char *name, double value, uint line_number) {
 		MAX_ITEMS_IN_COPY_BACK_MAP = value;
 	else if (!strcmp(name, "MAX_SSD_QUEUE_SIZE"))
 		MAX_SSD_QUEUE_SIZE = value;
+	else if (!strcmp(name, "MAX_LARGE_IO_PAGES_IN_FLIGHT"))
+		MAX_LARGE_IO_PAGES_IN_FLIGHT = value;
+	else if (!strcmp(name, "WRITE_BUFFER_SIZE"))
+		WRITE_BUFFER_SIZE = value;
+	else if (!strcmp(name, "WRITE_BUFFER_HIGH_WATERMARK"))
+		WRITE_BUFFER_HIGH_WATERMARK = value;
+	else if (!strcmp(name, "WRITE_BUFFER_LOW_WATERMARK"))
+		WRITE_BUFFER_LOW_WATERMARK = value;
+	else if (!strcmp(name, "READ_CACHE_SIZE"))
+		READ_CACHE_SIZE = value;
+	else if (!strcmp(name, "READ_CACHE_POLICY"))
+		READ_CACHE_POLICY = value;
+	else if (!strcmp(name, "READ_CACHE_READAHEAD"))
+		READ_CACHE_READAHEAD = value;
+	else if (!strcmp(name, "RAM_READ_DELAY"))
+		RAM_READ_DELAY = value;
+	else if (!strcmp(name, "RAM_WRITE_DELAY"))
+		RAM_WRITE_DELAY = value;
+	else if (!strcmp(name, "NVME_NUM_QUEUES"))
+		NVME_NUM_QUEUES = value;
+	else if (!strcmp(name, "NVME_QUEUE_DEPTH"))
+		NVME_QUEUE_DEPTH = value;
+	else if (!strcmp(name, "NVME_ARBITRATION"))
+		NVME_ARBITRATION = value;
+	else if (!strcmp(name, "NVME_ARBITRATION_BURST"))
+		NVME_ARBITRATION_BURST = value;
+	else if (!strcmp(name, "NVME_HIGH_PRIORITY_WEIGHT"))
+		NVME_HIGH_PRIORITY_WEIGHT = value;
+	else if (!strcmp(name, "NVME_MEDIUM_PRIORITY_WEIGHT"))
+		NVME_MEDIUM_PRIORITY_WEIGHT = value;
+	else if (!strcmp(name, "NVME_LOW_PRIORITY_WEIGHT"))
+		NVME_LOW_PRIORITY_WEIGHT = value;
+	else if (!strcmp(name, "NVME_COALESCING_THRESHOLD"))
+		NVME_COALESCING_THRESHOLD = value;
+	else if (!strcmp(name, "NVME_COALESCING_TIME"))
+		NVME_COALESCING_TIME = value;
+	else if (!strcmp(name, "HOST_LINK_TYPE"))
+		HOST_LINK_TYPE = value;
+	else if (!strcmp(name, "HOST_LINK_PCIE_GENERATION"))
+		HOST_LINK_PCIE_GENERATION = value;
+	else if (!strcmp(name, "HOST_LINK_PCIE_LANES"))
+		HOST_LINK_PCIE_LANES = value;
+	else if (!strcmp(name, "HOST_LINK_COMMAND_OVERHEAD"))
+		HOST_LINK_COMMAND_OVERHEAD = value;
+	else if (!strcmp(name, "HOST_LINK_FULL_DUPLEX"))
+		HOST_LINK_FULL_DUPLEX = value;
 	else if (!strcmp(name, "OVER_PROVISIONING_FACTOR"))
 		OVER_PROVISIONING_FACTOR = value;
 	else if (!strcmp(name, "BLOCK_MANAGER_ID"))
@@ -244,6 +399,28 @@ void load_entry(char *name, double value, uint line_number) {
 		ENABLE_WEAR_LEVELING = value;
 	else if (!strcmp(name, "ENABLE_TAGGING"))
 		ENABLE_TAGGING = value;
+	else if (!strcmp(name, "RAID_LEVEL"))
+		RAID_LEVEL = value;
+	else if (!strcmp(name, "RAID_NUM_DEVICES"))
+		RAID_NUM_DEVICES = value;
+	else if (!strcmp(name, "RAID_CHUNK_SIZE"))
+		RAID_CHUNK_SIZE = value;
+	else if (!strcmp(name, "RAID_GC_AWARE_READS"))
+		RAID_GC_AWARE_READS = value;
+	else if (!strcmp(name, "ENABLE_TIERED_STORAGE"))
+		ENABLE_TIERED_STORAGE = value;
+	else if (!strcmp(name, "TIER_ADMISSION_POLICY"))
+		TIER_ADMISSION_POLICY = value;
+	else if (!strcmp(name, "TIER_ADMISSION_THRESHOLD"))
+		TIER_ADMISSION_THRESHOLD = value;
+	else if (!strcmp(name, "TIER_EVICTION_POLICY"))
+		TIER_EVICTION_POLICY = value;
+	else if (!strcmp(name, "TIER_DESTAGE_HIGH_WATERMARK"))
+		TIER_DESTAGE_HIGH_WATERMARK = value;
+	else if (!strcmp(name, "TIER_DESTAGE_LOW_WATERMARK"))
+		TIER_DESTAGE_LOW_WATERMARK = value;
+	else if (!strcmp(name, "TIER_MAX_ONGOING_DESTAGES"))
+		TIER_MAX_ONGOING_DESTAGES = value;
 	else
 		fprintf(stderr, "Config file parsing error on line %u:  %s   %f\n", line_number, name, value);
 	return;
@@ -363,11 +540,20 @@ void print_config(FILE *stream) {
 	fprintf(stream, "\tSSD_SIZE:\t%u\n", SSD_SIZE);
 	fprintf(stream, "\tPACKAGE_SIZE:\t%u\n", PACKAGE_SIZE);
 	fprintf(stream, "\tDIE_SIZE:\t%u\n", DIE_SIZE);
+	fprintf(stream, "\tENABLE_MULTI_PLANE_OPERATIONS:\t%d\n", ENABLE_MULTI_PLANE_OPERATIONS);
+	fprintf(stream, "\tENABLE_CACHE_MODE:\t%d\n", ENABLE_CACHE_MODE);
 	fprintf(stream, "\tPLANE_SIZE:\t%u\n", PLANE_SIZE);
 	fprintf(stream, "\tBLOCK_SIZE:\t%u\n", BLOCK_SIZE);
 	fprintf(stream, "\tPAGE_SIZE:\t%u\n\n", PAGE_SIZE);
 
 	fprintf(stream, "\tMAX_SSD_QUEUE_SIZE:\t%u\n", MAX_SSD_QUEUE_SIZE);
+	fprintf(stream, "\tMAX_LARGE_IO_PAGES_IN_FLIGHT:\t%u\n", MAX_LARGE_IO_PAGES_IN_FLIGHT);
+	fprintf(stream, "\tWRITE_BUFFER_SIZE:\t%u\n", WRITE_BUFFER_SIZE);
+	fprintf(stream, "\tWRITE_BUFFER_HIGH_WATERMARK:\t%f\n", WRITE_BUFFER_HIGH_WATERMARK);
+	fprintf(stream, "\tWRITE_BUFFER_LOW_WATERMARK:\t%f\n", WRITE_BUFFER_LOW_WATERMARK);
+	fprintf(stream, "\tREAD_CACHE_SIZE:\t%u\n", READ_CACHE_SIZE);
+	fprintf(stream, "\tREAD_CACHE_POLICY:\t%d\n", READ_CACHE_POLICY);
+	fprintf(stream, "\tREAD_CACHE_READAHEAD:\t%u\n", READ_CACHE_READAHEAD);
 	fprintf(stream, "\tOVER_PROVISIONING_FACTOR:\t%f\n", OVER_PROVISIONING_FACTOR);
 
 	fprintf(stream, "#Controller:\n");
@@ -383,9 +569,42 @@ void print_config(FILE *stream) {
 	fprintf(stream, "#Open Interface:\n");
 	fprintf(stream, "\tENABLE_TAGGING: %i\n\n", ENABLE_TAGGING);
 
+	fprintf(stream, "#RAID:\n");
+	fprintf(stream, "\tRAID_LEVEL: %i\n", RAID_LEVEL);
+	fprintf(stream, "\tRAID_NUM_DEVICES: %u\n", RAID_NUM_DEVICES);
+	fprintf(stream, "\tRAID_CHUNK_SIZE: %u\n", RAID_CHUNK_SIZE);
+	fprintf(stream, "\tRAID_GC_AWARE_READS: %i\n\n", RAID_GC_AWARE_READS);
+
+	fprintf(stream, "#Tiered storage:\n");
+	fprintf(stream, "\tENABLE_TIERED_STORAGE: %i\n", ENABLE_TIERED_STORAGE);
+	fprintf(stream, "\tTIER_ADMISSION_POLICY: %i\n", TIER_ADMISSION_POLICY);
+	fprintf(stream, "\tTIER_ADMISSION_THRESHOLD: %u\n", TIER_ADMISSION_THRESHOLD);
+	fprintf(stream, "\tTIER_EVICTION_POLICY: %i\n", TIER_EVICTION_POLICY);
+	fprintf(stream, "\tTIER_DESTAGE_HIGH_WATERMARK: %f\n", TIER_DESTAGE_HIGH_WATERMARK);
+	fprintf(stream, "\tTIER_DESTAGE_LOW_WATERMARK: %f\n", TIER_DESTAGE_LOW_WATERMARK);
+	fprintf(stream, "\tTIER_MAX_ONGOING_DESTAGES: %u\n\n", TIER_MAX_ONGOING_DESTAGES);
+
 	fprintf(stream, "#Operating System:\n");
 	fprintf(stream, "\tOS_SCHEDULER: %i\n\n", OS_SCHEDULER);
 
+	fprintf(stream, "#Host interface:\n");
+	fprintf(stream, "\tNVME_NUM_QUEUES: %i\n", NVME_NUM_QUEUES);
+	fprintf(stream, "\tNVME_QUEUE_DEPTH: %i\n", NVME_QUEUE_DEPTH);
+	fprintf(stream, "\tNVME_ARBITRATION: %i\n", NVME_ARBITRATION);
+	fprintf(stream, "\tNVME_ARBITRATION_BURST: %i\n", NVME_ARBITRATION_BURST);
+	fprintf(stream, "\tNVME_HIGH_PRIORITY_WEIGHT: %i\n", NVME_HIGH_PRIORITY_WEIGHT);
+	fprintf(stream, "\tNVME_MEDIUM_PRIORITY_WEIGHT: %i\n", NVME_MEDIUM_PRIORITY_WEIGHT);
+	fprintf(stream, "\tNVME_LOW_PRIORITY_WEIGHT: %i\n", NVME_LOW_PRIORITY_WEIGHT);
+	fprintf(stream, "\tNVME_COALESCING_THRESHOLD: %i\n", NVME_COALESCING_THRESHOLD);
+	fprintf(stream, "\tNVME_COALESCING_TIME: %f\n\n", NVME_COALESCING_TIME);
+
+	fprintf(stream, "#Host link:\n");
+	fprintf(stream, "\tHOST_LINK_TYPE: %i\n", HOST_LINK_TYPE);
+	fprintf(stream, "\tHOST_LINK_PCIE_GENERATION: %i\n", HOST_LINK_PCIE_GENERATION);
+	fprintf(stream, "\tHOST_LINK_PCIE_LANES: %i\n", HOST_LINK_PCIE_LANES);
+	fprintf(stream, "\tHOST_LINK_COMMAND_OVERHEAD: %f\n", HOST_LINK_COMMAND_OVERHEAD);
+	fprintf(stream, "\tHOST_LINK_FULL_DUPLEX: %i\n\n", HOST_LINK_FULL_DUPLEX);
+
 	fprintf(stream, "#Scheduler:\n");
 	fprintf(stream, "\tALLOW_DEFERRING_TRANSFERS: %i\n", ALLOW_DEFERRING_TRANSFERS);
 	fprintf(stream, "\tSCHEDULING_SCHEME: %i\n\n", SCHEDULING_SCHEME);
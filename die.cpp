@@ -5,55 +5,159 @@
 
 using namespace ssd;
 
-Die::Die(long physical_address):
+Die::Die(Page_State_Arena* arena, long physical_address):
 	data(),
 	currently_executing_io_finish_time(0.0),
-	last_read_io(UNDEFINED)
+	last_read_io(DIE_SIZE, UNDEFINED),
+	cached_read_io(DIE_SIZE, UNDEFINED),
+	cache_register_release_time(0.0),
+	multi_plane_op_type(NOT_VALID),
+	multi_plane_op_page(0),
+	planes_in_multi_plane_op(DIE_SIZE, false),
+	multi_plane_op_start_time(0.0),
+	multi_plane_op_last_start_time(0.0)
 {
+	data.reserve(DIE_SIZE);
 	for(uint i = 0; i < DIE_SIZE; i++) {
-		int a = physical_address + (PLANE_SIZE * BLOCK_SIZE * i);
-		Plane p = Plane(a);
-		data.push_back(p);
+		long a = physical_address + ((long)PLANE_SIZE * BLOCK_SIZE * i);
+		data.push_back(Plane(arena, a));
 	}
 }
 
 Die::Die() :
 	data(),
 	currently_executing_io_finish_time(0.0),
-	last_read_io(UNDEFINED) {}
+	last_read_io(DIE_SIZE, UNDEFINED),
+	cached_read_io(DIE_SIZE, UNDEFINED),
+	cache_register_release_time(0.0),
+	multi_plane_op_type(NOT_VALID),
+	multi_plane_op_page(0),
+	planes_in_multi_plane_op(DIE_SIZE, false),
+	multi_plane_op_start_time(0.0),
+	multi_plane_op_last_start_time(0.0) {}
 
-enum status Die::read(Event &event)
-{
-	if (currently_executing_io_finish_time > event.get_current_time()) {
+// Whether the operation has the type, page offset and plane that allow it to join the array operation in progress
+bool Die::accepts_multi_plane_op(Address const& address, event_type type) const {
+	if (!ENABLE_MULTI_PLANE_OPERATIONS || DIE_SIZE == 1 || type != multi_plane_op_type) {
+		return false;
+	}
+	if (type != READ_COMMAND && type != WRITE && type != ERASE) {
+		return false;
+	}
+	if (address.valid < PLANE || planes_in_multi_plane_op[address.plane]) {
+		return false;
+	}
+	if (type == READ_COMMAND && register_is_busy(address.plane)) {
+		return false;
+	}
+	return type == ERASE || (address.valid == PAGE && address.page == multi_plane_op_page);
+}
+
+// A multi-plane operation is set up by sending the commands of all its planes back to back on the channel before the array starts.
+// An operation whose command can start on the channel by the time the last operation that joined reached the die is therefore
+// executed together with it.
+bool Die::can_join_multi_plane_op(Address const& address, event_type type, double bus_start_time) const {
+	return currently_executing_io_finish_time > bus_start_time && bus_start_time <= multi_plane_op_last_start_time
+			&& accepts_multi_plane_op(address, type);
+}
+
+// A cache program sends the next write to the cache register while the array programs the previous one.
+// Pages of reads are still waiting in the registers would be overwritten, so the die must be programming and hold no read data.
+bool Die::accepts_cache_op(event_type type) const {
+	return ENABLE_CACHE_MODE && type == WRITE && multi_plane_op_type == WRITE && !register_is_busy();
+}
+
+// The time from which the channel can start sending the operation to the die
+double Die::get_ready_time(Address const& address, event_type type, double bus_start_time) const {
+	if (can_join_multi_plane_op(address, type, bus_start_time)) {
+		return 0;
+	}
+	if (accepts_cache_op(type)) {
+		return cache_register_release_time;
+	}
+	// A page in the cache register can be transferred while the array is busy
+	if (ENABLE_CACHE_MODE && type == READ_TRANSFER) {
+		return 0;
+	}
+	return currently_executing_io_finish_time;
+}
+
+// An operation that reaches a busy die either joins its multi-plane operation, or waits in the cache register
+// until the array is done. The die is then busy until the last plane finishes.
+bool Die::start_array_operation(Event& event) {
+	Address const& a = event.get_address();
+	event_type type = event.get_event_type();
+	double time = event.get_current_time();
+	double bus_start_time = time - Package::get_channel_time(type);
+	bool busy = currently_executing_io_finish_time > time;
+	if (busy && can_join_multi_plane_op(a, type, bus_start_time - 0.000001)) {
+		if (multi_plane_op_start_time > time) {
+			event.incr_execution_time(multi_plane_op_start_time - time);
+		}
+		planes_in_multi_plane_op[a.plane] = true;
+		multi_plane_op_last_start_time = event.get_current_time();
+		return true;
+	}
+	if (busy && (!accepts_cache_op(type) || bus_start_time < cache_register_release_time - 0.000001)) {
 		VisualTracer::print_horizontally(500);
 		event.print();
-		printf("currently_executing_io_finish_time: %f     %f\n", currently_executing_io_finish_time, event.get_current_time());
+		printf("currently_executing_io_finish_time: %f     %f\n", currently_executing_io_finish_time, time);
+		assert(false);
+	}
+	if (busy) {
+		event.incr_execution_time(currently_executing_io_finish_time - time);
+		cache_register_release_time = currently_executing_io_finish_time;
+	}
+	multi_plane_op_type = type;
+	multi_plane_op_page = a.page;
+	planes_in_multi_plane_op.assign(DIE_SIZE, false);
+	if (a.valid >= PLANE) {
+		planes_in_multi_plane_op[a.plane] = true;
+	}
+	multi_plane_op_start_time = event.get_current_time();
+	multi_plane_op_last_start_time = event.get_current_time();
+	return busy;
+}
+
+void Die::register_array_operation(Event const& event, bool die_was_busy) {
+	double finish_time = event.get_current_time();
+	if (die_was_busy) {
+		Utilization_Meter::register_event(finish_time, fmax(0.0, finish_time - currently_executing_io_finish_time), event, DIE);
+	} else {
+		Utilization_Meter::register_event(currently_executing_io_finish_time, event.get_execution_time(), event, DIE);
 	}
-	assert(currently_executing_io_finish_time <= event.get_current_time());
+	currently_executing_io_finish_time = fmax(currently_executing_io_finish_time, finish_time);
+}
+
+enum status Die::read(Event &event)
+{
+	bool die_was_busy = start_array_operation(event);
 	if (event.get_event_type() == READ_COMMAND) {
-		last_read_io = event.get_application_io_id();
+		int plane = event.get_address().plane;
+		if (last_read_io[plane] == UNDEFINED) {
+			last_read_io[plane] = event.get_application_io_id();
+		} else {
+			cached_read_io[plane] = event.get_application_io_id();
+		}
 	}
 	enum status result = data[event.get_address().plane].read(event);
-	Utilization_Meter::register_event(currently_executing_io_finish_time, event.get_execution_time(), event, DIE);
-	currently_executing_io_finish_time = event.get_current_time();
+	register_array_operation(event, die_was_busy);
 	return result;
 }
 
 enum status Die::write(Event &event)
 {
-	assert(currently_executing_io_finish_time <= event.get_current_time());
+	bool die_was_busy = start_array_operation(event);
 	enum status result = data[event.get_address().plane].write(event);
-	Utilization_Meter::register_event(currently_executing_io_finish_time, event.get_execution_time(), event, DIE);
-	currently_executing_io_finish_time = event.get_current_time();
+	register_array_operation(event, die_was_busy);
 	return result;
 }
 
 enum status Die::erase(Event &event)
 {
-	assert(currently_executing_io_finish_time <= event.get_current_time());
+	bool die_was_busy = start_array_operation(event);
 	enum status status = data[event.get_address().plane].erase(event);
-	Utilization_Meter::register_event(currently_executing_io_finish_time, event.get_execution_time(), event, DIE);
-	currently_executing_io_finish_time = event.get_current_time();
+	register_array_operation(event, die_was_busy);
 	return status;
 }
 
@@ -61,14 +165,30 @@ double Die::get_currently_executing_io_finish_time() {
 	return currently_executing_io_finish_time;
 }
 
-int Die::get_last_read_application_io() {
-	return last_read_io;
+bool Die::register_holds(int plane, int application_io) const {
+	return last_read_io[plane] == application_io || cached_read_io[plane] == application_io;
 }
 
-bool Die::register_is_busy() {
-	return last_read_io != -1;
+// Whether the page of a read is waiting in any of the registers of the die
+bool Die::register_is_busy() const {
+	for (uint i = 0; i < DIE_SIZE; i++) {
+		if (last_read_io[i] != UNDEFINED || cached_read_io[i] != UNDEFINED) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Whether the plane has no room for the page of another read
+bool Die::register_is_busy(int plane) const {
+	return last_read_io[plane] != UNDEFINED && (!ENABLE_CACHE_MODE || cached_read_io[plane] != UNDEFINED);
 }
 
-void Die::clear_register() {
-	last_read_io = -1;
+void Die::clear_register(int plane, int application_io) {
+	if (last_read_io[plane] == application_io) {
+		last_read_io[plane] = cached_read_io[plane];
+		cached_read_io[plane] = UNDEFINED;
+	} else if (cached_read_io[plane] == application_io) {
+		cached_read_io[plane] = UNDEFINED;
+	}
 }
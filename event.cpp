@@ -31,9 +31,12 @@ Event::Event(enum event_type type, ulong logical_address, uint size, double star
 	tag(-1),
 	accumulated_wait_time(0),
 	thread_id(UNDEFINED),
+	os_slot(UNDEFINED),
 	pure_ssd_wait_time(0),
 	copyback(false),
 	cached_write(false),
+	buffer_flush(false),
+	served_from_ram(false),
 	num_iterations_in_scheduler(0),
 	ssd_id(UNDEFINED)
 {
@@ -43,10 +46,6 @@ Event::Event(enum event_type type, ulong logical_address, uint size, double star
 		i++;
 	}
 	assert(start_time >= 0.0);
-	if (logical_address > NUMBER_OF_ADDRESSABLE_BLOCKS() * BLOCK_SIZE) {
-		printf("invalid logical address, too big  %d   %d\n", logical_address, NUMBER_OF_ADDRESSABLE_BLOCKS() * BLOCK_SIZE);
-		assert(false);
-	}
 }
 
 Event::Event(Event const& event) :
@@ -70,9 +69,12 @@ Event::Event(Event const& event) :
 	tag(event.tag),
 	accumulated_wait_time(0),
 	thread_id(event.thread_id),
+	os_slot(event.os_slot),
 	pure_ssd_wait_time(event.pure_ssd_wait_time),
 	copyback(event.copyback),
 	cached_write(event.cached_write),
+	buffer_flush(event.buffer_flush),
+	served_from_ram(event.served_from_ram),
 	num_iterations_in_scheduler(0),
 	ssd_id(event.ssd_id)
 {}
@@ -32,7 +32,9 @@ Experiment::Experiment()
 	  calibrate_for_each_point(false),
 	  results(),
 	  generate_trace_file(false),
-	  alternate_location_for_results_file("")
+	  alternate_location_for_results_file(""),
+	  knee_latency_factor(3),
+	  knee_min_throughput_gain(0.25)
 {}
 
 void Experiment::unify_under_one_statistics_gatherer(vector<Thread*> threads, StatisticsGatherer* statistics_gatherer) {
@@ -102,7 +104,7 @@ void Experiment::run_single_point(string name) {
 	OperatingSystem* os = calibration_file.empty() ? new OperatingSystem() : load_state(calibration_file);
 	//os->set_progress_meter_granularity(10);
 	if (workload != NULL) {
-		vector<Thread*> experiment_threads = workload->generate_instance();
+		vector<Thread*> experiment_threads = workload->generate_instance(os);
 		os->set_threads(experiment_threads);
 	}
 	os->set_num_writes_to_stop_after(io_limit);
@@ -110,6 +112,7 @@ void Experiment::run_single_point(string name) {
 
 	StatisticsGatherer::get_global_instance()->print();
 	StatisticsGatherer::get_global_instance()->print_mapping_info();
+	StatisticsGatherer::get_global_instance()->print_controller_ram_info();
 	StatisticsGatherer::get_global_instance()->print_gc_info();
 	Utilization_Meter::print();
 	//Individual_Threads_Statistics::print();
@@ -117,6 +120,8 @@ void Experiment::run_single_point(string name) {
 	//Queue_Length_Statistics::print_avg();
 	Free_Space_Meter::print();
 	Free_Space_Per_LUN_Meter::print();
+	os->get_device()->print_statistics();
+	os->print_statistics();
 
 	global_result.collect_stats("0", StatisticsGatherer::get_global_instance());
 	write_results_file(data_folder);
@@ -169,13 +174,15 @@ void Experiment::simple_experiment_double(string name, T* var, T min, T max, T i
 		}
 
 		if (workload != NULL) {
-			vector<Thread*> experiment_threads = workload->generate_instance();
+			vector<Thread*> experiment_threads = workload->generate_instance(os);
 			os->set_threads(experiment_threads);
 		}
 		StatisticsGatherer::set_record_statistics(true);
 		os->set_num_writes_to_stop_after(io_limit);
 		os->run();
 		StatisticsGatherer::get_global_instance()->print();
+		os->get_device()->print_statistics();
+		os->print_statistics();
 		//StatisticsGatherer::get_global_instance()->print_gc_info();
 		//Utilization_Meter::print();
 		//Queue_Length_Statistics::print_avg();
@@ -201,6 +208,143 @@ void Experiment::simple_experiment_double(string name, T* var, T min, T max, T i
 	results.push_back(result);
 }
 
+// Finds the knee of the throughput-latency curve in a handful of runs rather than a full sweep.
+// The load is doubled from its minimum until the SSD saturates, and the knee is then located by bisection
+// between the last load it sustained and the first one it did not, down to the increment given to set_variable.
+// All probes start from the same calibrated state, which is created only once.
+void Experiment::find_knee(string name) {
+	Thread::set_record_internal_statistics(true);
+	StatisticsGatherer::set_record_statistics(true);
+	if (d_variable != NULL) {
+		knee_search(name, d_variable, d_min, d_max, d_incr > 0 ? d_incr : d_min / 10);
+	}
+	else if (i_variable != NULL) {
+		knee_search(name, i_variable, i_min, i_max, max(i_incr, 1));
+	}
+	else {
+		fprintf(stderr, "The knee search needs a load parameter, such as the queue depth or an arrival rate. Use set_variable.\n");
+		throw;
+	}
+}
+
+template <class T>
+void Experiment::knee_search(string name, T* var, T min, T max, T resolution) {
+	if (min <= 0 || max < min) {
+		fprintf(stderr, "The knee search needs a positive load range, but %s ranges from %s to %s\n", variable_name.c_str(), to_string(min).c_str(), to_string(max).c_str());
+		throw;
+	}
+	string data_folder = base_folder + name + "/";
+	mkdir(data_folder.c_str(), 0755);
+	write_config_file(data_folder);
+
+	string calibration = calibration_file;
+	if (calibration_workload != NULL) {
+		calibration = "calib-" + name + ".txt";
+		calibrate_and_save(calibration_workload, calibration, NUMBER_OF_ADDRESSABLE_PAGES() * 8);
+	}
+
+	T& variable = *var;
+	vector<knee_probe> probes;
+	variable = min;
+	knee_probe unloaded = run_knee_probe(name, calibration, variable);
+	double latency_limit = knee_latency_factor * unloaded.p99_latency;
+	probes.push_back(unloaded);
+
+	// Ramp the load up until the SSD saturates
+	T good_load = min, bad_load = min;
+	knee_probe good = unloaded;
+	bool knee_found = false;
+	while (!knee_found && good_load < max) {
+		variable = std::min(max, std::max(good_load * 2, good_load + resolution));
+		knee_probe probe = run_knee_probe(name, calibration, variable);
+		probe.saturated = is_saturated(probe, good, latency_limit);
+		probes.push_back(probe);
+		if (probe.saturated) {
+			bad_load = variable;
+			knee_found = true;
+		} else {
+			good_load = variable;
+			good = probe;
+		}
+	}
+
+	// Narrow the knee down to between the last sustained load and the first saturated one
+	while (knee_found && bad_load - good_load > resolution) {
+		variable = good_load + (bad_load - good_load) / 2;
+		if (variable == good_load) {
+			break;
+		}
+		knee_probe probe = run_knee_probe(name, calibration, variable);
+		probe.saturated = is_saturated(probe, good, latency_limit);
+		probes.push_back(probe);
+		if (probe.saturated) {
+			bad_load = variable;
+		} else {
+			good_load = variable;
+			good = probe;
+		}
+	}
+	variable = good_load;
+	write_knee_results(data_folder, probes, good, knee_found);
+}
+
+Experiment::knee_probe Experiment::run_knee_probe(string name, string calibration, double load) {
+	printf("----------------------------------------------------------------------------------------------------------\n");
+	printf("%s :  %s = %f\n", name.c_str(), variable_name.c_str(), load);
+	printf("----------------------------------------------------------------------------------------------------------\n");
+	VisualTracer::init();
+	Queue_Length_Statistics::init();
+	Free_Space_Meter::init();
+	Free_Space_Per_LUN_Meter::init();
+	StatisticsGatherer::init();
+
+	OperatingSystem* os = calibration.empty() ? new OperatingSystem() : load_state(calibration);
+	if (workload != NULL) {
+		vector<Thread*> experiment_threads = workload->generate_instance(os);
+		os->set_threads(experiment_threads);
+	}
+	StatisticsGatherer::set_record_statistics(true);
+	Thread::set_record_internal_statistics(true);
+	os->set_num_writes_to_stop_after(io_limit);
+	os->run();
+
+	StatisticsGatherer* stats = StatisticsGatherer::get_global_instance();
+	knee_probe probe;
+	probe.load = load;
+	probe.throughput = stats->get_host_iops();
+	probe.avg_latency = stats->get_host_avg_latency();
+	probe.p99_latency = stats->get_host_latency_percentile(0.99);
+	probe.saturated = false;
+	printf("throughput: %f IOPS\tavg latency: %f\tp99 latency: %f\n", probe.throughput, probe.avg_latency, probe.p99_latency);
+	delete os;
+	return probe;
+}
+
+// A load saturates the SSD if its tail latency blows up, or if the extra load barely buys any extra throughput
+bool Experiment::is_saturated(knee_probe const& probe, knee_probe const& below, double latency_limit) const {
+	if (probe.p99_latency > latency_limit) {
+		return true;
+	}
+	double load_increase = (probe.load - below.load) / below.load;
+	double throughput_increase = below.throughput <= 0 ? 1 : (probe.throughput - below.throughput) / below.throughput;
+	return throughput_increase < knee_min_throughput_gain * load_increase;
+}
+
+void Experiment::write_knee_results(string data_folder, vector<knee_probe> probes, knee_probe const& knee, bool knee_found) const {
+	sort(probes.begin(), probes.end());
+	string file_name = data_folder + "knee.csv";
+	FILE* file = fopen(file_name.c_str(), "w");
+	fprintf(file, "\"%s\", \"Throughput (IOPS)\", \"Average latency (us)\", \"p99 latency (us)\", \"Saturated\"\n", variable_name.c_str());
+	printf("\n%s\tthroughput\tavg latency\tp99 latency\n", variable_name.c_str());
+	for (auto const& p : probes) {
+		fprintf(file, "%f, %f, %f, %f, %d\n", p.load, p.throughput, p.avg_latency, p.p99_latency, p.saturated);
+		printf("%f\t%f\t%f\t%f%s\n", p.load, p.throughput, p.avg_latency, p.p99_latency, p.saturated ? "\tsaturated" : "");
+	}
+	fclose(file);
+	printf("\n%s at %s = %f: %f IOPS with p99 latency %f\n", knee_found ? "Knee" : "No knee within the load range, highest load", variable_name.c_str(), knee.load, knee.throughput, knee.p99_latency);
+	printf("%d runs, curve written in:   %s\n\n", (int)probes.size(), file_name.c_str());
+}
+
 vector<Experiment_Result> Experiment::random_writes_on_the_side_experiment(Workload_Definition* workload, int write_threads_min, int write_threads_max, int write_threads_inc, string name, int IO_limit, double used_space, int random_writes_min_lba, int random_writes_max_lba) {
 	string data_folder = base_folder + name;
 	mkdir(data_folder.c_str(), 0755);
@@ -220,8 +364,9 @@ vector<Experiment_Result> Experiment::random_writes_on_the_side_experiment(Workl
 		StatisticsGatherer* experiment_statistics_gatherer = new StatisticsGatherer();
 		StatisticsGatherer* random_writes_statics_gatherer = new StatisticsGatherer();
 		Thread* initial_write    = new Asynchronous_Sequential_Writer(0, used_space);
+		OperatingSystem* os = new OperatingSystem();
 		if (workload != NULL) {
-			vector<Thread*> experiment_threads = workload->generate_instance();
+			vector<Thread*> experiment_threads = workload->generate_instance(os);
 			unify_under_one_statistics_gatherer(experiment_threads, experiment_statistics_gatherer);
 			initial_write->add_follow_up_threads(experiment_threads);
 		}
@@ -243,7 +388,6 @@ vector<Experiment_Result> Experiment::random_writes_on_the_side_experiment(Workl
 
 		vector<Thread*> threads;
 		threads.push_back(initial_write);
-		OperatingSystem* os = new OperatingSystem();
 		os->set_threads(threads);
 		os->set_num_writes_to_stop_after(IO_limit);
 		os->run();
@@ -382,7 +526,7 @@ void Experiment::calibrate_and_save(Workload_Definition* workload, string name,
 	OperatingSystem* os = new OperatingSystem();
 	//num_IOs /= 2;
 	os->set_num_writes_to_stop_after(num_IOs);
-	vector<Thread*> init_threads = workload->generate_instance();
+	vector<Thread*> init_threads = workload->generate_instance(os);
 	os->set_threads(init_threads);
 	os->set_progress_meter_granularity(1000);
 
@@ -483,6 +627,7 @@ OperatingSystem* Experiment::load_state(string name) {
 	ia.register_type<DFTL>();
 	ia.register_type<Block_manager_parallel>();
 	ia.register_type<Sequential_Locality_BM>( );
+	ia.register_type<Block_Manager_Tag_Groups>( );
 	ia.register_type<File_Manager>( );
 	ia.register_type<Simple_Thread>( );
 	ia.register_type<Random_IO_Pattern>( );
@@ -5,14 +5,14 @@
 
 using namespace ssd;
 
-Package::Package(long physical_address):
+Package::Package(Page_State_Arena* arena, long physical_address):
 	data(),
 	currently_executing_operation_finish_time(0)
 {
+	data.reserve(PACKAGE_SIZE);
 	for(uint i = 0; i < PACKAGE_SIZE; i++) {
-		int a = physical_address + (DIE_SIZE * PLANE_SIZE * BLOCK_SIZE * i);
-		Die p = Die(a);
-		data.push_back(p);
+		long a = physical_address + ((long)DIE_SIZE * PLANE_SIZE * BLOCK_SIZE * i);
+		data.push_back(Die(arena, a));
 	}
 }
 
@@ -58,24 +58,31 @@ enum status Package::lock(double start_time, double duration, Event& event) {
 
 	if (event.get_event_type() == READ_TRANSFER || event.get_event_type() == COPY_BACK) {
 		Address adr = event.get_address();
-		int last_read_application_io = data[adr.die].get_last_read_application_io();
-
-		if (last_read_application_io == event.get_application_io_id()) {
-			data[adr.die].clear_register();
-		}
-		else if (last_read_application_io == UNDEFINED) {
-			fprintf(stderr, "Register was empty\n", __func__);
+		uint plane = event.get_event_type() == COPY_BACK ? event.get_replace_address().plane : adr.plane;
+		if (!data[adr.die].register_is_busy()) {
+			fprintf(stderr, "Register was empty\n");
 			assert(false);
 		}
-		else if (last_read_application_io != event.get_application_io_id()) {
-			fprintf(stderr, "Data belonging to a different read was in the register:  %d\n", __func__, last_read_application_io);
+		else if (!data[adr.die].register_holds(plane, event.get_application_io_id())) {
+			fprintf(stderr, "Data belonging to a different read was in the register\n");
 			assert(false);
-		} else {
-			data[adr.die].clear_register();
 		}
+		data[adr.die].clear_register(plane, event.get_application_io_id());
 	}
 
 	event.incr_execution_time(duration);
 
 	return SUCCESS;
 }
+
+// The time the channel is occupied to send an operation to a die, or to receive the page of a read transfer
+double Package::get_channel_time(event_type type) {
+	switch (type) {
+		case READ_COMMAND: return BUS_CTRL_DELAY;
+		case READ_TRANSFER: return BUS_CTRL_DELAY + BUS_DATA_DELAY;
+		case WRITE: return 2 * BUS_CTRL_DELAY + BUS_DATA_DELAY;
+		case COPY_BACK: return BUS_CTRL_DELAY;
+		case ERASE: return BUS_CTRL_DELAY;
+		default: return 0;
+	}
+}
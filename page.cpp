@@ -15,6 +15,59 @@ namespace ssd {
 
 using namespace ssd;
 
+Page_State_Arena::Page_State_Arena(ulong num_blocks) :
+	chunks(num_blocks, UNDEFINED),
+	free_chunks(),
+	num_pristine_blocks(num_blocks),
+	states(),
+	logical_addrs(),
+	pages_valid(num_blocks, 0),
+	pages_invalid(num_blocks, 0),
+	erases_remaining(num_blocks, BLOCK_ERASES)
+{}
+
+Page_State_Arena::Page_State_Arena() :
+	chunks(),
+	free_chunks(),
+	num_pristine_blocks(0),
+	states(),
+	logical_addrs(),
+	pages_valid(),
+	pages_invalid(),
+	erases_remaining()
+{}
+
+// Gives a pristine block page state of its own, with all pages empty, reusing the page state of an erased block if there is one
+int Page_State_Arena::materialise(ulong block) {
+	int chunk;
+	if (free_chunks.empty()) {
+		chunk = logical_addrs.size() / BLOCK_SIZE;
+		logical_addrs.resize(logical_addrs.size() + BLOCK_SIZE);
+		states.resize((logical_addrs.size() + 3) / 4);
+	} else {
+		chunk = free_chunks.back();
+		free_chunks.pop_back();
+	}
+	ulong first = (ulong)chunk * BLOCK_SIZE;
+	for (ulong i = first; i < first + BLOCK_SIZE; i++) {
+		states[i / 4] &= ~(3 << (2 * (i % 4)));
+		logical_addrs[i] = UNDEFINED;
+	}
+	chunks[block] = chunk;
+	num_pristine_blocks--;
+	return chunk;
+}
+
+// Makes an erased block pristine again
+void Page_State_Arena::release(ulong block) {
+	if (chunks[block] == UNDEFINED) {
+		return;
+	}
+	free_chunks.push_back(chunks[block]);
+	chunks[block] = UNDEFINED;
+	num_pristine_blocks++;
+}
+
 enum status Page::_read(Event &event)
 {
 	event.incr_execution_time(PAGE_READ_DELAY);
@@ -33,12 +86,12 @@ enum status Page::_write(Event &event)
 		void *data = (char*)page_data + event.get_address().get_linear_address() * PAGE_SIZE;
 		memcpy (data, event.get_payload(), PAGE_SIZE);
 	}*/
-	if (state != EMPTY) {
+	if (get_state() != EMPTY) {
 		printf("You are trying to overwrite a page that is not free. This is illegal. The operations is: \n");
 		event.print();
 	}
-	logical_addr = event.get_logical_address();
-	assert(state == EMPTY);
-	state = VALID;
+	set_logical_addr(event.get_logical_address());
+	assert(get_state() == EMPTY);
+	set_state(VALID);
 	return SUCCESS;
 }
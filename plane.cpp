@@ -5,28 +5,23 @@
 
 using namespace ssd;
 
-Plane::Plane(long physical_address) : data()
-{
-	for(uint i = 0; i < PLANE_SIZE; i++)
-	{
-		int address = physical_address + ( i * BLOCK_SIZE);
-		Block b = Block(address);
-		data.push_back(b);
-	}
-}
+Plane::Plane(Page_State_Arena* arena, long physical_address) :
+		arena(arena),
+		physical_address(physical_address)
+{}
 
-Plane::Plane() : data() {}
+Plane::Plane() : arena(NULL), physical_address(0) {}
 
 enum status Plane::read(Event &event)
 {
 	assert(event.get_address().block < PLANE_SIZE && event.get_address().valid > PLANE);
-	return data[event.get_address().block].read(event);
+	return get_block(event.get_address().block).read(event);
 }
 
 enum status Plane::write(Event &event)
 {
 	assert(event.get_address().block < PLANE_SIZE && event.get_address().valid > PLANE);
-	status s = data[event.get_address().block].write(event);
+	status s = get_block(event.get_address().block).write(event);
 	return s;
 }
 
@@ -38,7 +33,6 @@ enum status Plane::write(Event &event)
 enum status Plane::erase(Event &event)
 {
 	assert(event.get_address().block < PLANE_SIZE && event.get_address().valid > PLANE);
-	enum status status = data[event.get_address().block]._erase(event);
+	enum status status = get_block(event.get_address().block)._erase(event);
 	return status;
 }
-
@@ -0,0 +1,383 @@
+/*
+ * raid_ssd.cpp
+ *
+ *  A RAID array of independent SSDs, driven from the operating system's event loop.
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+RaidSsd::RaidSsd()
+	: Storage_Device(),
+	  devices(),
+	  num_columns(0),
+	  host_ios(),
+	  device_io_to_host_io(),
+	  num_pending_per_device(RAID_NUM_DEVICES, 0),
+	  stats(RAID_NUM_DEVICES)
+{
+	int num_devices = RAID_NUM_DEVICES;
+	num_columns = get_num_columns();
+	if (RAID_CHUNK_SIZE == 0) {
+		fprintf(stderr, "Error: RAID_CHUNK_SIZE must be at least one page.\n");
+		throw;
+	}
+	// Each Ssd re-initializes the global statistics when it is created, so all devices end up reporting to the same global statistics
+	for (int i = 0; i < num_devices; i++) {
+		Ssd* device = new Ssd();
+		device->set_parent_device(this);
+		devices.push_back(device);
+	}
+}
+
+RaidSsd::~RaidSsd() {
+	execute_all_remaining_events();
+	for (auto device : devices) {
+		delete device;
+	}
+}
+
+// =================  Layout  =============================
+
+// The number of chunks of data in a stripe of the array described by RAID_LEVEL and RAID_NUM_DEVICES
+int RaidSsd::get_num_columns() {
+	int num_devices = RAID_NUM_DEVICES;
+	if (RAID_LEVEL == 0 && num_devices >= 1) 						return num_devices;
+	else if (RAID_LEVEL == 1 && num_devices >= 1) 					return 1;
+	else if (RAID_LEVEL == 5 && num_devices >= 3) 					return num_devices - 1;
+	else if (RAID_LEVEL == 10 && num_devices >= 2 && num_devices % 2 == 0) 	return num_devices / 2;
+	fprintf(stderr, "Error: RAID level %d is not supported with %d devices.\n", RAID_LEVEL, num_devices);
+	throw;
+}
+
+// The array exposes the logical space of all its data columns, so each member device fills up as a drive of a real array does
+long RaidSsd::get_num_logical_pages() const {
+	return devices.front()->get_num_logical_pages() * num_columns;
+}
+
+long RaidSsd::get_stripe(long logical_address) const {
+	return logical_address / RAID_CHUNK_SIZE / num_columns;
+}
+
+// Returns all copies of a logical page. There is more than one copy only for RAID-1 and RAID-10.
+vector<RaidSsd::location> RaidSsd::get_data_locations(long logical_address) const {
+	long chunk = logical_address / RAID_CHUNK_SIZE;
+	long stripe = chunk / num_columns;
+	int column = chunk % num_columns;
+	long device_address = stripe * RAID_CHUNK_SIZE + logical_address % RAID_CHUNK_SIZE;
+	vector<location> locations;
+	if (RAID_LEVEL == 0) {
+		locations.push_back(location(column, device_address));
+	}
+	else if (RAID_LEVEL == 1) {
+		for (uint i = 0; i < devices.size(); i++) {
+			locations.push_back(location(i, device_address));
+		}
+	}
+	else if (RAID_LEVEL == 10) {
+		locations.push_back(location(column * 2, device_address));
+		locations.push_back(location(column * 2 + 1, device_address));
+	}
+	else {
+		int parity_device = get_parity_location(logical_address).device;
+		locations.push_back(location((parity_device + 1 + column) % devices.size(), device_address));
+	}
+	return locations;
+}
+
+// RAID-5 rotates the parity chunk over the devices, starting from the last device
+RaidSsd::location RaidSsd::get_parity_location(long logical_address) const {
+	long stripe = get_stripe(logical_address);
+	int parity_device = devices.size() - 1 - stripe % devices.size();
+	return location(parity_device, stripe * RAID_CHUNK_SIZE + logical_address % RAID_CHUNK_SIZE);
+}
+
+// Pages that were never written hold no data, so there is no need to read them when computing parity
+bool RaidSsd::is_written(location const& loc) const {
+	return devices[loc.device]->get_ftl()->get_physical_address(loc.logical_address).valid != NONE;
+}
+
+bool RaidSsd::is_garbage_collecting(location const& loc) const {
+	Address physical = devices[loc.device]->get_ftl()->get_physical_address(loc.logical_address);
+	if (physical.valid < DIE) {
+		return false;
+	}
+	return devices[loc.device]->get_scheduler()->get_migrator()->how_many_gc_operations_are_scheduled_on(physical) > 0;
+}
+
+// Picks the replica to read from. We prefer replicas that are not being garbage-collected, and then the least loaded device.
+int RaidSsd::choose_replica(vector<location> const& replicas) const {
+	int chosen = UNDEFINED;
+	bool chosen_is_collecting = true;
+	for (uint i = 0; i < replicas.size(); i++) {
+		bool collecting = RAID_GC_AWARE_READS && is_garbage_collecting(replicas[i]);
+		int load = num_pending_per_device[replicas[i].device];
+		if (chosen == UNDEFINED
+				|| (chosen_is_collecting && !collecting)
+				|| (collecting == chosen_is_collecting && load < num_pending_per_device[replicas[chosen].device])) {
+			chosen = i;
+			chosen_is_collecting = collecting;
+		}
+	}
+	return chosen;
+}
+
+// =================  Submission  =============================
+
+void RaidSsd::submit(Event* event) {
+	event->set_original_application_io(true);
+	host_io& io = host_ios[event->get_application_io_id()];
+	io.event = event;
+	double time = event->get_ssd_submission_time();
+	long first = event->get_logical_address();
+	long last = first + event->get_size();
+	event_type type = event->get_event_type();
+
+	if (type == READ) {
+		for (long lba = first; lba < last; lba++) {
+			submit_read(io, lba);
+		}
+	}
+	else if (type == WRITE && RAID_LEVEL == 5) {
+		submit_parity_write(io, event);
+	}
+	else if (type == WRITE || type == TRIM) {
+		// Trims are not applied to parity, since it still protects the rest of the stripe
+		for (long lba = first; lba < last; lba++) {
+			for (auto loc : get_data_locations(lba)) {
+				submit_to_device(io, loc, type, time);
+			}
+		}
+	}
+	else {
+		fprintf(stderr, "Error: RaidSsd does not support the submitted event type.\n");
+		event->print(stderr);
+		throw;
+	}
+}
+
+void RaidSsd::submit_read(host_io& io, long logical_address) {
+	double time = io.event->get_ssd_submission_time();
+	vector<location> replicas = get_data_locations(logical_address);
+	if (replicas.size() > 1) {
+		int chosen = choose_replica(replicas);
+		if (chosen != 0) {
+			stats.num_redirected_reads++;
+		}
+		submit_to_device(io, replicas[chosen], READ, time);
+	}
+	else if (RAID_LEVEL == 5 && RAID_GC_AWARE_READS && is_garbage_collecting(replicas.front())) {
+		// Reconstruct the page from the other data chunks in the stripe and the parity
+		stats.num_reconstructed_reads++;
+		for (uint i = 0; i < devices.size(); i++) {
+			location member(i, replicas.front().logical_address);
+			if (i != replicas.front().device && is_written(member)) {
+				submit_to_device(io, member, READ, time);
+			}
+		}
+	}
+	else {
+		submit_to_device(io, replicas.front(), READ, time);
+	}
+}
+
+// Stripes that are written in full have their parity computed directly.
+// Otherwise, we read the old data and old parity, and only then write the new data and parity.
+void RaidSsd::submit_parity_write(host_io& io, Event* event) {
+	double time = event->get_ssd_submission_time();
+	long first = event->get_logical_address();
+	long last = first + event->get_size();
+	long stripe_size = RAID_CHUNK_SIZE * num_columns;
+	for (long stripe_start = first - first % stripe_size; stripe_start < last; stripe_start += stripe_size) {
+		long start = max(first, stripe_start);
+		long end = min(last, stripe_start + stripe_size);
+		bool full_stripe = end - start == stripe_size;
+		set<long> parity_addresses;
+		for (long lba = start; lba < end; lba++) {
+			location data = get_data_locations(lba).front();
+			location parity = get_parity_location(lba);
+			if (full_stripe) {
+				submit_to_device(io, data, WRITE, time);
+			} else {
+				if (is_written(data)) submit_to_device(io, data, READ, time);
+				io.deferred_writes.push_back(data);
+			}
+			if (parity_addresses.count(parity.logical_address) == 0) {
+				parity_addresses.insert(parity.logical_address);
+				if (full_stripe) {
+					submit_to_device(io, parity, WRITE, time);
+				} else {
+					if (is_written(parity)) submit_to_device(io, parity, READ, time);
+					io.deferred_writes.push_back(parity);
+				}
+			}
+		}
+		if (full_stripe) 	stats.num_full_stripe_writes++;
+		else 				stats.num_read_modify_writes++;
+	}
+	// Nothing needed to be read if the stripe was never written before
+	if (io.num_pending == 0) {
+		submit_deferred_writes(io, time);
+	}
+}
+
+void RaidSsd::submit_deferred_writes(host_io& io, double time) {
+	vector<location> writes;
+	swap(writes, io.deferred_writes);
+	for (auto loc : writes) {
+		submit_to_device(io, loc, WRITE, time);
+	}
+}
+
+void RaidSsd::submit_to_device(host_io& io, location const& loc, event_type type, double time) {
+	Ssd* device = devices[loc.device];
+	Event* device_io = new Event(type, loc.logical_address, 1, time);
+	device_io->set_tag(io.event->get_tag());
+	// A device rejects IOs submitted before IOs it has already completed
+	if (device_io->get_ssd_submission_time() < device->get_last_io_submission_time()) {
+		device_io->incr_os_wait_time(device->get_last_io_submission_time() - device_io->get_ssd_submission_time());
+	}
+	device_io_to_host_io[device_io->get_application_io_id()] = pair<uint, int>(io.event->get_application_io_id(), loc.device);
+	io.num_pending++;
+	num_pending_per_device[loc.device]++;
+	stats.num_ios_per_device[loc.device]++;
+	device->submit(device_io);
+}
+
+// =================  Completion  =============================
+
+void RaidSsd::register_event_completion(Event* event) {
+	pair<uint, int> origin = device_io_to_host_io.at(event->get_application_io_id());
+	device_io_to_host_io.erase(event->get_application_io_id());
+	host_io& io = host_ios.at(origin.first);
+	num_pending_per_device[origin.second]--;
+	io.num_pending--;
+
+	double time = event->get_current_time();
+	if (io.slowest_device == UNDEFINED || time >= io.finish_time) {
+		io.finish_time = time;
+		io.slowest_device = origin.second;
+		io.slowest_event_type = event->get_event_type();
+		io.slowest_address = event->get_address();
+	}
+	io.noop = io.noop && event->get_noop();
+	delete event;
+
+	if (io.num_pending > 0) {
+		return;
+	}
+	if (!io.deferred_writes.empty()) {
+		submit_deferred_writes(io, io.finish_time);
+	} else {
+		finish(io);
+	}
+}
+
+// Returns the application IO to the OS once all its device IOs are done. Its latency is that of the slowest device IO.
+void RaidSsd::finish(host_io& io) {
+	Event* orig = io.event;
+	uint id = orig->get_application_io_id();
+	double latency = io.finish_time - orig->get_current_time();
+	orig->incr_accumulated_wait_time(latency);
+	orig->incr_pure_ssd_wait_time(latency);
+	orig->set_noop(io.noop);
+	if (orig->get_event_type() == READ) {
+		orig->set_event_type(READ_TRANSFER);
+	}
+	if (io.slowest_address.valid == PAGE) {
+		orig->set_address(io.slowest_address);
+	}
+	stats.register_completion(io, orig->get_latency());
+	host_ios.erase(id);
+	return_completed_event(orig);
+}
+
+// =================  Progress  =============================
+
+// Always progress the device whose next event is soonest, so all devices advance together in simulated time
+void RaidSsd::progress_since_os_is_waiting() {
+	Ssd* soonest = NULL;
+	double soonest_time = 0;
+	for (auto device : devices) {
+		if (device->is_busy() && (soonest == NULL || device->get_next_event_time() < soonest_time)) {
+			soonest = device;
+			soonest_time = device->get_next_event_time();
+		}
+	}
+	if (soonest != NULL) {
+		soonest->progress_since_os_is_waiting();
+	}
+}
+
+void RaidSsd::execute_all_remaining_events() {
+	while (is_busy()) {
+		progress_since_os_is_waiting();
+	}
+}
+
+bool RaidSsd::is_busy() {
+	for (auto device : devices) {
+		if (device->is_busy()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+double RaidSsd::get_next_event_time() {
+	double time = INFINITE;
+	for (auto device : devices) {
+		if (device->is_busy()) {
+			time = min(time, device->get_next_event_time());
+		}
+	}
+	return time;
+}
+
+// =================  Statistics  =============================
+
+RaidSsd::stats::stats(int num_devices)
+	: read_latencies(),
+	  write_latencies(),
+	  num_ios_per_device(num_devices, 0),
+	  num_times_slowest_per_device(num_devices, 0),
+	  num_full_stripe_writes(0),
+	  num_read_modify_writes(0),
+	  num_reconstructed_reads(0),
+	  num_redirected_reads(0)
+{}
+
+void RaidSsd::stats::register_completion(host_io const& io, double latency) {
+	if (io.noop) {
+		return;
+	}
+	event_type type = io.event->get_event_type();
+	if (type == READ_TRANSFER) 	read_latencies.push_back(latency);
+	else if (type == WRITE) 	write_latencies.push_back(latency);
+	if (io.slowest_device != UNDEFINED) {
+		num_times_slowest_per_device[io.slowest_device]++;
+	}
+}
+
+void RaidSsd::stats::print() const {
+	printf("\nStripe latency:\n");
+	printf("\tcount\tavg\t\tp50\t\tp90\t\tp99\t\tp99.9\t\tmax\n");
+	StatisticsGatherer::print_latency_distribution("reads", read_latencies);
+	StatisticsGatherer::print_latency_distribution("writes", write_latencies);
+
+	printf("\n\tdevice IOs\tslowest in stripe\n");
+	for (uint i = 0; i < num_ios_per_device.size(); i++) {
+		printf("D%d\t%ld\t\t%ld\n", i, num_ios_per_device[i], num_times_slowest_per_device[i]);
+	}
+	printf("\n");
+	printf("full stripe writes:\t%ld\n", num_full_stripe_writes);
+	printf("read-modify-writes:\t%ld\n", num_read_modify_writes);
+	printf("reconstructed reads:\t%ld\n", num_reconstructed_reads);
+	printf("redirected reads:\t%ld\n\n", num_redirected_reads);
+}
+
+void RaidSsd::print_statistics() {
+	printf("RAID-%d over %d devices, chunk size %d pages\n", RAID_LEVEL, (int)devices.size(), RAID_CHUNK_SIZE);
+	stats.print();
+}
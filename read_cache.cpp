@@ -0,0 +1,293 @@
+/*
+ * read_cache.cpp
+ *
+ *  The DRAM read cache of the SSD controller.
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+Read_Cache::Read_Cache(Ssd* ssd)
+	: ssd(ssd),
+	  entries(),
+	  queues(),
+	  target_recent_size(0),
+	  reads_in_flight(),
+	  read_aheads_in_flight(),
+	  pages_being_read_ahead(),
+	  last_read(UNDEFINED),
+	  num_hits(0),
+	  num_misses(0),
+	  num_read_aheads(0),
+	  num_read_ahead_hits(0),
+	  num_unused_read_aheads(0)
+{}
+
+// Returns false if the event is not served by the cache, and should go to flash
+bool Read_Cache::submit(Event* event) {
+	long la = event->get_logical_address();
+	if (event->get_event_type() == WRITE || event->get_event_type() == TRIM) {
+		invalidate(la);
+		return false;
+	}
+	if (event->get_event_type() != READ || event->is_flexible_read()) {
+		return false;
+	}
+	double time = event->get_current_time();
+	bool sequential = last_read != UNDEFINED && la == last_read + 1;
+	last_read = la;
+	auto e = entries.find(la);
+	bool hit = e != entries.end() && is_cached(e->second);
+	if (hit) {
+		num_hits++;
+		if (e->second.prefetched) {
+			num_read_ahead_hits++;
+			e->second.prefetched = false;
+		}
+		access(la, e->second);
+		complete(event, time);
+	} else if (pages_being_read_ahead.count(la) == 1) {
+		// The page is on its way from flash already
+		num_hits++;
+		vector<Event*>& waiting = read_aheads_in_flight[pages_being_read_ahead[la]].waiting;
+		if (waiting.empty()) {
+			num_read_ahead_hits++;
+		}
+		waiting.push_back(event);
+		hit = true;
+	} else {
+		num_misses++;
+		reads_in_flight.insert(la);
+	}
+	if (sequential && READ_CACHE_READAHEAD > 0) {
+		read_ahead(la, time);
+	}
+	return hit;
+}
+
+// Reads the pages after the given one, from the dies that are idle. Pages that are cached or already being read are skipped.
+void Read_Cache::read_ahead(long la, double time) {
+	long max_la = NUMBER_OF_ADDRESSABLE_PAGES() * OVER_PROVISIONING_FACTOR;
+	for (long next = la + 1; next <= la + READ_CACHE_READAHEAD && next < max_la; next++) {
+		auto e = entries.find(next);
+		if ((e != entries.end() && is_cached(e->second)) || reads_in_flight.count(next) == 1 || pages_being_read_ahead.count(next) == 1) {
+			continue;
+		}
+		Address addr = ssd->ftl->get_physical_address(next);
+		if (addr.valid == NONE) {
+			break;
+		}
+		Die* die = ssd->get_package(addr.package)->get_die(addr.die);
+		if (die->get_currently_executing_io_finish_time() > time || die->register_is_busy()) {
+			continue;
+		}
+		Event* read = new Event(READ, next, 1, time);
+		read_aheads_in_flight[read->get_application_io_id()].logical_address = next;
+		pages_being_read_ahead[next] = read->get_application_io_id();
+		reads_in_flight.insert(next);
+		num_read_aheads++;
+		ssd->ftl->read(read);
+	}
+}
+
+// Caches the page of a finished flash read. Returns true if the read was a read ahead, which is then deleted.
+// A read ahead that the scheduler turned into a noop brings no page, so the host reads waiting for it go to flash.
+bool Read_Cache::register_read_completion(Event* event) {
+	uint id = event->get_application_io_id();
+	auto r = !event->is_original_application_io() ? read_aheads_in_flight.find(id) : read_aheads_in_flight.end();
+	if (r == read_aheads_in_flight.end()) {
+		if (event->get_event_type() == READ_TRANSFER && !event->get_noop() && event->is_original_application_io()) {
+			long la = event->get_logical_address();
+			if (reads_in_flight.erase(la) == 1) {
+				insert(la, false);
+			}
+		}
+		return false;
+	}
+	long la = r->second.logical_address;
+	vector<Event*> waiting = r->second.waiting;
+	read_aheads_in_flight.erase(r);
+	bool read_page = event->get_event_type() == READ_TRANSFER && !event->get_noop();
+	double time = event->get_current_time();
+	delete event;
+
+	// The page is only cached if it was not overwritten while it was read
+	auto p = pages_being_read_ahead.find(la);
+	if (p != pages_being_read_ahead.end() && p->second == id) {
+		pages_being_read_ahead.erase(p);
+		if (reads_in_flight.erase(la) == 1 && read_page) {
+			insert(la, waiting.empty());
+		}
+	}
+	for (auto read : waiting) {
+		if (read_page) {
+			complete(read, time);
+		} else {
+			resubmit(read, time);
+		}
+	}
+	return true;
+}
+
+// Sends a host read that waited for a read ahead that brought no page to flash
+void Read_Cache::resubmit(Event* event, double time) {
+	double wait_time = fmax(0.0, time - event->get_current_time());
+	event->incr_accumulated_wait_time(wait_time);
+	event->incr_pure_ssd_wait_time(wait_time);
+	reads_in_flight.insert(event->get_logical_address());
+	ssd->ftl->read(event);
+}
+
+// Returns a host read from the cache
+void Read_Cache::complete(Event* event, double time) {
+	double wait_time = fmax(0.0, time - event->get_current_time());
+	event->incr_accumulated_wait_time(wait_time);
+	event->incr_pure_ssd_wait_time(wait_time);
+	event->set_event_type(READ_TRANSFER);
+	event->incr_execution_time(RAM_READ_DELAY);
+	event->set_served_from_ram(true);
+	StatisticsGatherer::get_global_instance()->register_completed_event(*event);
+	ssd->scheduler->complete(event);
+}
+
+// Updates the position of a cached page that has just been read
+void Read_Cache::access(long la, entry& e) {
+	if (READ_CACHE_POLICY == 0) {
+		move(la, e, RECENT);
+	} else if (READ_CACHE_POLICY == 1 && e.queue == FREQUENT) {
+		move(la, e, FREQUENT);
+	} else if (READ_CACHE_POLICY == 2) {
+		move(la, e, FREQUENT);
+	}
+}
+
+void Read_Cache::insert(long la, bool prefetched) {
+	auto e = entries.find(la);
+	if (e != entries.end() && is_cached(e->second)) {
+		return;
+	}
+	bool in_recent_ghosts = e != entries.end() && e->second.queue == RECENT_GHOSTS;
+	bool in_frequent_ghosts = e != entries.end() && e->second.queue == FREQUENT_GHOSTS;
+	uint size = READ_CACHE_SIZE;
+	queue_id target = RECENT;
+
+	if (READ_CACHE_POLICY == 1) {
+		// 2Q: new pages go through a FIFO queue first. Pages read again soon after they left it go to the LRU queue.
+		while (num_cached_pages() >= size) {
+			if (queues[RECENT].size() > max(1u, size / 4) || queues[FREQUENT].empty()) {
+				evict(RECENT, RECENT_GHOSTS);
+				if (queues[RECENT_GHOSTS].size() > size / 2) {
+					remove(queues[RECENT_GHOSTS].front());
+				}
+			} else {
+				remove(queues[FREQUENT].front());
+			}
+		}
+		in_recent_ghosts = entries.count(la) == 1;
+		target = in_recent_ghosts ? FREQUENT : RECENT;
+	} else if (READ_CACHE_POLICY == 2) {
+		// ARC: the target size of the RECENT queue grows on hits in its ghosts, and shrinks on hits in the ghosts of FREQUENT
+		double recent_ghosts = queues[RECENT_GHOSTS].size();
+		double frequent_ghosts = queues[FREQUENT_GHOSTS].size();
+		if (in_recent_ghosts) {
+			target_recent_size = fmin(size, target_recent_size + fmax(frequent_ghosts / recent_ghosts, 1));
+			replace(false);
+			target = FREQUENT;
+		} else if (in_frequent_ghosts) {
+			target_recent_size = fmax(0, target_recent_size - fmax(recent_ghosts / frequent_ghosts, 1));
+			replace(true);
+			target = FREQUENT;
+		} else if (queues[RECENT].size() + queues[RECENT_GHOSTS].size() >= size) {
+			if (queues[RECENT].size() < size) {
+				remove(queues[RECENT_GHOSTS].front());
+				replace(false);
+			} else {
+				remove(queues[RECENT].front());
+			}
+		} else if (num_cached_pages() + recent_ghosts + frequent_ghosts >= size) {
+			if (num_cached_pages() + recent_ghosts + frequent_ghosts >= 2 * size) {
+				remove(queues[FREQUENT_GHOSTS].front());
+			}
+			replace(false);
+		}
+	} else {
+		while (num_cached_pages() >= size) {
+			remove(queues[RECENT].front());
+		}
+	}
+
+	entry& new_entry = entries[la];
+	new_entry.prefetched = prefetched;
+	if (in_recent_ghosts || in_frequent_ghosts) {
+		move(la, new_entry, target);
+	} else {
+		push(la, new_entry, target);
+	}
+}
+
+// ARC: makes room for a page by moving the least recently used page of RECENT or FREQUENT to its ghosts
+void Read_Cache::replace(bool in_frequent_ghosts) {
+	if (num_cached_pages() < READ_CACHE_SIZE) {
+		return;
+	}
+	uint recent_size = queues[RECENT].size();
+	if (recent_size > 0 && (queues[FREQUENT].empty() || recent_size > target_recent_size || (in_frequent_ghosts && recent_size == target_recent_size))) {
+		evict(RECENT, RECENT_GHOSTS);
+	} else {
+		evict(FREQUENT, FREQUENT_GHOSTS);
+	}
+}
+
+void Read_Cache::evict(queue_id from, queue_id to) {
+	long la = queues[from].front();
+	entry& e = entries[la];
+	if (e.prefetched) {
+		num_unused_read_aheads++;
+		e.prefetched = false;
+	}
+	move(la, e, to);
+}
+
+void Read_Cache::push(long la, entry& e, queue_id queue) {
+	e.queue = queue;
+	e.position = queues[queue].insert(queues[queue].end(), la);
+}
+
+void Read_Cache::move(long la, entry& e, queue_id queue) {
+	queues[e.queue].erase(e.position);
+	push(la, e, queue);
+}
+
+void Read_Cache::remove(long la) {
+	entry& e = entries[la];
+	if (is_cached(e) && e.prefetched) {
+		num_unused_read_aheads++;
+	}
+	queues[e.queue].erase(e.position);
+	entries.erase(la);
+}
+
+// The page is overwritten, so the cached copy and flash reads in flight are stale. Later reads of the page go to flash
+// rather than wait for a read ahead of the old page, while the reads already waiting for it are still served by it.
+void Read_Cache::invalidate(long la) {
+	reads_in_flight.erase(la);
+	pages_being_read_ahead.erase(la);
+	if (entries.count(la) == 1) {
+		remove(la);
+	}
+}
+
+void Read_Cache::print_statistics() const {
+	const char* policies[] = { "LRU", "2Q", "ARC" };
+	printf("Read cache of %d pages, %s\n", READ_CACHE_SIZE, policies[READ_CACHE_POLICY]);
+	printf("hits:\t\t\t%ld\n", num_hits);
+	printf("misses:\t\t\t%ld\n", num_misses);
+	printf("hit ratio:\t\t%f\n", num_hits + num_misses == 0 ? 0 : num_hits / (double)(num_hits + num_misses));
+	printf("pages read ahead:\t%ld\n", num_read_aheads);
+	printf("read ahead, then read:\t%ld\n", num_read_ahead_hits);
+	printf("read ahead, never read:\t%ld\n", num_unused_read_aheads);
+	printf("flash reads saved:\t%ld\n", num_hits - num_read_ahead_hits);
+	printf("extra flash reads:\t%ld\n", num_read_aheads - num_read_ahead_hits);
+	printf("avg LUN utilization:\t%f\n\n", Utilization_Meter::get_avg_LUN_utilization());
+}
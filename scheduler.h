@@ -146,11 +146,14 @@ public:
 	void schedule_events_queue(deque<Event*> events);
 	void schedule_event(Event* event);
 	bool is_empty();
+	inline bool has_completed_events() const { return !completed_events->empty(); }
+	double get_next_event_time() const;
 	void execute_soonest_events();
 	void handle(vector<Event*>& events);
 	void handle(Event* event);
 	void handle_noop_events(vector<Event*>& events);
 	void inform_FTL_of_noop_completion(Event* event);
+	void complete(Event* event);
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
@@ -182,7 +185,6 @@ private:
 	void manage_operation_completion(Event* event);
 	double get_soonest_event_time(vector<Event*> const& events) const;
 	void send_earliest_completed_events_back();
-	void complete(Event* event);
 
 	event_queue* future_events;
 	Scheduling_Strategy* overdue_events;
@@ -13,16 +13,24 @@
 using namespace ssd;
 
 Ssd::Ssd():
+	page_states(new Page_State_Arena(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)),
 	data(),
+	num_logical_pages(OVER_PROVISIONING_FACTOR * NUMBER_OF_ADDRESSABLE_PAGES()),
 	last_io_submission_time(0.0),
-	os(NULL),
-	large_events_map(),
-	ftl(NULL)
+	ftl(NULL),
+	write_buffer(NULL),
+	read_cache(NULL),
+	large_ios(),
+	free_large_io_slots(),
+	large_ios_with_unissued_pages(),
+	free_large_io_pages(),
+	num_large_io_pages_in_flight(0),
+	max_large_io_pages_in_flight(MAX_LARGE_IO_PAGES_IN_FLIGHT > 0 ? MAX_LARGE_IO_PAGES_IN_FLIGHT : INFINITE)
 {
+	data.reserve(SSD_SIZE);
 	for(uint i = 0; i < SSD_SIZE; i++) {
-		int a = PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE * i;
-		Package p = Package(a);
-		data.push_back(p);
+		long a = (long)PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE * i;
+		data.push_back(Package(page_states, a));
 	}
 	
 	// Check for 32bit machine. We do not allow page data on 32bit machines.
@@ -88,6 +96,13 @@ Ssd::Ssd():
 	scheduler->init(this, ftl, bm, migrator);
 	migrator->init(scheduler, bm, gc, wl, ftl, this);
 
+	if (WRITE_BUFFER_SIZE > 0) {
+		write_buffer = new Write_Buffer(this, migrator);
+	}
+	if (READ_CACHE_SIZE > 0) {
+		read_cache = new Read_Cache(this);
+	}
+
 	StateVisualiser::init(this);
 
 	SsdStatisticsExtractor::init(this);
@@ -104,8 +119,14 @@ Ssd::~Ssd()
 		ulong pageSize = ((ulong)(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE)) * (ulong)PAGE_SIZE;
 		munmap(page_data, pageSize);
 	}*/
+	delete write_buffer;
+	delete read_cache;
 	delete ftl;
 	delete scheduler;
+	delete page_states;
+	for (auto page : free_large_io_pages) {
+		delete page;
+	}
 }
 
 void Ssd::execute_all_remaining_events() {
@@ -129,21 +150,21 @@ void Ssd::submit(Event* event) {
 	event->set_original_application_io(true);
 	//IOScheduler::instance()->finish_all_events_until_this_time(event->get_ssd_submission_time());
 
-	// If the IO spans several flash pages, we break it into multiple flash page IOs
+	// If the IO spans several flash pages, we break it into single page IOs, which are issued as earlier ones finish.
 	// When these page IOs are all finished, we return to the OS
-	static int ssd_id_generator = 0;
 	if (event->get_size() > 1 && event->get_tag() == UNDEFINED) {
-		int ssd_id = ssd_id_generator++;
-		event->set_ssd_id(ssd_id);
-		large_events_map.resiger_large_event(event);
-		for (int i = 0; i < event->get_size(); i++) {
-			Event* e = new Event(*event);
-			e->set_application_io_id(ssd_id_generator++);
-			e->set_ssd_id(ssd_id);
-			e->set_size(1);
-			e->set_logical_address(event->get_logical_address() + i);
-			submit_to_ftl(e);
+		int slot;
+		if (free_large_io_slots.empty()) {
+			slot = large_ios.size();
+			large_ios.push_back(large_io());
+		} else {
+			slot = free_large_io_slots.back();
+			free_large_io_slots.pop_back();
 		}
+		large_ios[slot].parent = event;
+		event->set_ssd_id(slot);
+		large_ios_with_unissued_pages.push(slot);
+		issue_pages_of_large_ios(event->get_current_time());
 	}
 	else {
 		submit_to_ftl(event);
@@ -151,36 +172,44 @@ void Ssd::submit(Event* event) {
 }
 
 void Ssd::submit_to_ftl(Event* event) {
+	if (read_cache != NULL && read_cache->submit(event)) {
+		return;
+	}
+	if (write_buffer != NULL && write_buffer->submit(event)) {
+		return;
+	}
 	if(event->get_event_type() 		== READ) 		ftl->read(event);
 	else if(event->get_event_type() == WRITE) 		ftl->write(event);
 	else if(event->get_event_type() == TRIM) 		ftl->trim(event);
 	else if(event->get_event_type() == MESSAGE) 	scheduler->schedule_event(event);
 }
 
-void Ssd::io_map::resiger_large_event(Event* e) {
-	event_map[e->get_ssd_id()] = e;
-	assert(event_map.count(e->get_ssd_id()));
-	io_counter[e->get_ssd_id()] = 0;
-}
-
-void Ssd::io_map::register_completion(Event* e) {
-	io_counter[e->get_ssd_id()]++;
-}
-
-bool Ssd::io_map::is_part_of_large_event(Event* e) {
-	return event_map.count(e->get_ssd_id()) == 1;
-}
-
-bool Ssd::io_map::is_finished(int id) const {
-	Event* orig = event_map.at(id);
-	return io_counter.at(id) == orig->get_size();
-}
-
-Event* Ssd::io_map::get_original_event(int id) {
-	Event* orig = event_map.at(id);
-	event_map.erase(id);
-	io_counter.erase(id);
-	return orig;
+// Issues the next pages of large IOs, first come first served, for as long as there is room for them
+void Ssd::issue_pages_of_large_ios(double time) {
+	while (num_large_io_pages_in_flight < max_large_io_pages_in_flight && !large_ios_with_unissued_pages.empty()) {
+		int slot = large_ios_with_unissued_pages.front();
+		large_io& io = large_ios[slot];
+		Event* parent = io.parent;
+		Event* page;
+		if (free_large_io_pages.empty()) {
+			page = new Event(parent->get_event_type(), parent->get_logical_address() + io.num_issued, 1, parent->get_start_time());
+		} else {
+			page = free_large_io_pages.back();
+			free_large_io_pages.pop_back();
+			*page = Event(parent->get_event_type(), parent->get_logical_address() + io.num_issued, 1, parent->get_start_time());
+		}
+		page->set_original_application_io(true);
+		page->set_ssd_id(slot);
+		// The page has waited in the OS as long as its IO, and only its wait for room in the window is on the SSD
+		page->incr_os_wait_time(parent->get_os_wait_time());
+		double issue_time = max(time, parent->get_current_time());
+		page->incr_bus_wait_time(issue_time - page->get_current_time());
+		if (++io.num_issued == parent->get_size()) {
+			large_ios_with_unissued_pages.pop();
+		}
+		num_large_io_pages_in_flight++;
+		submit_to_ftl(page);
+	}
 }
 
 void Ssd::event_arrive(enum event_type type, ulong logical_address, uint size, double start_time)
@@ -205,6 +234,14 @@ void Ssd::progress_since_os_is_waiting() {
 	scheduler->execute_soonest_events();
 }
 
+bool Ssd::is_busy() {
+	return !scheduler->is_empty() || scheduler->has_completed_events();
+}
+
+double Ssd::get_next_event_time() {
+	return scheduler->get_next_event_time();
+}
+
 void Ssd::register_event_completion(Event * event) {
 	if (event->is_original_application_io() && !event->get_noop() && !event->is_cached_write() && (event->get_event_type() == WRITE || event->get_event_type() == READ_TRANSFER)) {
 		last_io_submission_time = max(last_io_submission_time, event->get_ssd_submission_time());
@@ -214,28 +251,49 @@ void Ssd::register_event_completion(Event * event) {
 		return;
 	}
 
-	if (os == NULL || !event->is_original_application_io()) {
+	if (write_buffer != NULL && write_buffer->register_flush_completion(event)) {
+		return;
+	}
+
+	if (read_cache != NULL && read_cache->register_read_completion(event)) {
+		return;
+	}
+
+	if (!has_host() || !event->is_original_application_io()) {
 		delete event;
 		return;
 	}
 
 	// Check if the completed page IO is a part of a big IO that spans multiple pages.
-	if (large_events_map.is_part_of_large_event(event)) {
-		large_events_map.register_completion(event);
-		if (large_events_map.is_finished(event->get_ssd_id())) {
-			Event* orig = large_events_map.get_original_event(event->get_ssd_id());
-			orig->incr_accumulated_wait_time(event->get_current_time() - orig->get_current_time());
-			orig->incr_pure_ssd_wait_time(event->get_current_time() - orig->get_current_time());
-			delete event;
-			os->register_event_completion(orig);
-		} else {
-			delete event;
-		}
+	int slot = event->get_ssd_id();
+	if (slot == UNDEFINED) {
+		return_completed_event(event);
+		return;
 	}
-	else {
-		os->register_event_completion(event);
+	large_io& io = large_ios[slot];
+	io.num_completed++;
+	io.finish_time = max(io.finish_time, event->get_current_time());
+	num_large_io_pages_in_flight--;
+	double time = event->get_current_time();
+	free_large_io_pages.push_back(event);
+	if (io.num_completed == io.parent->get_size()) {
+		Event* orig = io.parent;
+		orig->incr_accumulated_wait_time(io.finish_time - orig->get_current_time());
+		orig->incr_pure_ssd_wait_time(io.finish_time - orig->get_current_time());
+		io = large_io();
+		free_large_io_slots.push_back(slot);
+		return_completed_event(orig);
 	}
+	issue_pages_of_large_ios(time);
+}
 
+void Ssd::print_statistics() {
+	if (write_buffer != NULL) {
+		write_buffer->print_statistics();
+	}
+	if (read_cache != NULL) {
+		read_cache->print_statistics();
+	}
 }
 
 /*
@@ -272,8 +330,12 @@ enum status Ssd::erase(Event &event)
 	return data[event.get_address().package].erase(event);
 }
 
-void Ssd::set_operating_system(OperatingSystem* new_os) {
-	os = new_os;
+void Storage_Device::return_completed_event(Event* event) {
+	if (parent != NULL) {
+		parent->register_event_completion(event);
+	} else {
+		os->register_event_completion(event);
+	}
 }
 
 double Ssd::get_currently_executing_operation_finish_time(int package) {
@@ -285,24 +347,17 @@ enum status Ssd::issue(Event *event) {
 	//if (event->get_logical_address() == 0 && event->get_event_type() != ERASE && event->get_event_type() != READ_COMMAND && event->get_event_type() != READ_TRANSFER) {
 		//event->print();
 	//}
-	if(event -> get_event_type() == READ_COMMAND) {
-		data[package].lock(event->get_current_time(), BUS_CTRL_DELAY, *event);
-		read(*event);
-	}
-	else if(event -> get_event_type() == READ_TRANSFER) {
-		data[package].lock(event->get_current_time(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *event);
+	event_type type = event->get_event_type();
+	if (type == READ_COMMAND || type == READ_TRANSFER || type == WRITE || type == COPY_BACK || type == ERASE) {
+		data[package].lock(event->get_current_time(), Package::get_channel_time(type), *event);
 	}
-	else if(event -> get_event_type() == WRITE) {
-		data[package].lock(event->get_current_time(), 2 * BUS_CTRL_DELAY + BUS_DATA_DELAY, *event);
-		write(*event);
-		return SUCCESS;
+	if (type == READ_COMMAND) {
+		read(*event);
 	}
-	else if(event -> get_event_type() == COPY_BACK) {
-		data[package].lock(event->get_current_time(), BUS_CTRL_DELAY, *event);
+	else if (type == WRITE || type == COPY_BACK) {
 		write(*event);
 	}
-	else if(event -> get_event_type() == ERASE) {
-		data[package].lock(event -> get_current_time(), BUS_CTRL_DELAY, *event);
+	else if (type == ERASE) {
 		erase(*event);
 	}
 	return SUCCESS;
@@ -17,6 +17,8 @@
 #include <unordered_set>
 #include <set>
 #include <algorithm>
+#include <functional>
+#include <list>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/serialization/vector.hpp>
@@ -75,8 +77,8 @@ void print_config(FILE *stream);
 
 /* Ram class:
  * 	delay to read from and write to the RAM for 1 page of data */
-extern const double RAM_READ_DELAY;
-extern const double RAM_WRITE_DELAY;
+extern double RAM_READ_DELAY;
+extern double RAM_WRITE_DELAY;
 
 extern int OS_SCHEDULER;
 
@@ -102,8 +104,12 @@ extern uint SSD_SIZE;
 extern uint PACKAGE_SIZE;
 
 /* Die class:
- * 	number of Planes per Die (size) */
+ * 	number of Planes per Die (size)
+ * 	whether same-die operations on different planes are combined into multi-plane operations
+ * 	whether planes have a cache register, letting transfers overlap the array operations of a die */
 extern uint DIE_SIZE;
+extern bool ENABLE_MULTI_PLANE_OPERATIONS;
+extern bool ENABLE_CACHE_MODE;
 
 /* Plane class:
  * 	number of Blocks per Plane (size)
@@ -196,6 +202,50 @@ extern uint MAX_ITEMS_IN_COPY_BACK_MAP;
 
 /* Defines the maximal length of the SSD queue  */
 extern int MAX_SSD_QUEUE_SIZE;
+extern uint MAX_LARGE_IO_PAGES_IN_FLIGHT;
+
+/* Defines the size of the controller's DRAM write-back buffer, and the fill levels between which it writes dirty pages to flash */
+extern uint WRITE_BUFFER_SIZE;
+extern double WRITE_BUFFER_HIGH_WATERMARK;
+extern double WRITE_BUFFER_LOW_WATERMARK;
+
+/* Defines the size of the controller's DRAM read cache, its replacement policy, and how many pages are read ahead for sequential reads */
+extern uint READ_CACHE_SIZE;
+extern int READ_CACHE_POLICY;
+extern uint READ_CACHE_READAHEAD;
+
+/* Defines the NVMe-style submission/completion queue pairs of the host interface, how commands are fetched from them, and interrupt coalescing */
+extern uint NVME_NUM_QUEUES;
+extern uint NVME_QUEUE_DEPTH;
+extern int NVME_ARBITRATION;
+extern uint NVME_ARBITRATION_BURST;
+extern uint NVME_HIGH_PRIORITY_WEIGHT;
+extern uint NVME_MEDIUM_PRIORITY_WEIGHT;
+extern uint NVME_LOW_PRIORITY_WEIGHT;
+extern uint NVME_COALESCING_THRESHOLD;
+extern double NVME_COALESCING_TIME;
+
+/* Defines the link between the host and the SSD: its type, width, per command overhead, and whether it transfers in both directions at once */
+extern int HOST_LINK_TYPE;
+extern uint HOST_LINK_PCIE_GENERATION;
+extern uint HOST_LINK_PCIE_LANES;
+extern double HOST_LINK_COMMAND_OVERHEAD;
+extern bool HOST_LINK_FULL_DUPLEX;
+
+/* Defines whether the OS talks to a single SSD or to a RAID array of SSDs, and how the array is laid out */
+extern int RAID_LEVEL;
+extern uint RAID_NUM_DEVICES;
+extern uint RAID_CHUNK_SIZE;
+extern bool RAID_GC_AWARE_READS;
+
+/* Defines whether the OS talks to a small cache SSD in front of a capacity SSD, and how pages move between the tiers */
+extern bool ENABLE_TIERED_STORAGE;
+extern int TIER_ADMISSION_POLICY;
+extern uint TIER_ADMISSION_THRESHOLD;
+extern int TIER_EVICTION_POLICY;
+extern double TIER_DESTAGE_HIGH_WATERMARK;
+extern double TIER_DESTAGE_LOW_WATERMARK;
+extern uint TIER_MAX_ONGOING_DESTAGES;
 
 /* Defines how the sequential writes detection algorithm spreads a sequential write  */
 extern uint LOCALITY_PARALLEL_DEGREE;
@@ -282,7 +332,11 @@ class FtlParent;
 class FtlImpl_Page;
 class DFTL;
 class FAST;
+class Storage_Device;
 class Ssd;
+class RaidSsd;
+class Tiered_Ssd;
+class StatisticsGatherer;
 
 class event_queue;
 class IOScheduler;
@@ -418,6 +472,8 @@ public:
 	inline int get_tag() const 							{ return tag; }
 	inline void set_tag(int new_tag) 					{ tag = new_tag; }
 	inline void set_thread_id(int new_thread_id)		{ thread_id = new_thread_id; }
+	inline int get_os_slot() const						{ return os_slot; }
+	inline void set_os_slot(int slot)					{ os_slot = slot; }
 	inline void set_address(const Address &address) {
 		if (type == WRITE || type == READ || type == READ_COMMAND || type == READ_TRANSFER)
 			assert(address.valid == PAGE);
@@ -435,6 +491,10 @@ public:
 	inline void set_copyback(bool value)					{ copyback = value; }
 	inline void set_cached_write(bool value)				{ cached_write = value; }
 	inline bool is_cached_write()							{ return cached_write; }
+	inline void set_buffer_flush(bool value)				{ buffer_flush = value; }
+	inline bool is_buffer_flush() const						{ return buffer_flush; }
+	inline void set_served_from_ram(bool value)				{ served_from_ram = value; }
+	inline bool is_served_from_ram() const					{ return served_from_ram; }
 	inline int get_age_class() const 						{ return age_class; }
 	inline bool is_garbage_collection_op() const 			{ return garbage_collection_op; }
 	inline bool is_mapping_op() const 						{ return mapping_op; }
@@ -477,6 +537,8 @@ protected:
 	bool original_application_io;
 	bool copyback;
 	bool cached_write;
+	bool buffer_flush;	// a write of a page of the controller's write buffer to flash
+	bool served_from_ram;	// a host IO that the write buffer or read cache of the controller completed without flash
 
 	// an ID for a single IO to the chip. This is not actually used for any logical purpose
 	static uint id_generator;
@@ -492,6 +554,7 @@ protected:
 	int tag;
 
 	int thread_id;
+	int os_slot;		// the operating system's in-flight slot of an application IO, or UNDEFINED
 	double pure_ssd_wait_time;
 	int num_iterations_in_scheduler;
 };
@@ -503,91 +566,155 @@ public:
 
 
 
-/* The page is the lowest level data storage unit that is the size unit of
- * requests (events).  Pages maintain their state as events modify them. */
-class Page 
+extern const int UNDEFINED;
+extern const int INFINITE;
+
+/* The state of every page of a device, in flat arrays rather than in its blocks: two bits for the state of each page, the
+ * logical address each page holds, and the counters of each block. Blocks and pages are views into it, so the flash of
+ * even a very large device is built with a handful of allocations. The page state of a block is only allocated when the
+ * block is first programmed, and is given back when it is erased. Until then, the block is pristine, and its pages are
+ * empty. Memory thus follows the written footprint of the device rather than its capacity. */
+class Page_State_Arena
 {
 public:
-	inline Page() : state(EMPTY), logical_addr(-1) {}
-	inline ~Page() {}
-	enum status _read(Event &event);
-	enum status _write(Event &event);
-	inline enum page_state get_state() const { return state; }
-	inline void set_state(page_state val) { state = val; }
+	Page_State_Arena(ulong num_blocks);
+	Page_State_Arena();
+	inline enum page_state get_state(ulong page) const {
+		int chunk = chunks[page / BLOCK_SIZE];
+		if (chunk == UNDEFINED) return EMPTY;
+		ulong i = (ulong)chunk * BLOCK_SIZE + page % BLOCK_SIZE;
+		return (enum page_state)((states[i / 4] >> (2 * (i % 4))) & 3);
+	}
+	inline void set_state(ulong page, enum page_state state) {
+		int chunk = chunks[page / BLOCK_SIZE];
+		if (chunk == UNDEFINED && state == EMPTY) return;
+		if (chunk == UNDEFINED) chunk = materialise(page / BLOCK_SIZE);
+		ulong i = (ulong)chunk * BLOCK_SIZE + page % BLOCK_SIZE;
+		uint shift = 2 * (i % 4);
+		states[i / 4] = (states[i / 4] & ~(3 << shift)) | (state << shift);
+	}
+	inline int get_logical_addr(ulong page) const {
+		int chunk = chunks[page / BLOCK_SIZE];
+		return chunk == UNDEFINED ? UNDEFINED : logical_addrs[(ulong)chunk * BLOCK_SIZE + page % BLOCK_SIZE];
+	}
+	inline void set_logical_addr(ulong page, int logical_addr) {
+		int chunk = chunks[page / BLOCK_SIZE];
+		if (chunk == UNDEFINED && logical_addr == UNDEFINED) return;
+		if (chunk == UNDEFINED) chunk = materialise(page / BLOCK_SIZE);
+		logical_addrs[(ulong)chunk * BLOCK_SIZE + page % BLOCK_SIZE] = logical_addr;
+	}
+	void release(ulong block);
+	inline ulong get_num_materialised_blocks() const { return chunks.size() - num_pristine_blocks; }
+	friend class Block;
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
     {
-        ar & state;
+    	ar & chunks;
+    	ar & free_chunks;
+    	ar & num_pristine_blocks;
+    	ar & states;
+    	ar & logical_addrs;
+    	ar & pages_valid;
+    	ar & pages_invalid;
+    	ar & erases_remaining;
     }
-    void set_logical_addr(int l) { logical_addr = l;}
-    int get_logical_addr() const { return logical_addr; }
 private:
-	enum page_state state;
-	int logical_addr;
+	int materialise(ulong block);
+	vector<int> chunks;           // where the page state of each block is, or UNDEFINED while it is pristine
+	vector<int> free_chunks;      // page state given back by erased blocks
+	ulong num_pristine_blocks;
+	vector<unsigned char> states; // four pages per byte
+	vector<int> logical_addrs;
+	vector<uint> pages_valid;     // the counters are per block
+	vector<uint> pages_invalid;
+	vector<uint> erases_remaining;
+};
+
+/* The page is the lowest level data storage unit that is the size unit of
+ * requests (events).  Pages maintain their state as events modify them.
+ * A page is a view of one page in the page state arena of its device. */
+class Page 
+{
+public:
+	inline Page(Page_State_Arena* arena, ulong address) : arena(arena), address(address) {}
+	enum status _read(Event &event);
+	enum status _write(Event &event);
+	inline enum page_state get_state() const { return arena->get_state(address); }
+	inline void set_state(page_state val) { arena->set_state(address, val); }
+	inline void set_logical_addr(int l) { arena->set_logical_addr(address, l); }
+	inline int get_logical_addr() const { return arena->get_logical_addr(address); }
+private:
+	Page_State_Arena* arena;
+	ulong address;
 };
 
 /* The block is the data storage hardware unit where erases are implemented.
- * Blocks maintain wear statistics for the FTL. */
+ * Blocks maintain wear statistics for the FTL. A block is a view of one block in the page state arena of its device,
+ * created on demand by its plane, and two views of the same block compare equal. A default constructed block is no
+ * block at all. */
 class Block 
 {
 public:
-	Block(long physical_address);
+	Block(Page_State_Arena* arena, long physical_address);
 	Block();
 	~Block() {}
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status _erase(Event &event);
-	inline uint get_pages_valid() const { return pages_valid; }
-	inline uint get_pages_invalid() const { return pages_invalid; }
+	inline uint get_pages_valid() const { return arena->pages_valid[get_id()]; }
+	inline uint get_pages_invalid() const { return arena->pages_invalid[get_id()]; }
 	inline enum block_state get_state() const {
+		uint pages_valid = get_pages_valid();
+		uint pages_invalid = get_pages_invalid();
 		return 	pages_invalid == BLOCK_SIZE ? INACTIVE :
 				pages_valid == BLOCK_SIZE ? ACTIVE :
 				pages_invalid + pages_valid == BLOCK_SIZE ? ACTIVE : PARTIALLY_FREE;
 	}
-	inline ulong get_erases_remaining() const { return erases_remaining; }
+	inline ulong get_erases_remaining() const { return arena->erases_remaining[get_id()]; }
 	void invalidate_page(uint page);
 	inline long get_physical_address() const { return physical_address; }
-	inline Block *get_pointer() { return this; }
-	inline Page const& get_page(int i) const { return data[i]; }
-	inline ulong get_age() const { return BLOCK_ERASES - erases_remaining; }
+	inline bool is_null() const { return arena == NULL; }
+	inline bool operator==(Block const& other) const { return physical_address == other.physical_address && arena == other.arena; }
+	inline bool operator!=(Block const& other) const { return !(*this == other); }
+	inline bool operator<(Block const& other) const { return physical_address < other.physical_address; }
+	inline Page get_page(int i) const { return Page(arena, physical_address + i); }
+	inline ulong get_age() const { return BLOCK_ERASES - get_erases_remaining(); }
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
     {
-    	ar & pages_invalid;
+    	ar & arena;
     	ar & physical_address;
-    	ar & data;
-    	ar & pages_valid;
-    	ar & erases_remaining;
     }
 private:
-	uint pages_invalid;
+	inline ulong get_id() const { return physical_address / BLOCK_SIZE; }
+	Page_State_Arena* arena;
 	long physical_address;
-	vector<Page> data;
-	uint pages_valid;
-	ulong erases_remaining;
 };
 
-/* The plane is the data storage hardware unit that contains blocks.*/
+/* The plane is the data storage hardware unit that contains blocks.
+ * It holds no state per block; its blocks are views into the page state arena, built when asked for. */
 class Plane 
 {
 public:
-	Plane(long physical_address);
+	Plane(Page_State_Arena* arena, long physical_address);
 	Plane();
 	~Plane() {}
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
-	inline Block *get_block(int i) { return &data[i]; }
+	inline Block get_block(int i) const { return Block(arena, physical_address + (long)i * BLOCK_SIZE); }
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
     {
-        ar & data;
+        ar & arena;
+        ar & physical_address;
     }
 private:
-	vector<Block> data;
+	Page_State_Arena* arena;
+	long physical_address;
 };
 
 /* The die is the data storage hardware unit that contains planes and is a flash
@@ -595,7 +722,7 @@ private:
 class Die 
 {
 public:
-	Die(long physical_address);
+	Die(Page_State_Arena* arena, long physical_address);
 	Die();
 	~Die() {}
 	enum status read(Event &event);
@@ -603,9 +730,13 @@ public:
 	enum status erase(Event &event);
 	double get_currently_executing_io_finish_time();
 	inline Plane *get_plane(int i) { return &data[i]; }
-	void clear_register();
-	int get_last_read_application_io();
-	bool register_is_busy();
+	void clear_register(int plane, int application_io);
+	bool register_holds(int plane, int application_io) const;
+	bool register_is_busy() const;
+	bool register_is_busy(int plane) const;
+	bool accepts_multi_plane_op(Address const& address, event_type type) const;
+	bool can_join_multi_plane_op(Address const& address, event_type type, double bus_start_time) const;
+	double get_ready_time(Address const& address, event_type type, double bus_start_time) const;
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
@@ -613,9 +744,21 @@ public:
     	ar & data;
     }
 private:
+	bool start_array_operation(Event& event);
+	void register_array_operation(Event const& event, bool die_was_busy);
+	bool accepts_cache_op(event_type type) const;
 	vector<Plane> data;
 	double currently_executing_io_finish_time;
-	int last_read_io;
+	vector<int> last_read_io; // the application IO whose page is in each plane's page register
+	vector<int> cached_read_io; // the application IO whose page is in each plane's cache register
+	double cache_register_release_time; // when the write waiting in the cache register moves on to the array
+
+	// The array operation the die is executing. Operations on further planes join it as long as their command follows on the channel.
+	event_type multi_plane_op_type;
+	uint multi_plane_op_page;
+	vector<bool> planes_in_multi_plane_op;
+	double multi_plane_op_start_time;
+	double multi_plane_op_last_start_time;
 };
 
 /* The package is the highest level data storage hardware unit.  While the
@@ -625,7 +768,7 @@ private:
 class Package 
 {
 public:
-	Package (long physical_address);
+	Package (Page_State_Arena* arena, long physical_address);
 	Package();
 	~Package () {}
 	enum status read(Event &event);
@@ -633,6 +776,7 @@ public:
 	enum status erase(Event &event);
 	inline Die *get_die(int i) { return &data[i]; }
 	enum status lock(double start_time, double duration, Event &event);
+	static double get_channel_time(event_type type);
 	inline double get_currently_executing_operation_finish_time() { return currently_executing_operation_finish_time; }
     friend class boost::serialization::access;
     template<class Archive>
@@ -645,9 +789,6 @@ private:
 	double currently_executing_operation_finish_time;
 };
 
-extern const int UNDEFINED;
-extern const int INFINITE;
-
 class Page_Hotness_Measurer {
 public:
 //	virtual Page_Hotness_Measurer() = 0;
@@ -871,6 +1012,39 @@ protected:
 	stats normal_stats;
 };
 
+// A mapping of page addresses as a radix table: a directory of leaves, each covering 1024 consecutive keys. A leaf is only
+// allocated when one of its keys is first mapped, and is freed when its last key is unmapped, so a lookup stays a couple of
+// array accesses while memory follows the mapped footprint rather than the size of the address space.
+class Sparse_Map
+{
+public:
+	Sparse_Map(ulong size);
+	Sparse_Map();
+	inline long get(ulong key) const {
+		vector<long> const& leaf = leaves[key >> LEAF_BITS];
+		return leaf.empty() ? UNDEFINED : leaf[key & LEAF_MASK];
+	}
+	void set(ulong key, long value);
+	inline ulong size() const { return num_keys; }
+	inline ulong get_num_allocated_leaves() const { return num_allocated_leaves; }
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+    	ar & leaves;
+    	ar & num_mapped;
+    	ar & num_keys;
+    	ar & num_allocated_leaves;
+    }
+private:
+	static const uint LEAF_BITS = 10;
+	static const ulong LEAF_MASK = (1 << LEAF_BITS) - 1;
+	vector<vector<long> > leaves; // an empty leaf has no mapped keys
+	vector<uint> num_mapped;      // the mapped keys of each leaf
+	ulong num_keys;
+	ulong num_allocated_leaves;
+};
+
 class FtlImpl_Page : public FtlParent
 {
 public:
@@ -896,40 +1070,65 @@ public:
     	ar & physical_to_logical_map;
     }
 private:
-	vector<long> logical_to_physical_map;
-	vector<long> physical_to_logical_map;
+	Sparse_Map logical_to_physical_map;
+	Sparse_Map physical_to_logical_map;
 };
 
 
 
+// The cached mapping table of a flash resident FTL. Entries live in a flat array, so the cache makes no allocation per
+// entry, and are found through an open addressing index of slot numbers. The clean and dirty entries each form a CLOCK,
+// threaded through the slots, so a victim of the wanted kind is found without walking past entries of the other kind.
 class ftl_cache {
 public:
+	ftl_cache();
 	void register_write_arrival(Event const&  app_write);
 	bool register_read_arrival(Event* app_read);
 	void register_write_completion(Event const& app_write);
 	void handle_read_dependency(Event* event);
+	bool prefetch(int key);
 	void clear_clean_entries(double time);
 	int choose_dirty_victim(double time);
 	int get_num_dirty_entries() const;
+	uint get_num_dirty_entries_on(long translation_page_id) const;
 	bool mark_clean(int key, double time);
 	int erase_victim(double time, bool allow_flushing_dirty);
 	bool contains(int key) const;
+	bool is_synchronized(int key) const;
 	void set_synchronized(int key);
+	inline uint size() const { return num_entries; }
 	static int CACHED_ENTRIES_THRESHOLD;
 
 	struct entry {
-		entry() : dirty(false), synch_flag(false), fixed(false), hotness(0), timestamp(numeric_limits<double>::infinity()) {}
+		entry() : key(UNDEFINED), dirty(false), synch_flag(false), fixed(false), hotness(0), timestamp(numeric_limits<double>::infinity()), prev(UNDEFINED), next(UNDEFINED) {}
+		long key;  // UNDEFINED if the slot is free
 		bool dirty;
 		bool synch_flag;
 		int fixed;
 		short hotness;
 		double timestamp; // when was the entry added to the cache
+		int prev, next;   // neighbouring slots in the CLOCK of clean or dirty entries
 	};
-	unordered_map<long, entry> cached_mapping_table; // maps logical addresses to physical addresses
-	queue<long> eviction_queue_dirty;
-	queue<long> eviction_queue_clean;
+	inline vector<entry> const& get_entries() const { return entries; }
 private:
-	void iterate(long& victim_key, entry& victim_entry, bool allow_choosing_dirty);
+	int find_slot(long key) const;
+	int insert(long key, bool dirty);
+	void erase(int slot);
+	void set_dirty(int slot, bool dirty);
+	void link(int slot);
+	void unlink(int slot);
+	int find_victim(bool dirty);
+	void grow();
+	void count_dirty_entry(long key, int change);
+	inline uint hash(long key) const { return (ulong(key) * 11400714819323198485ull) >> (64 - index_bits); }
+	vector<entry> entries;
+	vector<int> free_slots;
+	vector<int> index;     // slots of the entries, by hash of the key with linear probing. UNDEFINED marks an empty bucket
+	uint index_bits;
+	uint num_entries;
+	uint num_dirty;
+	int hands[2];          // the next slot the CLOCK of clean (0) and dirty (1) entries looks at
+	vector<uint> num_dirty_per_translation_page; // indexed by translation page id
 };
 
 class flash_resident_page_ftl : public FtlParent {
@@ -960,6 +1159,7 @@ public:
 	void register_write_completion(Event const& event, enum status result);
 	void register_read_completion(Event const& event, enum status result);
 	void register_trim_completion(Event & event);
+	void register_erase_completion(Event & event);
 	long get_logical_address(uint physical_address) const;
 	Address get_physical_address(uint logical_address) const;
 	void set_replace_address(Event& event) const;
@@ -968,23 +1168,53 @@ public:
 	void print_short() const;
 	static int ENTRIES_PER_TRANSLATION_PAGE;
 	static bool SEPERATE_MAPPING_PAGES;
+	static int MAX_PREFETCH_DEPTH; // the most neighbouring entries cached along with a missing one
 
 private:
 	void notify_garbage_collector(int translation_page_id, double time);
+	void flush_gc_mapping_updates(double time);
+	void plan_prefetch(long logical_address);
+	void prefetch(long translation_page_id);
 	//bool flush_mapping(double time, bool allow_flushing_dirty);
 	//void iterate(long& victim_key, ftl_cache::entry& victim_entry, bool allow_choosing_dirty);
 	void create_mapping_read(long translation_page_id, double time, Event* dependant);
+	void create_mapping_write(long translation_page_id, double time);
 	void mark_clean(long translation_page_id, Event const& event);
 	void try_clear_space_in_mapping_cache(double time);
 	set<long> ongoing_mapping_operations; // contains the logical addresses of ongoing mapping IOs
 	unordered_map<long, vector<Event*> > application_ios_waiting_for_translation; // maps translation page ids to application IOs awaiting translation
+	set<long> translation_pages_updated_by_gc; // ids of the translation pages with mapping updates from the GC operations that are under way
+	unordered_map<long, pair<long, long> > prefetch_ranges; // maps translation page ids being read to the first and last logical address to prefetch from them
+	int prefetch_depth;
+	long last_prefetched_address;
+	// The contents of a translation page on flash, as physical page numbers indexed by the offset of the logical address in
+	// the page, and a bitmap of which of them are mapped. The arrays are only allocated once the page maps an address.
 	struct mapping_page {
-		map<int, Address> entries;
+		mapping_page() : physical_addresses(), valid() {}
+		inline Address get(int offset) const { return !valid.empty() && valid[offset] ? Address(physical_addresses[offset], PAGE) : Address(); }
+		inline void set(int offset, Address const& a) {
+			if (valid.empty()) {
+				if (a.valid != PAGE) {
+					return;
+				}
+				physical_addresses.resize(ENTRIES_PER_TRANSLATION_PAGE, 0);
+				valid.resize(ENTRIES_PER_TRANSLATION_PAGE, false);
+			}
+			valid[offset] = a.valid == PAGE;
+			physical_addresses[offset] = valid[offset] ? a.get_linear_address() : 0;
+		}
+		vector<uint> physical_addresses;
+		vector<bool> valid;
 	};
 	vector<mapping_page> mapping_pages;
 	struct dftl_statistics {
+		dftl_statistics() : cleans_histogram(), address_hits(), num_gc_mapping_updates(0), num_gc_mapping_writes(0), num_read_misses(0), num_prefetched_entries(0) {}
 		map<int, int> cleans_histogram;
 		map<int, int> address_hits;
+		long num_gc_mapping_updates;
+		long num_gc_mapping_writes;
+		long num_read_misses;
+		long num_prefetched_entries;
 	};
 	dftl_statistics dftl_stats;
 };
@@ -1067,10 +1297,128 @@ private:
 	map<long, queue<Event*> > logical_dependencies;  // a locking table with page granularity
 };
 
+/* The interface through which the operating system submits IOs to storage.
+ * A storage device is either a single Ssd, or a composite device, such as a RaidSsd,
+ * that forwards IOs to several Ssd instances. Completed application IOs are returned
+ * to the parent device if there is one, and otherwise to the operating system. */
+class Storage_Device
+{
+public:
+	Storage_Device() : os(NULL), parent(NULL) {}
+	virtual ~Storage_Device() {}
+	virtual void submit(Event* event) = 0;
+	virtual void register_event_completion(Event * event) = 0;
+	virtual void progress_since_os_is_waiting() = 0;
+	virtual void execute_all_remaining_events() = 0;
+	// true if the device has pending events, or completed IOs it has not returned yet
+	virtual bool is_busy() = 0;
+	// the time of the soonest event the device will process when it is next given a chance to progress
+	virtual double get_next_event_time() = 0;
+	virtual void print_statistics() {}
+	// the number of logical pages the device exposes to its host
+	virtual long get_num_logical_pages() const = 0;
+	// the FTL of a device made of one SSD, or NULL if the device is made of several
+	virtual FtlParent* get_ftl() const { return NULL; }
+	void set_operating_system(OperatingSystem* new_os) { os = new_os; }
+	void set_parent_device(Storage_Device* device) { parent = device; }
+protected:
+	void return_completed_event(Event* event);
+	inline bool has_host() const { return os != NULL || parent != NULL; }
+	OperatingSystem* os;
+	Storage_Device* parent;
+};
+
+/* The DRAM write-back buffer of the SSD controller. It holds the pages of host writes that have not reached flash yet.
+ * A host write completes once its page is in the buffer, and overwrites the page if it is already there.
+ * Reads of pages in the buffer are served from it. Once the buffer fills up to WRITE_BUFFER_HIGH_WATERMARK,
+ * the oldest dirty pages are written to flash until it is down to WRITE_BUFFER_LOW_WATERMARK. Pages are written in batches
+ * of one page per plane for each die that is idle, or one page per idle die while garbage-collection is going on, so
+ * the flushes do not queue up behind reads. When host writes wait for room, up to one page per plane of every die is
+ * written regardless. A page is only written by one flush at a time. When the buffer is full, host writes wait for room. */
+class Write_Buffer
+{
+public:
+	Write_Buffer(Ssd* ssd, Migrator* migrator);
+	~Write_Buffer();
+	bool submit(Event* event);
+	bool register_flush_completion(Event* event);
+	void print_statistics() const;
+private:
+	struct page {
+		page() : dirty(false), being_flushed(false), position() {}
+		bool dirty;
+		bool being_flushed;
+		list<long>::iterator position; // in dirty_pages, if the page is dirty and not being flushed
+	};
+	void write(Event* event, double time);
+	void trim(long la);
+	void park(Event* event);
+	void admit_waiting_writes(double time);
+	void flush(double time);
+	uint get_max_flushes_in_flight(double time) const;
+	Ssd* ssd;
+	Migrator* migrator;
+	unordered_map<long, page> pages;
+	list<long> dirty_pages; // oldest first
+	queue<Event*> waiting_writes; // host writes waiting for room, and the trims behind them
+	unordered_map<long, uint> waiting_pages; // logical address -> number of waiting writes and trims of it
+	unordered_map<uint, long> flushes_in_flight; // application IO id of the flush -> logical address
+	bool flushing;
+	long num_writes, num_absorbed_writes, num_waiting_writes, num_read_hits, num_flushes;
+};
+
+/* The DRAM read cache of the SSD controller. It holds the pages of recent flash reads, and serves reads of these pages.
+ * READ_CACHE_POLICY picks the pages to keep: 0 is LRU, 1 is 2Q, and 2 is ARC. Host writes and trims invalidate
+ * the pages they overwrite. When the host reads sequentially, the cache reads the next READ_CACHE_READAHEAD pages ahead,
+ * but only from dies that are idle, so that readahead does not delay other IOs. */
+class Read_Cache
+{
+public:
+	Read_Cache(Ssd* ssd);
+	bool submit(Event* event);
+	bool register_read_completion(Event* event);
+	void print_statistics() const;
+private:
+	enum queue_id { RECENT, FREQUENT, RECENT_GHOSTS, FREQUENT_GHOSTS };
+	struct entry {
+		entry() : queue(RECENT), position(), prefetched(false) {}
+		queue_id queue;
+		list<long>::iterator position; // in queues[queue]
+		bool prefetched; // read ahead, and not read by the host yet
+	};
+	struct read_ahead_io {
+		read_ahead_io() : logical_address(UNDEFINED), waiting() {}
+		long logical_address;
+		vector<Event*> waiting; // host reads of the page, served when the read ahead finishes
+	};
+	void access(long la, entry& e);
+	void insert(long la, bool prefetched);
+	void invalidate(long la);
+	void replace(bool in_frequent_ghosts);
+	void evict(queue_id from, queue_id to);
+	void push(long la, entry& e, queue_id queue);
+	void move(long la, entry& e, queue_id queue);
+	void remove(long la);
+	void read_ahead(long la, double time);
+	void complete(Event* event, double time);
+	void resubmit(Event* event, double time);
+	inline bool is_cached(entry const& e) const { return e.queue == RECENT || e.queue == FREQUENT; }
+	inline uint num_cached_pages() const { return queues[RECENT].size() + queues[FREQUENT].size(); }
+	Ssd* ssd;
+	unordered_map<long, entry> entries; // cached pages, and the ghosts of evicted pages kept by 2Q and ARC
+	list<long> queues[4]; // least recently used first
+	double target_recent_size; // ARC's target size of the RECENT queue
+	unordered_set<long> reads_in_flight; // flash reads whose page will be cached, unless it is overwritten first
+	unordered_map<uint, read_ahead_io> read_aheads_in_flight; // application IO id of the read -> the read ahead
+	unordered_map<long, uint> pages_being_read_ahead; // logical address -> application IO id of its read ahead, until the page is overwritten
+	long last_read;
+	long num_hits, num_misses, num_read_aheads, num_read_ahead_hits, num_unused_read_aheads;
+};
+
 /* The SSD is the single main object that will be created to simulate a real
  * SSD.  Creating a SSD causes all other objects in the SSD to be created.  The
  * event_arrive method is where events will arrive from DiskSim. */
-class Ssd
+class Ssd : public Storage_Device
 {
 public:
 	Ssd ();
@@ -1080,16 +1428,26 @@ public:
 	void event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
 	void progress_since_os_is_waiting();
 	void register_event_completion(Event * event);
+	bool is_busy();
+	double get_next_event_time();
 	void *get_result_buffer();
 	inline Package* get_package(int i) { return &data[i]; }
-	void set_operating_system(OperatingSystem* os);
 	FtlParent* get_ftl() const;
 	enum status issue(Event *event);
 	double get_currently_executing_operation_finish_time(int package);
+	inline double get_last_io_submission_time() const { return last_io_submission_time; }
+	void print_statistics();
+	inline long get_num_logical_pages() const { return num_logical_pages; }
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version)
     {
+    	if (Archive::is_loading::value) {
+    		// The loaded arena replaces the one the constructor built
+    		delete page_states;
+    		page_states = NULL;
+    	}
+    	ar & page_states;
     	ar & data;
     	ar & ftl;
     	ar & os;
@@ -1098,49 +1456,288 @@ public:
     IOScheduler* get_scheduler() { return scheduler; }
     void execute_all_remaining_events();
 private:
+    friend class Write_Buffer;
+    friend class Read_Cache;
     void submit_to_ftl(Event* event);
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
 	Package &get_data();
+	Page_State_Arena* page_states;
 	vector<Package> data;
+	long num_logical_pages;
 	double last_io_submission_time;
-	OperatingSystem* os;
 	FtlParent *ftl;
 	IOScheduler *scheduler;
-
-	struct io_map {
-		void resiger_large_event(Event* e);
-		void register_completion(Event* e);
-		bool is_part_of_large_event(Event* e);
-		bool is_finished(int id) const;
-		Event* get_original_event(int id);
-	private:
-		map<int, int> io_counter;
-		map<int, Event*> event_map;
+	Write_Buffer* write_buffer;
+	Read_Cache* read_cache;
+
+	// An application IO that spans several pages. Its pages are issued one at a time as single page IOs, and the IO
+	// completes once all of them have. The pages carry the index of the IO in large_ios as their ssd id. The events of
+	// finished pages are reused for the next pages, so no more of them are allocated than fit in the window.
+	struct large_io {
+		large_io() : parent(NULL), num_issued(0), num_completed(0), finish_time(0) {}
+		Event* parent;
+		uint num_issued;
+		uint num_completed;
+		double finish_time;
 	};
-	io_map large_events_map;
+	void issue_pages_of_large_ios(double time);
+	vector<large_io> large_ios;
+	vector<int> free_large_io_slots;
+	queue<int> large_ios_with_unissued_pages;
+	vector<Event*> free_large_io_pages;
+	uint num_large_io_pages_in_flight;
+	uint max_large_io_pages_in_flight;
 
 };
 
-class RaidSsd
+/* A RAID array built out of RAID_NUM_DEVICES independent Ssd instances that are driven from one event loop.
+ * The array exposes the logical address space of all its data columns (see get_num_logical_pages), so its
+ * devices fill up as the drives of a real array do, and lays it out in chunks of RAID_CHUNK_SIZE pages over the devices
+ * according to RAID_LEVEL:
+ * 0  -> striping
+ * 1  -> mirroring across all devices
+ * 5  -> striping with rotating parity. Partial stripe writes do a read-modify-write of the data and parity.
+ * 10 -> striping across mirrored pairs of devices
+ * An application IO completes when all the device IOs it was broken into complete, so a device that is
+ * garbage-collecting stalls the whole stripe. If RAID_GC_AWARE_READS is set, reads that target a LUN that is
+ * being garbage-collected are served from a mirror, or reconstructed from the rest of the stripe and its parity. */
+class RaidSsd : public Storage_Device
 {
 public:
-	RaidSsd (uint ssd_size = SSD_SIZE);
+	RaidSsd();
 	~RaidSsd();
-	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time);
-	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
-	void *get_result_buffer();
+	void submit(Event* event);
+	void register_event_completion(Event * event);
+	void progress_since_os_is_waiting();
+	void execute_all_remaining_events();
+	bool is_busy();
+	double get_next_event_time();
 	void print_statistics();
-	void reset_statistics();
-	void write_statistics(FILE *stream);
-	void write_header(FILE *stream);
+	long get_num_logical_pages() const;
+	inline Ssd* get_device(int i) { return devices[i]; }
+	inline int get_num_devices() const { return devices.size(); }
+	static int get_num_columns();
+private:
+	// The place where a page of the array is stored on one of the devices
+	struct location {
+		location(int device, long logical_address) : device(device), logical_address(logical_address) {}
+		int device;
+		long logical_address;
+	};
+	// An application IO and the state of the device IOs it was broken into
+	struct host_io {
+		host_io() : event(NULL), num_pending(0), finish_time(0), slowest_device(UNDEFINED), slowest_event_type(NOT_VALID), slowest_address(), noop(true), deferred_writes() {}
+		Event* event;
+		int num_pending;
+		double finish_time;
+		int slowest_device;
+		event_type slowest_event_type;
+		Address slowest_address;
+		bool noop;
+		vector<location> deferred_writes;	// the writes of a read-modify-write, submitted once the old data and parity are read
+	};
+	vector<location> get_data_locations(long logical_address) const;
+	location get_parity_location(long logical_address) const;
+	long get_stripe(long logical_address) const;
+	int choose_replica(vector<location> const& replicas) const;
+	bool is_written(location const& loc) const;
+	bool is_garbage_collecting(location const& loc) const;
+	void submit_read(host_io& io, long logical_address);
+	void submit_parity_write(host_io& io, Event* event);
+	void submit_deferred_writes(host_io& io, double time);
+	void submit_to_device(host_io& io, location const& loc, event_type type, double time);
+	void finish(host_io& io);
+
+	vector<Ssd*> devices;
+	int num_columns;	// the number of chunks of data in a stripe
+	unordered_map<uint, host_io> host_ios;
+	unordered_map<uint, pair<uint, int> > device_io_to_host_io;	// maps a device IO to its application IO and device
+	vector<int> num_pending_per_device;
+
+	struct stats {
+		stats(int num_devices);
+		void register_completion(host_io const& io, double latency);
+		void print() const;
+		vector<double> read_latencies;
+		vector<double> write_latencies;
+		vector<long> num_ios_per_device;
+		vector<long> num_times_slowest_per_device;
+		long num_full_stripe_writes;
+		long num_read_modify_writes;
+		long num_reconstructed_reads;
+		long num_redirected_reads;
+	};
+	stats stats;
+};
+
+/* A snapshot of the configuration variables that describe one SSD: its architecture, its timings and the policies of its controller.
+ * Devices that are built out of differently configured SSDs apply the snapshot of an SSD before calling into it. */
+class Device_Config
+{
+public:
+	static Device_Config get_current();
+	void apply() const;
+	uint SSD_SIZE, PACKAGE_SIZE, DIE_SIZE, PLANE_SIZE, BLOCK_SIZE;
+	double BUS_CTRL_DELAY, BUS_DATA_DELAY, PAGE_READ_DELAY, PAGE_WRITE_DELAY, BLOCK_ERASE_DELAY;
+	double OVER_PROVISIONING_FACTOR;
+	int FTL_DESIGN, BLOCK_MANAGER_ID, GARBAGE_COLLECTION_POLICY, GREED_SCALE, MAX_CONCURRENT_GC_OPS, SCHEDULING_SCHEME;
+	int WRITE_DEADLINE, READ_DEADLINE, READ_TRANSFER_DEADLINE;
+	uint MAX_REPEATED_COPY_BACKS_ALLOWED;
+	bool ALLOW_DEFERRING_TRANSFERS, USE_ERASE_QUEUE, ENABLE_WEAR_LEVELING, IS_FTL_PAGE_MAPPING;
+};
+
+/* Decides which page the cache tier of a Tiered_Ssd evicts to make room for a new page */
+class Tier_Replacement_Policy
+{
+public:
+	virtual ~Tier_Replacement_Policy() {}
+	virtual void insert(long logical_address) = 0;
+	virtual void register_hit(long logical_address) = 0;
+	virtual void remove(long logical_address) = 0;
+	// Returns the page to evict out of the pages that can_evict accepts, or UNDEFINED if there is none
+	virtual long choose_victim(std::function<bool(long)> can_evict) const = 0;
+};
+
+class LRU_Tier_Replacement : public Tier_Replacement_Policy
+{
+public:
+	void insert(long logical_address);
+	void register_hit(long logical_address);
+	void remove(long logical_address);
+	long choose_victim(std::function<bool(long)> can_evict) const;
+private:
+	list<long> order;	// most recently used first
+	unordered_map<long, list<long>::iterator> positions;
+};
 
-	void print_ftl_statistics();
+/* Adaptive Replacement Cache. Pages seen once (T1) and pages seen at least twice (T2) are kept in separate LRU lists,
+ * and the recently evicted pages of each list are remembered (B1, B2). A miss on a remembered page shifts the
+ * target size of T1 towards the list that would have kept it. */
+class ARC_Tier_Replacement : public Tier_Replacement_Policy
+{
+public:
+	ARC_Tier_Replacement(long capacity);
+	void insert(long logical_address);
+	void register_hit(long logical_address);
+	void remove(long logical_address);
+	long choose_victim(std::function<bool(long)> can_evict) const;
 private:
-	uint size;
-	Ssd *Ssds;
+	struct lru_list {
+		void push(long logical_address);
+		void erase(long logical_address);
+		inline bool contains(long logical_address) const { return positions.count(logical_address) == 1; }
+		inline long size() const { return order.size(); }
+		long scan(std::function<bool(long)> can_evict) const;
+		list<long> order;	// most recently used first
+		unordered_map<long, list<long>::iterator> positions;
+	};
+	long capacity;
+	double target_t1_size;
+	lru_list t1, t2, b1, b2;
+};
+
+/* A two-tier device: a small and fast SSD serves as a write-back cache in front of a large capacity SSD.
+ * Each tier is an independent Ssd with its own configuration. The capacity tier uses the global configuration,
+ * and the cache tier uses the configuration given to set_cache_tier_config. Whenever we call into a tier, its configuration
+ * and statistics are swapped into the globals. The device exposes the logical address space of the capacity tier.
+ * TIER_ADMISSION_POLICY decides which pages enter the cache, and TIER_EVICTION_POLICY which clean page leaves it.
+ * Dirty pages are destaged to the capacity tier once they exceed TIER_DESTAGE_HIGH_WATERMARK of the cache,
+ * and admitted pages are promoted on read misses. This background traffic competes with application IOs in both tiers. */
+class Tiered_Ssd : public Storage_Device
+{
+public:
+	enum tier {CACHE_TIER, CAPACITY_TIER};
+	Tiered_Ssd();
+	~Tiered_Ssd();
+	void submit(Event* event);
+	void register_event_completion(Event * event);
+	void progress_since_os_is_waiting();
+	void execute_all_remaining_events();
+	bool is_busy();
+	double get_next_event_time();
+	void print_statistics();
+	// the host sees the logical space of the capacity tier
+	inline long get_num_logical_pages() const { return tiers[CAPACITY_TIER]->get_num_logical_pages(); }
+	inline Ssd* get_tier(tier t) { return tiers[t]; }
+	static void set_cache_tier_config(Device_Config const& config);
+private:
+	enum io_purpose {FOREGROUND, PROMOTION, DESTAGE_READ, DESTAGE_WRITE};
+	struct cache_entry {
+		cache_entry() : slot(UNDEFINED), dirty(false), destaging(false), promoting(false), version(0), allocated_version(0) {}
+		long slot;	// the logical address in the cache tier holding the page
+		bool dirty;
+		bool destaging;
+		bool promoting;	// a clean page on its way to the cache tier, which must not be evicted yet
+		long version;	// changes on every write, so a destage only cleans the version it copied
+		long allocated_version;	// the version when the page got its slot. Writes of older versions were for an earlier owner of the slot.
+	};
+	// An application IO and the state of the tier IOs it was broken into
+	struct host_io {
+		host_io() : event(NULL), num_pending(0), finish_time(0), address(), noop(true), hit(true), cache_write(true) {}
+		Event* event;
+		int num_pending;
+		double finish_time;
+		Address address;	// the physical address of the slowest capacity tier IO
+		bool noop;
+		bool hit;			// a read served only by the cache tier
+		bool cache_write;	// a write absorbed only by the cache tier
+	};
+	struct tier_io {
+		tier_io() : host_io_id(UNDEFINED), t(CAPACITY_TIER), purpose(FOREGROUND), logical_address(UNDEFINED), version(0) {}
+		tier_io(uint host_io_id, tier t, io_purpose purpose, long logical_address, long version)
+			: host_io_id(host_io_id), t(t), purpose(purpose), logical_address(logical_address), version(version) {}
+		uint host_io_id;
+		tier t;
+		io_purpose purpose;
+		long logical_address;	// in the address space exposed by this device
+		long version;
+	};
+	void switch_to(tier t);
+	void submit_to_tier(tier_io const& io, event_type type, double time);
+	void submit_page(host_io& io, event_type type, long logical_address, double time);
+	void submit_read(host_io& io, long logical_address, double time);
+	bool should_admit(long logical_address) const;
+	bool allocate(long logical_address);
+	void mark_dirty(cache_entry& entry, long logical_address);
+	void destage(double time);
+	void finish(host_io& io);
+
+	static Device_Config cache_tier_config;
+	static bool cache_tier_config_set;
+	vector<Ssd*> tiers;
+	vector<Device_Config> configs;
+	vector<StatisticsGatherer*> tier_statistics;
+	tier current_tier;
+
+	Tier_Replacement_Policy* replacement_policy;
+	unordered_map<long, cache_entry> cache;
+	vector<long> free_slots;
+	long num_slots;
+	long num_dirty;
+	deque<long> dirty_pages;	// in the order they became dirty. May contain pages that have since been cleaned or evicted.
+	unordered_map<long, uint> access_counts;
+	vector<bool> slot_written;
+	unordered_map<long, vector<tier_io> > reads_waiting_for_slot;
+	long version_generator;
+	bool destaging;
+	uint num_ongoing_destages;
+	unordered_map<uint, host_io> host_ios;
+	unordered_map<uint, tier_io> tier_ios;
 
+	struct stats {
+		stats();
+		void print() const;
+		long num_read_hits, num_read_misses;
+		long num_cache_writes, num_bypassed_writes;
+		long num_promotions, num_evictions, num_destaged_pages;
+		double first_destage_time, last_destage_time;
+		vector<double> read_hit_latencies, read_miss_latencies;
+		vector<double> cache_write_latencies, bypassed_write_latencies;
+		vector<vector<double> > read_latencies, write_latencies;	// of all IOs of each tier
+	};
+	stats stats;
 };
 
 class VisualTracer
@@ -1248,7 +1845,9 @@ class StatisticsGatherer
 {
 public:
 	static StatisticsGatherer *get_global_instance();
+	static void set_global_instance(StatisticsGatherer* instance) { inst = instance; }
 	static void init();
+	static void print_latency_distribution(string name, vector<double> latencies);
 
 	StatisticsGatherer();
 	~StatisticsGatherer();
@@ -1257,10 +1856,19 @@ public:
 	void register_scheduled_gc(Event const& gc);
 	void register_executed_gc(Block const& victim);
 	void register_events_queue_length(uint queue_size, double time);
+	// Records an application IO of a thread that belongs to a tenant, as the host sees it
+	void register_tenant_completion(int tenant, Event const& event);
+	// Records an application IO of any thread, as the host sees it
+	void register_host_completion(Event const& event);
+	double get_host_iops() const { return host_stats.get_iops(); }
+	double get_host_avg_latency() const;
+	double get_host_latency_percentile(double percentile) const;
 	void print() const;
+	void print_tenant_statistics() const;
 	void print_simple(FILE* file = stdout);
 	void print_gc_info();
 	void print_mapping_info();
+	void print_controller_ram_info();
 	void print_csv();
 	inline double get_wait_time_histogram_bin_size() { return wait_time_histogram_bin_size; }
 
@@ -1305,6 +1913,10 @@ private:
 	vector<vector<uint> > num_mapping_reads_per_LUN;
 	vector<vector<uint> > num_mapping_writes_per_LUN;
 
+	vector<vector<uint> > num_buffer_flush_writes_per_LUN;
+	uint num_writes_served_from_ram;
+	uint num_reads_served_from_ram;
+
 	vector<vector<vector<double> > > bus_wait_time_for_writes_per_LUN;
 
 
@@ -1357,6 +1969,21 @@ private:
 	vector<vector<uint> > num_wl_writes_per_LUN_destination;
 
 	double end_time;
+
+	struct host_io_statistics {
+		host_io_statistics() : num_reads(0), num_writes(0), num_pages(0), first_start_time(-1), last_completion_time(0), read_latencies(), write_latencies() {}
+		void add(Event const& event);
+		double get_iops() const;
+		long num_reads;
+		long num_writes;
+		long num_pages;
+		double first_start_time;
+		double last_completion_time;
+		vector<double> read_latencies;
+		vector<double> write_latencies;
+	};
+	map<int, host_io_statistics> tenant_stats;
+	host_io_statistics host_stats;
 	static bool record_statistics;
 };
 
@@ -1370,11 +1997,16 @@ public:
 	static double get_avg_LUN_utilization();
 	static double get_channel_utilization(int package_id);
 	static double get_LUN_utilization(int lun_id);
+	static void register_host_link_transfer(int direction, double start_time, double duration);
+	static double get_host_link_utilization(int direction);
 private:
 	static vector<double> channel_used;
 	static vector<double> LUNs_used;
 	static vector<double> channel_unused;
 	static vector<double> LUNs_unused;
+	static vector<double> host_link_used;
+	static double host_link_first_use;
+	static double host_link_last_use;
 };
 
 // Keeps track of the fraction of the time in which there is free space in LUNs for writes
@@ -1473,9 +2105,9 @@ public:
 class Workload_Definition {
 public:
 	Workload_Definition();
-	void recalculate_lba_range();
+	void recalculate_lba_range(OperatingSystem* os);
 	virtual ~Workload_Definition() {};
-	vector<Thread*> generate_instance();
+	vector<Thread*> generate_instance(OperatingSystem* os);
 	virtual vector<Thread*> generate() = 0;
 	void set_lba_range(long min, long max) {min_lba = min; max_lba = max;}
 protected:
@@ -1524,6 +2156,43 @@ private:
 	double writes_probability;
 };
 
+// An open-loop thread performing random reads and writes across the logical address space, with Poisson arrivals.
+// It does not write the logical address space first, so it should run on top of a calibrated SSD state.
+class Open_Loop_Workload : public Workload_Definition {
+public:
+	Open_Loop_Workload(double arrival_rate, double writes_probability = 0.5);
+	vector<Thread*> generate();
+	double* get_arrival_rate() { return &arrival_rate; }
+private:
+	double arrival_rate; // IOs per second
+	double writes_probability;
+};
+
+// Describes threads in a fio-style job file, so that workloads can be changed without recompiling.
+// Each [section] is a job, and the options of a [global] section apply to all jobs that follow it.
+//   rw = read | write | trim | randread | randwrite | randtrim | rw | randrw
+//   rwmixread, rwmixwrite = percentage of reads or writes in a mixed job (50 by default)
+//   bs = IO size in pages, or bssplit = size/percentage:size/percentage:...
+//   iodepth = IOs the job keeps outstanding, numjobs = copies of the job
+//   offset, size = part of the logical address space, in pages or as a percentage ending with %
+//   random_distribution = random | zipf:theta | pareto:shape | normal:deviation% | zoned:access%/space%:...
+//     (zoned:80/20 sends 80% of the accesses to the first 20% of the addresses, and the rest to the rest)
+//   thinktime = microseconds between a completion and the next IO
+//   rate_iops = issue IOs open loop with Poisson arrivals at this rate, no matter how many are outstanding
+//   number_ios = IOs per copy of the job, randseed = seed of the job, wait_for = a job to start after
+class Job_File_Workload : public Workload_Definition {
+public:
+	Job_File_Workload(string file_name);
+	vector<Thread*> generate();
+private:
+	typedef map<string, string> job_options;
+	Thread* create_thread(string const& job_name, job_options const& options, int copy);
+	static string get_option(job_options const& options, string name, string default_value);
+	long get_address(job_options const& options, string name, long default_value) const;
+	string file_name;
+	vector<pair<string, job_options> > jobs;
+};
+
 // This workload starts with a large sequential write of the entire logical address space
 // After that an asynchronous thread performs random writes across the logical address space
 class Init_Workload : public Workload_Definition {
@@ -1568,6 +2237,9 @@ public:
 	void setup(string name);
 	void run(string experiment_name);
 	void run_single_point(string name);
+	// Searches the variable set with set_variable for the offered load at which the SSD saturates
+	void find_knee(string name);
+	void set_knee_criteria(double latency_factor, double min_throughput_gain) { knee_latency_factor = latency_factor; knee_min_throughput_gain = min_throughput_gain; }
 	static vector<Experiment_Result> random_writes_on_the_side_experiment(Workload_Definition* workload, int write_threads_min, int write_threads_max, int write_threads_inc, string name, int IO_limit, double used_space, int random_writes_min_lba, int random_writes_max_lba);
 	static Experiment_Result copyback_experiment(vector<Thread*> (*experiment)(int highest_lba), int used_space, int max_copybacks, string data_folder, string name, int IO_limit);
 	static Experiment_Result copyback_map_experiment(vector<Thread*> (*experiment)(int highest_lba), int cb_map_min, int cb_map_max, int cb_map_inc, int used_space, string data_folder, string name, int IO_limit);
@@ -1608,6 +2280,22 @@ private:
 
 	string alternate_location_for_results_file;
 
+	// A point on the throughput-latency curve
+	struct knee_probe {
+		double load;
+		double throughput;	// IOPS
+		double avg_latency;
+		double p99_latency;
+		bool saturated;
+		bool operator<(knee_probe const& other) const { return load < other.load; }
+	};
+	template <class T> void knee_search(string name, T* variable, T min, T max, T resolution);
+	knee_probe run_knee_probe(string name, string calibration, double load);
+	bool is_saturated(knee_probe const& probe, knee_probe const& below, double latency_limit) const;
+	void write_knee_results(string data_folder, vector<knee_probe> probes, knee_probe const& knee, bool knee_found) const;
+	double knee_latency_factor;		// the SSD is saturated once p99 latency exceeds this multiple of the unloaded p99 latency
+	double knee_min_throughput_gain;	// or once throughput grows by less than this fraction of the relative increase in load
+
 	static void multigraph(int sizeX, int sizeY, string outputFile, vector<string> commands, vector<string> settings = vector<string>(), int x_min = UNDEFINED, int x_max = UNDEFINED, int y_min = UNDEFINED, int y_max = UNDEFINED);
 
 	static uint max_age;
@@ -0,0 +1,656 @@
+/*
+ * tiered_ssd.cpp
+ *
+ *  A small cache SSD in front of a large capacity SSD, driven from the operating system's event loop.
+ */
+
+#include "ssd.h"
+
+using namespace ssd;
+
+// =================  Device_Config  =============================
+
+Device_Config Device_Config::get_current() {
+	Device_Config c;
+	c.SSD_SIZE = ssd::SSD_SIZE;
+	c.PACKAGE_SIZE = ssd::PACKAGE_SIZE;
+	c.DIE_SIZE = ssd::DIE_SIZE;
+	c.PLANE_SIZE = ssd::PLANE_SIZE;
+	c.BLOCK_SIZE = ssd::BLOCK_SIZE;
+	c.BUS_CTRL_DELAY = ssd::BUS_CTRL_DELAY;
+	c.BUS_DATA_DELAY = ssd::BUS_DATA_DELAY;
+	c.PAGE_READ_DELAY = ssd::PAGE_READ_DELAY;
+	c.PAGE_WRITE_DELAY = ssd::PAGE_WRITE_DELAY;
+	c.BLOCK_ERASE_DELAY = ssd::BLOCK_ERASE_DELAY;
+	c.OVER_PROVISIONING_FACTOR = ssd::OVER_PROVISIONING_FACTOR;
+	c.FTL_DESIGN = ssd::FTL_DESIGN;
+	c.BLOCK_MANAGER_ID = ssd::BLOCK_MANAGER_ID;
+	c.GARBAGE_COLLECTION_POLICY = ssd::GARBAGE_COLLECTION_POLICY;
+	c.GREED_SCALE = ssd::GREED_SCALE;
+	c.MAX_CONCURRENT_GC_OPS = ssd::MAX_CONCURRENT_GC_OPS;
+	c.SCHEDULING_SCHEME = ssd::SCHEDULING_SCHEME;
+	c.WRITE_DEADLINE = ssd::WRITE_DEADLINE;
+	c.READ_DEADLINE = ssd::READ_DEADLINE;
+	c.READ_TRANSFER_DEADLINE = ssd::READ_TRANSFER_DEADLINE;
+	c.MAX_REPEATED_COPY_BACKS_ALLOWED = ssd::MAX_REPEATED_COPY_BACKS_ALLOWED;
+	c.ALLOW_DEFERRING_TRANSFERS = ssd::ALLOW_DEFERRING_TRANSFERS;
+	c.USE_ERASE_QUEUE = ssd::USE_ERASE_QUEUE;
+	c.ENABLE_WEAR_LEVELING = ssd::ENABLE_WEAR_LEVELING;
+	c.IS_FTL_PAGE_MAPPING = ssd::IS_FTL_PAGE_MAPPING;
+	return c;
+}
+
+void Device_Config::apply() const {
+	ssd::SSD_SIZE = SSD_SIZE;
+	ssd::PACKAGE_SIZE = PACKAGE_SIZE;
+	ssd::DIE_SIZE = DIE_SIZE;
+	ssd::PLANE_SIZE = PLANE_SIZE;
+	ssd::BLOCK_SIZE = BLOCK_SIZE;
+	ssd::BUS_CTRL_DELAY = BUS_CTRL_DELAY;
+	ssd::BUS_DATA_DELAY = BUS_DATA_DELAY;
+	ssd::PAGE_READ_DELAY = PAGE_READ_DELAY;
+	ssd::PAGE_WRITE_DELAY = PAGE_WRITE_DELAY;
+	ssd::BLOCK_ERASE_DELAY = BLOCK_ERASE_DELAY;
+	ssd::OVER_PROVISIONING_FACTOR = OVER_PROVISIONING_FACTOR;
+	ssd::FTL_DESIGN = FTL_DESIGN;
+	ssd::BLOCK_MANAGER_ID = BLOCK_MANAGER_ID;
+	ssd::GARBAGE_COLLECTION_POLICY = GARBAGE_COLLECTION_POLICY;
+	ssd::GREED_SCALE = GREED_SCALE;
+	ssd::MAX_CONCURRENT_GC_OPS = MAX_CONCURRENT_GC_OPS;
+	ssd::SCHEDULING_SCHEME = SCHEDULING_SCHEME;
+	ssd::WRITE_DEADLINE = WRITE_DEADLINE;
+	ssd::READ_DEADLINE = READ_DEADLINE;
+	ssd::READ_TRANSFER_DEADLINE = READ_TRANSFER_DEADLINE;
+	ssd::MAX_REPEATED_COPY_BACKS_ALLOWED = MAX_REPEATED_COPY_BACKS_ALLOWED;
+	ssd::ALLOW_DEFERRING_TRANSFERS = ALLOW_DEFERRING_TRANSFERS;
+	ssd::USE_ERASE_QUEUE = USE_ERASE_QUEUE;
+	ssd::ENABLE_WEAR_LEVELING = ENABLE_WEAR_LEVELING;
+	ssd::IS_FTL_PAGE_MAPPING = IS_FTL_PAGE_MAPPING;
+}
+
+// =================  Replacement policies  =============================
+
+void LRU_Tier_Replacement::insert(long logical_address) {
+	order.push_front(logical_address);
+	positions[logical_address] = order.begin();
+}
+
+void LRU_Tier_Replacement::register_hit(long logical_address) {
+	remove(logical_address);
+	insert(logical_address);
+}
+
+void LRU_Tier_Replacement::remove(long logical_address) {
+	auto it = positions.find(logical_address);
+	if (it != positions.end()) {
+		order.erase(it->second);
+		positions.erase(it);
+	}
+}
+
+long LRU_Tier_Replacement::choose_victim(std::function<bool(long)> can_evict) const {
+	for (auto it = order.rbegin(); it != order.rend(); it++) {
+		if (can_evict(*it)) {
+			return *it;
+		}
+	}
+	return UNDEFINED;
+}
+
+void ARC_Tier_Replacement::lru_list::push(long logical_address) {
+	order.push_front(logical_address);
+	positions[logical_address] = order.begin();
+}
+
+void ARC_Tier_Replacement::lru_list::erase(long logical_address) {
+	auto it = positions.find(logical_address);
+	if (it != positions.end()) {
+		order.erase(it->second);
+		positions.erase(it);
+	}
+}
+
+long ARC_Tier_Replacement::lru_list::scan(std::function<bool(long)> can_evict) const {
+	for (auto it = order.rbegin(); it != order.rend(); it++) {
+		if (can_evict(*it)) {
+			return *it;
+		}
+	}
+	return UNDEFINED;
+}
+
+ARC_Tier_Replacement::ARC_Tier_Replacement(long capacity)
+	: capacity(capacity),
+	  target_t1_size(0),
+	  t1(), t2(), b1(), b2()
+{}
+
+void ARC_Tier_Replacement::insert(long logical_address) {
+	if (b1.contains(logical_address)) {
+		target_t1_size = min((double)capacity, target_t1_size + max(1.0, (double)b2.size() / b1.size()));
+		b1.erase(logical_address);
+		t2.push(logical_address);
+	}
+	else if (b2.contains(logical_address)) {
+		target_t1_size = max(0.0, target_t1_size - max(1.0, (double)b1.size() / b2.size()));
+		b2.erase(logical_address);
+		t2.push(logical_address);
+	}
+	else {
+		t1.push(logical_address);
+	}
+}
+
+void ARC_Tier_Replacement::register_hit(long logical_address) {
+	t1.erase(logical_address);
+	t2.erase(logical_address);
+	t2.push(logical_address);
+}
+
+// Evicted pages are remembered in the ghost list matching the list they were evicted from
+void ARC_Tier_Replacement::remove(long logical_address) {
+	if (t1.contains(logical_address)) {
+		t1.erase(logical_address);
+		b1.push(logical_address);
+	}
+	else if (t2.contains(logical_address)) {
+		t2.erase(logical_address);
+		b2.push(logical_address);
+	}
+	while (t1.size() + b1.size() > capacity && b1.size() > 0) {
+		b1.erase(b1.order.back());
+	}
+	while (t1.size() + t2.size() + b1.size() + b2.size() > 2 * capacity && b2.size() > 0) {
+		b2.erase(b2.order.back());
+	}
+}
+
+long ARC_Tier_Replacement::choose_victim(std::function<bool(long)> can_evict) const {
+	bool prefer_t1 = t1.size() > 0 && (t1.size() > target_t1_size || t2.size() == 0);
+	lru_list const& first = prefer_t1 ? t1 : t2;
+	lru_list const& second = prefer_t1 ? t2 : t1;
+	long victim = first.scan(can_evict);
+	return victim != UNDEFINED ? victim : second.scan(can_evict);
+}
+
+// =================  Tiered_Ssd  =============================
+
+Device_Config Tiered_Ssd::cache_tier_config = Device_Config();
+bool Tiered_Ssd::cache_tier_config_set = false;
+
+void Tiered_Ssd::set_cache_tier_config(Device_Config const& config) {
+	cache_tier_config = config;
+	cache_tier_config_set = true;
+}
+
+Tiered_Ssd::Tiered_Ssd()
+	: Storage_Device(),
+	  tiers(2, NULL),
+	  configs(2),
+	  tier_statistics(2, NULL),
+	  current_tier(CAPACITY_TIER),
+	  replacement_policy(NULL),
+	  cache(),
+	  free_slots(),
+	  num_slots(0),
+	  num_dirty(0),
+	  dirty_pages(),
+	  access_counts(),
+	  slot_written(),
+	  reads_waiting_for_slot(),
+	  version_generator(0),
+	  destaging(false),
+	  num_ongoing_destages(0),
+	  host_ios(),
+	  tier_ios(),
+	  stats()
+{
+	if (!cache_tier_config_set) {
+		fprintf(stderr, "Error: the configuration of the cache tier must be given to Tiered_Ssd::set_cache_tier_config before creating a tiered device.\n");
+		throw;
+	}
+	if (TIER_DESTAGE_LOW_WATERMARK > TIER_DESTAGE_HIGH_WATERMARK || TIER_MAX_ONGOING_DESTAGES == 0) {
+		fprintf(stderr, "Error: the destage low watermark must not exceed the high watermark, and at least one destage must be allowed at a time.\n");
+		throw;
+	}
+	configs[CAPACITY_TIER] = Device_Config::get_current();
+
+	// The cache tier is created first, so the host ends up with the configuration and statistics of the capacity tier
+	cache_tier_config.apply();
+	tiers[CACHE_TIER] = new Ssd();
+	configs[CACHE_TIER] = Device_Config::get_current();
+	tier_statistics[CACHE_TIER] = StatisticsGatherer::get_global_instance();
+	num_slots = NUMBER_OF_ADDRESSABLE_PAGES() * OVER_PROVISIONING_FACTOR;
+	// Creating an Ssd deletes the global statistics, so we detach the statistics of the cache tier first
+	StatisticsGatherer::set_global_instance(NULL);
+
+	configs[CAPACITY_TIER].apply();
+	tiers[CAPACITY_TIER] = new Ssd();
+	configs[CAPACITY_TIER] = Device_Config::get_current();
+	tier_statistics[CAPACITY_TIER] = StatisticsGatherer::get_global_instance();
+
+	for (auto t : tiers) {
+		t->set_parent_device(this);
+	}
+
+	// The meters indexed by LUN are shared by the tiers, so they must fit the larger one
+	SSD_SIZE = max(configs[CACHE_TIER].SSD_SIZE, configs[CAPACITY_TIER].SSD_SIZE);
+	PACKAGE_SIZE = max(configs[CACHE_TIER].PACKAGE_SIZE, configs[CAPACITY_TIER].PACKAGE_SIZE);
+	Utilization_Meter::init();
+	Free_Space_Per_LUN_Meter::init();
+	configs[CAPACITY_TIER].apply();
+
+	for (long slot = num_slots - 1; slot >= 0; slot--) {
+		free_slots.push_back(slot);
+	}
+	slot_written = vector<bool>(num_slots, false);
+	if (TIER_EVICTION_POLICY == 1) 	replacement_policy = new ARC_Tier_Replacement(num_slots);
+	else 							replacement_policy = new LRU_Tier_Replacement();
+}
+
+Tiered_Ssd::~Tiered_Ssd() {
+	execute_all_remaining_events();
+	switch_to(CACHE_TIER);
+	delete tiers[CACHE_TIER];
+	delete tier_statistics[CACHE_TIER];
+	switch_to(CAPACITY_TIER);
+	delete tiers[CAPACITY_TIER];
+	delete replacement_policy;
+}
+
+// Makes the configuration and statistics of a tier global, since the code of an Ssd reads them from the globals
+void Tiered_Ssd::switch_to(tier t) {
+	if (t == current_tier) {
+		return;
+	}
+	configs[t].apply();
+	StatisticsGatherer::set_global_instance(tier_statistics[t]);
+	current_tier = t;
+}
+
+// =================  Submission  =============================
+
+void Tiered_Ssd::submit(Event* event) {
+	event_type type = event->get_event_type();
+	if (type != READ && type != WRITE && type != TRIM) {
+		fprintf(stderr, "Error: Tiered_Ssd does not support the submitted event type.\n");
+		event->print(stderr);
+		throw;
+	}
+	event->set_original_application_io(true);
+	host_io& io = host_ios[event->get_application_io_id()];
+	io.event = event;
+	double time = event->get_ssd_submission_time();
+	long first = event->get_logical_address();
+	long last = first + event->get_size();
+	for (long lba = first; lba < last; lba++) {
+		submit_page(io, type, lba, time);
+	}
+	destage(time);
+}
+
+void Tiered_Ssd::submit_page(host_io& io, event_type type, long logical_address, double time) {
+	uint id = io.event->get_application_io_id();
+	if (TIER_ADMISSION_POLICY == 1) {
+		access_counts[logical_address]++;
+	}
+	auto it = cache.find(logical_address);
+	bool resident = it != cache.end();
+	if (type == READ && resident) {
+		stats.num_read_hits++;
+		replacement_policy->register_hit(logical_address);
+		submit_read(io, logical_address, time);
+	}
+	else if (type == READ) {
+		stats.num_read_misses++;
+		submit_read(io, logical_address, time);
+	}
+	else if (type == WRITE && (resident || (should_admit(logical_address) && allocate(logical_address)))) {
+		if (resident) {
+			replacement_policy->register_hit(logical_address);
+		}
+		cache_entry& entry = cache[logical_address];
+		mark_dirty(entry, logical_address);
+		stats.num_cache_writes++;
+		submit_to_tier(tier_io(id, CACHE_TIER, FOREGROUND, logical_address, entry.version), WRITE, time);
+	}
+	else if (type == WRITE) {
+		// There is no clean page left to evict, so the write goes straight to the capacity tier
+		stats.num_bypassed_writes++;
+		io.cache_write = false;
+		submit_to_tier(tier_io(id, CAPACITY_TIER, FOREGROUND, logical_address, 0), WRITE, time);
+	}
+	else {
+		// A page may be stored in both tiers, and the capacity tier only knows about pages that were written to it.
+		// A page being destaged may reach the capacity tier after the trim, so it is trimmed there too.
+		bool in_capacity_tier = tiers[CAPACITY_TIER]->get_ftl()->get_physical_address(logical_address).valid != NONE
+				|| (resident && it->second.destaging);
+		bool in_cache_tier = resident && slot_written[it->second.slot];
+		if (in_cache_tier) {
+			submit_to_tier(tier_io(id, CACHE_TIER, FOREGROUND, logical_address, 0), TRIM, time);
+		}
+		if (resident) {
+			if (it->second.dirty) num_dirty--;
+			free_slots.push_back(it->second.slot);
+			replacement_policy->remove(logical_address);
+			cache.erase(it);
+		}
+		if (in_capacity_tier || !in_cache_tier) {
+			submit_to_tier(tier_io(id, CAPACITY_TIER, FOREGROUND, logical_address, 0), TRIM, time);
+		}
+	}
+}
+
+void Tiered_Ssd::submit_read(host_io& io, long logical_address, double time) {
+	uint id = io.event->get_application_io_id();
+	auto it = cache.find(logical_address);
+	if (it == cache.end()) {
+		io.hit = false;
+		submit_to_tier(tier_io(id, CAPACITY_TIER, FOREGROUND, logical_address, 0), READ, time);
+	}
+	else if (slot_written[it->second.slot]) {
+		submit_to_tier(tier_io(id, CACHE_TIER, FOREGROUND, logical_address, 0), READ, time);
+	}
+	else {
+		// The cache tier cannot read a slot before it is first written, so the read waits for the write
+		io.num_pending++;
+		reads_waiting_for_slot[it->second.slot].push_back(tier_io(id, CACHE_TIER, FOREGROUND, logical_address, 0));
+	}
+}
+
+bool Tiered_Ssd::should_admit(long logical_address) const {
+	if (TIER_ADMISSION_POLICY == 1) {
+		auto it = access_counts.find(logical_address);
+		return it != access_counts.end() && it->second >= TIER_ADMISSION_THRESHOLD;
+	}
+	return true;
+}
+
+// Finds a slot in the cache tier for a page, evicting a clean page if needed. Returns false if there is no room.
+bool Tiered_Ssd::allocate(long logical_address) {
+	if (free_slots.empty()) {
+		unordered_map<long, cache_entry> const& entries = cache;
+		long victim = replacement_policy->choose_victim([&entries](long lba) { return !entries.at(lba).dirty && !entries.at(lba).promoting; });
+		if (victim == UNDEFINED) {
+			return false;
+		}
+		free_slots.push_back(cache.at(victim).slot);
+		replacement_policy->remove(victim);
+		cache.erase(victim);
+		stats.num_evictions++;
+	}
+	cache_entry entry;
+	entry.slot = free_slots.back();
+	free_slots.pop_back();
+	// The slot may still hold the trimmed or evicted page of its last owner, which the new owner must not read
+	slot_written[entry.slot] = false;
+	entry.version = entry.allocated_version = ++version_generator;
+	cache[logical_address] = entry;
+	replacement_policy->insert(logical_address);
+	return true;
+}
+
+void Tiered_Ssd::mark_dirty(cache_entry& entry, long logical_address) {
+	if (!entry.dirty) {
+		entry.dirty = true;
+		num_dirty++;
+		dirty_pages.push_back(logical_address);
+	}
+	entry.version = ++version_generator;
+}
+
+// Copies the oldest dirty pages to the capacity tier once they pass the high watermark, until they are below the low watermark
+void Tiered_Ssd::destage(double time) {
+	if (num_dirty >= TIER_DESTAGE_HIGH_WATERMARK * num_slots) {
+		destaging = true;
+	}
+	while (destaging && num_ongoing_destages < TIER_MAX_ONGOING_DESTAGES && !dirty_pages.empty()) {
+		if (num_dirty <= TIER_DESTAGE_LOW_WATERMARK * num_slots) {
+			destaging = false;
+			break;
+		}
+		long lba = dirty_pages.front();
+		dirty_pages.pop_front();
+		auto it = cache.find(lba);
+		if (it == cache.end() || !it->second.dirty || it->second.destaging) {
+			continue;
+		}
+		if (!slot_written[it->second.slot]) {
+			dirty_pages.push_back(lba);		// retry once the page reaches the cache tier
+			break;
+		}
+		it->second.destaging = true;
+		num_ongoing_destages++;
+		submit_to_tier(tier_io(UNDEFINED, CACHE_TIER, DESTAGE_READ, lba, it->second.version), READ, time);
+	}
+}
+
+void Tiered_Ssd::submit_to_tier(tier_io const& io, event_type type, double time) {
+	tier previous = current_tier;
+	switch_to(io.t);
+	Ssd* device = tiers[io.t];
+	long address = io.t == CACHE_TIER ? cache.at(io.logical_address).slot : io.logical_address;
+	Event* tier_event = new Event(type, address, 1, time);
+	if (io.purpose == FOREGROUND) {
+		tier_event->set_tag(host_ios.at(io.host_io_id).event->get_tag());
+		host_ios.at(io.host_io_id).num_pending++;
+	}
+	// A device rejects IOs submitted before IOs it has already completed
+	if (tier_event->get_ssd_submission_time() < device->get_last_io_submission_time()) {
+		tier_event->incr_os_wait_time(device->get_last_io_submission_time() - tier_event->get_ssd_submission_time());
+	}
+	tier_ios[tier_event->get_application_io_id()] = io;
+	device->submit(tier_event);
+	switch_to(previous);
+}
+
+// =================  Completion  =============================
+
+void Tiered_Ssd::register_event_completion(Event* event) {
+	tier_io io = tier_ios.at(event->get_application_io_id());
+	tier_ios.erase(event->get_application_io_id());
+	double time = event->get_current_time();
+	bool noop = event->get_noop();
+	if (!noop) {
+		if (event->get_event_type() == WRITE) 	stats.write_latencies[io.t].push_back(event->get_latency());
+		else if (event->get_event_type() != TRIM) 	stats.read_latencies[io.t].push_back(event->get_latency());
+	}
+	Address address = event->get_address();
+	long slot = event->get_logical_address();
+	bool cache_write = io.t == CACHE_TIER && event->get_event_type() == WRITE;
+	delete event;
+
+	// The slot may have been given to another page since the write was issued, which must not be marked as written
+	if (cache_write) {
+		auto it = cache.find(io.logical_address);
+		cache_write = it != cache.end() && it->second.slot == slot && io.version >= it->second.allocated_version;
+		if (cache_write && io.purpose == PROMOTION) {
+			it->second.promoting = false;
+		}
+	}
+	if (cache_write && !noop && !slot_written[slot]) {
+		slot_written[slot] = true;
+		vector<tier_io> waiting;
+		swap(waiting, reads_waiting_for_slot[slot]);
+		reads_waiting_for_slot.erase(slot);
+		for (auto read : waiting) {
+			host_io& host = host_ios.at(read.host_io_id);
+			host.num_pending--;
+			submit_read(host, read.logical_address, time);
+		}
+	}
+
+	if (io.purpose == FOREGROUND) {
+		host_io& host = host_ios.at(io.host_io_id);
+		host.num_pending--;
+		if (time >= host.finish_time) {
+			host.finish_time = time;
+			if (io.t == CAPACITY_TIER) host.address = address;
+		}
+		host.noop = host.noop && noop;
+		bool read_miss = io.t == CAPACITY_TIER && host.event->get_event_type() == READ;
+		if (read_miss && TIER_ADMISSION_POLICY == 1 && !noop && cache.count(io.logical_address) == 0
+				&& should_admit(io.logical_address) && allocate(io.logical_address)) {
+			stats.num_promotions++;
+			// The page cannot be evicted before it reaches the cache tier
+			cache_entry& entry = cache.at(io.logical_address);
+			entry.promoting = true;
+			submit_to_tier(tier_io(UNDEFINED, CACHE_TIER, PROMOTION, io.logical_address, entry.version), WRITE, time);
+		}
+		if (host.num_pending == 0) {
+			finish(host);
+		}
+	}
+	else if (io.purpose == DESTAGE_READ) {
+		if (cache.count(io.logical_address) == 1) {
+			submit_to_tier(tier_io(UNDEFINED, CAPACITY_TIER, DESTAGE_WRITE, io.logical_address, io.version), WRITE, time);
+		} else {
+			num_ongoing_destages--;		// the page was trimmed in the meanwhile
+		}
+	}
+	else if (io.purpose == DESTAGE_WRITE) {
+		num_ongoing_destages--;
+		stats.num_destaged_pages++;
+		if (stats.first_destage_time == UNDEFINED) stats.first_destage_time = time;
+		stats.last_destage_time = time;
+		auto it = cache.find(io.logical_address);
+		if (it != cache.end()) {
+			cache_entry& entry = it->second;
+			entry.destaging = false;
+			// If the page was written again while being destaged, it stays dirty and is destaged again later
+			if (entry.dirty && entry.version == io.version) {
+				entry.dirty = false;
+				num_dirty--;
+			} else if (entry.dirty) {
+				dirty_pages.push_back(io.logical_address);
+			}
+		}
+	}
+	destage(time);
+}
+
+// Returns the application IO to the OS once all its tier IOs are done
+void Tiered_Ssd::finish(host_io& io) {
+	Event* orig = io.event;
+	uint id = orig->get_application_io_id();
+	double latency = io.finish_time - orig->get_current_time();
+	orig->incr_accumulated_wait_time(latency);
+	orig->incr_pure_ssd_wait_time(latency);
+	orig->set_noop(io.noop);
+	if (orig->get_event_type() == READ) {
+		orig->set_event_type(READ_TRANSFER);
+	}
+	if (io.address.valid == PAGE) {
+		orig->set_address(io.address);
+	}
+	if (!io.noop && orig->get_event_type() == READ_TRANSFER) {
+		(io.hit ? stats.read_hit_latencies : stats.read_miss_latencies).push_back(orig->get_latency());
+	} else if (!io.noop && orig->get_event_type() == WRITE) {
+		(io.cache_write ? stats.cache_write_latencies : stats.bypassed_write_latencies).push_back(orig->get_latency());
+	}
+	host_ios.erase(id);
+	// The host sees the configuration of the capacity tier
+	tier previous = current_tier;
+	switch_to(CAPACITY_TIER);
+	return_completed_event(orig);
+	switch_to(previous);
+}
+
+// =================  Progress  =============================
+
+// Always progress the tier whose next event is soonest, so both tiers advance together in simulated time
+void Tiered_Ssd::progress_since_os_is_waiting() {
+	int soonest = UNDEFINED;
+	for (uint i = 0; i < tiers.size(); i++) {
+		if (tiers[i]->is_busy() && (soonest == UNDEFINED || tiers[i]->get_next_event_time() < tiers[soonest]->get_next_event_time())) {
+			soonest = i;
+		}
+	}
+	if (soonest != UNDEFINED) {
+		tier previous = current_tier;
+		switch_to((tier)soonest);
+		tiers[soonest]->progress_since_os_is_waiting();
+		switch_to(previous);
+	}
+}
+
+void Tiered_Ssd::execute_all_remaining_events() {
+	while (is_busy()) {
+		progress_since_os_is_waiting();
+	}
+}
+
+bool Tiered_Ssd::is_busy() {
+	return tiers[CACHE_TIER]->is_busy() || tiers[CAPACITY_TIER]->is_busy();
+}
+
+double Tiered_Ssd::get_next_event_time() {
+	double time = INFINITE;
+	for (auto t : tiers) {
+		if (t->is_busy()) {
+			time = min(time, t->get_next_event_time());
+		}
+	}
+	return time;
+}
+
+// =================  Statistics  =============================
+
+Tiered_Ssd::stats::stats()
+	: num_read_hits(0),
+	  num_read_misses(0),
+	  num_cache_writes(0),
+	  num_bypassed_writes(0),
+	  num_promotions(0),
+	  num_evictions(0),
+	  num_destaged_pages(0),
+	  first_destage_time(UNDEFINED),
+	  last_destage_time(UNDEFINED),
+	  read_hit_latencies(),
+	  read_miss_latencies(),
+	  cache_write_latencies(),
+	  bypassed_write_latencies(),
+	  read_latencies(2),
+	  write_latencies(2)
+{}
+
+void Tiered_Ssd::stats::print() const {
+	long num_reads = num_read_hits + num_read_misses;
+	long num_writes = num_cache_writes + num_bypassed_writes;
+	printf("read hit rate:\t%f\n", num_reads == 0 ? 0 : num_read_hits / (double)num_reads);
+	printf("write hit rate:\t%f\n", num_writes == 0 ? 0 : num_cache_writes / (double)num_writes);
+	printf("bypassed writes:\t%ld\n", num_bypassed_writes);
+	printf("promotions:\t%ld\n", num_promotions);
+	printf("evictions:\t%ld\n", num_evictions);
+	printf("destaged pages:\t%ld\n", num_destaged_pages);
+	double destage_period = last_destage_time - first_destage_time;
+	// pages per microsecond to MB per second
+	double destage_bandwidth = destage_period <= 0 ? 0 : num_destaged_pages * PAGE_SIZE / destage_period;
+	printf("destage bandwidth (MB/s):\t%f\n", destage_bandwidth);
+
+	printf("\nApplication IO latency:\n");
+	printf("\tcount\tavg\t\tp50\t\tp90\t\tp99\t\tp99.9\t\tmax\n");
+	StatisticsGatherer::print_latency_distribution("read hits", read_hit_latencies);
+	StatisticsGatherer::print_latency_distribution("read misses", read_miss_latencies);
+	StatisticsGatherer::print_latency_distribution("cached writes", cache_write_latencies);
+	StatisticsGatherer::print_latency_distribution("bypassed writes", bypassed_write_latencies);
+
+	printf("\nTier IO latency, including destaging and promotions:\n");
+	printf("\tcount\tavg\t\tp50\t\tp90\t\tp99\t\tp99.9\t\tmax\n");
+	StatisticsGatherer::print_latency_distribution("cache reads", read_latencies[CACHE_TIER]);
+	StatisticsGatherer::print_latency_distribution("cache writes", write_latencies[CACHE_TIER]);
+	StatisticsGatherer::print_latency_distribution("capacity reads", read_latencies[CAPACITY_TIER]);
+	StatisticsGatherer::print_latency_distribution("capacity writes", write_latencies[CAPACITY_TIER]);
+	printf("\n");
+}
+
+void Tiered_Ssd::print_statistics() {
+	printf("Tiered storage with a cache tier of %ld pages\n", num_slots);
+	stats.print();
+	const char* names[] = {"Cache tier", "Capacity tier"};
+	for (uint i = 0; i < tiers.size(); i++) {
+		printf("%s:\n", names[i]);
+		tier_statistics[i]->print_simple();
+		printf("\n");
+	}
+}
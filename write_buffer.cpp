@@ -0,0 +1,220 @@
+/*
+ * write_buffer.cpp
+ *
+ *  The DRAM write-back buffer of the SSD controller.
+ */
+
+#include "ssd.h"
+#include "block_management.h"
+
+using namespace ssd;
+
+Write_Buffer::Write_Buffer(Ssd* ssd, Migrator* migrator)
+	: ssd(ssd),
+	  migrator(migrator),
+	  pages(),
+	  dirty_pages(),
+	  waiting_writes(),
+	  waiting_pages(),
+	  flushes_in_flight(),
+	  flushing(false),
+	  num_writes(0),
+	  num_absorbed_writes(0),
+	  num_waiting_writes(0),
+	  num_read_hits(0),
+	  num_flushes(0)
+{}
+
+Write_Buffer::~Write_Buffer() {
+	while (!waiting_writes.empty()) {
+		delete waiting_writes.front();
+		waiting_writes.pop();
+	}
+}
+
+// Returns false if the event is not handled by the buffer, and should go to flash
+bool Write_Buffer::submit(Event* event) {
+	long la = event->get_logical_address();
+	double time = event->get_current_time();
+	if (event->get_event_type() == READ) {
+		if (event->is_flexible_read() || (pages.count(la) == 0 && waiting_pages.count(la) == 0)) {
+			return false;
+		}
+		num_read_hits++;
+		event->set_event_type(READ_TRANSFER);
+		event->incr_execution_time(RAM_READ_DELAY);
+		event->set_served_from_ram(true);
+		StatisticsGatherer::get_global_instance()->register_completed_event(*event);
+		ssd->scheduler->complete(event);
+		return true;
+	}
+	if (event->get_event_type() == TRIM) {
+		// A trim of a page that a waiting write is for must not overtake the write, so it waits behind it
+		if (waiting_pages.count(la) == 1) {
+			park(event);
+			return true;
+		}
+		trim(la);
+		admit_waiting_writes(time);
+		return false;
+	}
+	if (event->get_event_type() != WRITE) {
+		return false;
+	}
+	num_writes++;
+	if (pages.count(la) == 0 && (pages.size() >= WRITE_BUFFER_SIZE || !waiting_writes.empty())) {
+		num_waiting_writes++;
+		park(event);
+	} else {
+		write(event, time);
+	}
+	flush(time);
+	return true;
+}
+
+// Puts the page of a host write in the buffer, and completes the write
+void Write_Buffer::write(Event* event, double time) {
+	long la = event->get_logical_address();
+	page& p = pages[la];
+	if (p.dirty) {
+		num_absorbed_writes++;
+	}
+	if (p.dirty && !p.being_flushed) {
+		dirty_pages.erase(p.position);
+	}
+	p.dirty = true;
+	if (!p.being_flushed) {
+		p.position = dirty_pages.insert(dirty_pages.end(), la);
+	}
+	double wait_time = fmax(0.0, time - event->get_current_time());
+	event->incr_accumulated_wait_time(wait_time);
+	event->incr_pure_ssd_wait_time(wait_time);
+	event->incr_execution_time(RAM_WRITE_DELAY);
+	event->set_cached_write(true);
+	event->set_served_from_ram(true);
+	StatisticsGatherer::get_global_instance()->register_completed_event(*event);
+	ssd->scheduler->complete(event);
+}
+
+// A page that is not being written to flash can be dropped. Otherwise, the trim is ordered after the flush by the scheduler,
+// and the page is not written again.
+void Write_Buffer::trim(long la) {
+	auto p = pages.find(la);
+	if (p != pages.end() && p->second.being_flushed) {
+		p->second.dirty = false;
+	} else if (p != pages.end()) {
+		dirty_pages.erase(p->second.position);
+		pages.erase(p);
+	}
+}
+
+// Makes a write or trim wait for room in the buffer. Reads of its page are served from the buffer meanwhile.
+void Write_Buffer::park(Event* event) {
+	waiting_writes.push(event);
+	waiting_pages[event->get_logical_address()]++;
+}
+
+// At most one page per plane is written at a time, which is enough to keep every plane of every die busy. More would
+// only wait in the scheduler. Unless host writes are waiting for room, a batch of pages is only added for each die that
+// is idle: one page per plane, which the die can program at once, or one page while garbage-collection is going on.
+// The block manager picks the dies the pages go to, and prefers the idle ones.
+uint Write_Buffer::get_max_flushes_in_flight(double time) const {
+	uint max_flushes_in_flight = SSD_SIZE * PACKAGE_SIZE * DIE_SIZE;
+	if (!waiting_writes.empty()) {
+		return max_flushes_in_flight;
+	}
+	uint batch_size = migrator->how_many_gc_operations_are_scheduled() > 0 ? 1 : DIE_SIZE;
+	uint num_idle_dies = 0;
+	for (uint package = 0; package < SSD_SIZE; package++) {
+		for (uint die = 0; die < PACKAGE_SIZE; die++) {
+			Die* d = ssd->get_package(package)->get_die(die);
+			if (d->get_currently_executing_io_finish_time() <= time && !d->register_is_busy()) {
+				num_idle_dies++;
+			}
+		}
+	}
+	return min(max_flushes_in_flight, (uint)flushes_in_flight.size() + num_idle_dies * batch_size);
+}
+
+// Writes the oldest dirty pages to flash, if the buffer is between its watermarks, and there are dies to write them to
+void Write_Buffer::flush(double time) {
+	if (pages.size() >= WRITE_BUFFER_HIGH_WATERMARK * WRITE_BUFFER_SIZE || !waiting_writes.empty()) {
+		flushing = true;
+	}
+	uint max_flushes_in_flight = get_max_flushes_in_flight(time);
+	while (flushing && !dirty_pages.empty() && flushes_in_flight.size() < max_flushes_in_flight) {
+		if (pages.size() - flushes_in_flight.size() <= WRITE_BUFFER_LOW_WATERMARK * WRITE_BUFFER_SIZE && waiting_writes.empty()) {
+			flushing = false;
+			break;
+		}
+		long la = dirty_pages.front();
+		dirty_pages.pop_front();
+		page& p = pages[la];
+		p.dirty = false;
+		p.being_flushed = true;
+		Event* write = new Event(WRITE, la, 1, time);
+		write->set_buffer_flush(true);
+		flushes_in_flight[write->get_application_io_id()] = la;
+		num_flushes++;
+		ssd->ftl->write(write);
+	}
+}
+
+// Returns false if the event is not a write of the buffer to flash
+bool Write_Buffer::register_flush_completion(Event* event) {
+	auto f = flushes_in_flight.find(event->get_application_io_id());
+	if (event->get_event_type() != WRITE || event->is_original_application_io() || f == flushes_in_flight.end()) {
+		return false;
+	}
+	long la = f->second;
+	flushes_in_flight.erase(f);
+	double time = event->get_current_time();
+	delete event;
+
+	page& p = pages[la];
+	p.being_flushed = false;
+	if (p.dirty) {
+		p.position = dirty_pages.insert(dirty_pages.end(), la);
+	} else {
+		pages.erase(la);
+	}
+	admit_waiting_writes(time);
+	flush(time);
+	return true;
+}
+
+// Puts waiting host writes in the buffer, in arrival order, for as long as there is room. The trims waiting behind
+// them are issued in order.
+void Write_Buffer::admit_waiting_writes(double time) {
+	while (!waiting_writes.empty()) {
+		Event* event = waiting_writes.front();
+		long la = event->get_logical_address();
+		bool is_trim = event->get_event_type() == TRIM;
+		if (!is_trim && pages.size() >= WRITE_BUFFER_SIZE && pages.count(la) == 0) {
+			break;
+		}
+		waiting_writes.pop();
+		auto w = waiting_pages.find(la);
+		if (--w->second == 0) {
+			waiting_pages.erase(w);
+		}
+		if (is_trim) {
+			trim(la);
+			double wait_time = fmax(0.0, time - event->get_current_time());
+			event->incr_accumulated_wait_time(wait_time);
+			event->incr_pure_ssd_wait_time(wait_time);
+			ssd->ftl->trim(event);
+		} else {
+			write(event, time);
+		}
+	}
+}
+
+void Write_Buffer::print_statistics() const {
+	printf("Write buffer of %d pages\n", WRITE_BUFFER_SIZE);
+	printf("writes:\t\t\t%ld\n", num_writes);
+	printf("absorbed writes:\t%ld\n", num_absorbed_writes);
+	printf("writes that waited:\t%ld\n", num_waiting_writes);
+	printf("read hits:\t\t%ld\n", num_read_hits);
+	printf("pages written to flash:\t%ld\n\n", num_flushes);
+}